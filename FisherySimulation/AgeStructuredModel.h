@@ -0,0 +1,514 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*  Scalar-generic kernels of the age-structured operating model.
+*   Every function is templated on the scalar type T, so the same code runs with double for
+*   simulation and with Dual<N> (Dual.h) for exact parameter gradients. Elementary functions are
+*   called unqualified so argument-dependent lookup picks the overloads of non-builtin scalars.
+*/
+
+/**
+ * @brief The relationship between the spawning stock biomass and the expected recruitment.
+ */
+enum class StockRecruitment
+{
+    Constant,
+    BevertonHolt,
+    Ricker,
+    HockeyStick
+};
+
+/**
+ * @brief Maps a parameters.json name ("constant", "bevertonHolt", "ricker", "hockeyStick") to the relationship.
+ * @return True if the name is known, false otherwise.
+ */
+inline bool parseStockRecruitment(const std::string& name, StockRecruitment& outType)
+{
+    if (name == "constant") outType = StockRecruitment::Constant;
+    else if (name == "bevertonHolt") outType = StockRecruitment::BevertonHolt;
+    else if (name == "ricker") outType = StockRecruitment::Ricker;
+    else if (name == "hockeyStick") outType = StockRecruitment::HockeyStick;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief The biological and fishing parameters used by one step of the age-structured model.
+ */
+template <typename T>
+struct AgeModelParameters
+{
+    int maxAge = 0;
+    T naturalMortality = T(0.0);
+    T fishingMortality = T(0.0);
+    T vb_Linf = T(0.0);
+    T vb_k = T(0.0);
+    T vb_t0 = T(0.0);
+    T lw_a = T(0.0);
+    T lw_b = T(0.0);
+    T maturity_A50 = T(0.0);
+    T maturity_k = T(0.0);
+    T selectivity_A50 = T(0.0);
+    T selectivity_k = T(0.0);
+    T constantRecruitment = T(0.0);
+
+    //stock-recruitment relationship; constantRecruitment is the unfished recruitment R0
+    StockRecruitment stockRecruitment = StockRecruitment::Constant;
+
+    //the fraction of R0 produced when the SSB is 20% of its unfished level
+    T steepness = T(1.0);
+};
+
+/**
+ * @brief Looks up a parameter by its parameters.json key.
+ * @return A pointer to the parameter, or nullptr if the name is not a scalar age model parameter.
+ */
+template <typename T>
+T* findAgeModelParameter(AgeModelParameters<T>& params, const std::string& name)
+{
+    if (name == "naturalMortality") return &params.naturalMortality;
+    if (name == "fishingMortality") return &params.fishingMortality;
+    if (name == "vb_Linf") return &params.vb_Linf;
+    if (name == "vb_k") return &params.vb_k;
+    if (name == "vb_t0") return &params.vb_t0;
+    if (name == "lw_a") return &params.lw_a;
+    if (name == "lw_b") return &params.lw_b;
+    if (name == "maturity_A50") return &params.maturity_A50;
+    if (name == "maturity_k") return &params.maturity_k;
+    if (name == "selectivity_A50") return &params.selectivity_A50;
+    if (name == "selectivity_k") return &params.selectivity_k;
+    if (name == "constantRecruitment") return &params.constantRecruitment;
+    if (name == "steepness") return &params.steepness;
+    return nullptr;
+}
+
+/**
+ * @brief Calculates the weight of a fish at a given age (von Bertalanffy + Length-Weight).
+ */
+template <typename T>
+T getWeightAtAge(int age, const T& linf, const T& k, const T& t0, const T& lwa, const T& lwb)
+{
+    using std::exp;
+    using std::pow;
+    T length = linf * (1.0 - exp(-k * (static_cast<double>(age) - t0)));
+    return lwa * pow(length, lwb);
+}
+
+/**
+ * @brief Calculates the value of a logistic ogive at a given age (used for maturity and selectivity).
+ */
+template <typename T>
+T getLogisticAtAge(int age, const T& a50, const T& k)
+{
+    using std::exp;
+    return 1.0 / (1.0 + exp(-k * (static_cast<double>(age) - a50)));
+}
+
+template <typename T>
+T getWeightAtAge(int age, const AgeModelParameters<T>& params)
+{
+    return getWeightAtAge(age, params.vb_Linf, params.vb_k, params.vb_t0, params.lw_a, params.lw_b);
+}
+
+template <typename T>
+T getMaturityAtAge(int age, const AgeModelParameters<T>& params)
+{
+    return getLogisticAtAge(age, params.maturity_A50, params.maturity_k);
+}
+
+template <typename T>
+T getSelectivityAtAge(int age, const AgeModelParameters<T>& params)
+{
+    return getLogisticAtAge(age, params.selectivity_A50, params.selectivity_k);
+}
+
+/**
+ * @brief Calculates the total biomass (sum of N[age] * W[age]).
+ */
+template <typename T>
+T getTotalBiomass(const std::vector<T>& numbersAtAge, const AgeModelParameters<T>& params)
+{
+    T totalBiomass = T(0.0);
+    for (int age = 0; age <= params.maxAge; ++age)
+    {
+        totalBiomass += numbersAtAge[age] * getWeightAtAge(age, params);
+    }
+    return totalBiomass;
+}
+
+/**
+ * @brief Calculates the spawning stock biomass (sum of N[age] * W[age] * M[age]).
+ */
+template <typename T>
+T getSpawningStockBiomass(const std::vector<T>& numbersAtAge, const AgeModelParameters<T>& params)
+{
+    T ssb = T(0.0);
+    for (int age = 0; age <= params.maxAge; ++age)
+    {
+        ssb += numbersAtAge[age] * getWeightAtAge(age, params) * getMaturityAtAge(age, params);
+    }
+    return ssb;
+}
+
+/**
+ * @brief Unfished spawning stock biomass per recruit: the sum over ages of the survivorship e^(-M age) times
+ * W[age] * M[age], where the plus group accumulates the survivors of all older ages.
+ */
+template <typename T>
+T getUnfishedSpawnersPerRecruit(const AgeModelParameters<T>& params)
+{
+    using std::exp;
+    T yearlySurvival = exp(-params.naturalMortality);
+    T survivorship = T(1.0);
+    T spawnersPerRecruit = T(0.0);
+    for (int age = 0; age <= params.maxAge; ++age)
+    {
+        T survivors = (age == params.maxAge) ? survivorship / (1.0 - yearlySurvival) : survivorship;
+        spawnersPerRecruit += survivors * getWeightAtAge(age, params) * getMaturityAtAge(age, params);
+        survivorship = survivorship * yearlySurvival;
+    }
+    return spawnersPerRecruit;
+}
+
+/**
+ * @brief The unfished spawning stock biomass SSB0 = R0 * (unfished spawners per recruit).
+ */
+template <typename T>
+T getUnfishedSpawningStockBiomass(const AgeModelParameters<T>& params)
+{
+    return params.constantRecruitment * getUnfishedSpawnersPerRecruit(params);
+}
+
+/**
+ * @brief Expected recruitment for a spawning stock biomass.
+ * All relationships pass through (SSB0, R0) and produce steepness * R0 at 20% of SSB0.
+ * @param ssb The spawning stock biomass that produces the recruits.
+ * @param params The parameters, with constantRecruitment as R0 and the steepness.
+ * @param unfishedSSB SSB0, computed once with getUnfishedSpawningStockBiomass.
+ */
+template <typename T>
+T getExpectedRecruitment(const T& ssb, const AgeModelParameters<T>& params, const T& unfishedSSB)
+{
+    using std::exp;
+    using std::log;
+    const T& R0 = params.constantRecruitment;
+    const T& h = params.steepness;
+
+    switch (params.stockRecruitment)
+    {
+    case StockRecruitment::BevertonHolt:
+        return 4.0 * h * R0 * ssb / (unfishedSSB * (1.0 - h) + ssb * (5.0 * h - 1.0));
+    case StockRecruitment::Ricker:
+        return R0 * (ssb / unfishedSSB) * exp(log(5.0 * h) / 0.8 * (1.0 - ssb / unfishedSSB));
+    case StockRecruitment::HockeyStick:
+    {
+        T breakpoint = 0.2 * unfishedSSB / h;
+        return (ssb < breakpoint) ? T(R0 * ssb / breakpoint) : R0;
+    }
+    default:
+        return R0;
+    }
+}
+
+/**
+ * @brief Equilibrium recruitment under a constant spawners per recruit (e.g. for a fixed fishing mortality).
+ * Solves R = f(R * spawnersPerRecruit) for the stock-recruitment relationship f; 0 means the stock collapses.
+ */
+template <typename T>
+T getEquilibriumRecruitment(const T& spawnersPerRecruit, const AgeModelParameters<T>& params, const T& unfishedSSB)
+{
+    using std::log;
+    const T& R0 = params.constantRecruitment;
+    const T& h = params.steepness;
+    T recruitment = R0;
+
+    switch (params.stockRecruitment)
+    {
+    case StockRecruitment::BevertonHolt:
+        recruitment = (4.0 * h * R0 * spawnersPerRecruit - unfishedSSB * (1.0 - h)) / (spawnersPerRecruit * (5.0 * h - 1.0));
+        break;
+    case StockRecruitment::Ricker:
+        recruitment = unfishedSSB / spawnersPerRecruit * (1.0 - log(unfishedSSB / (R0 * spawnersPerRecruit)) / (log(5.0 * h) / 0.8));
+        break;
+    case StockRecruitment::HockeyStick:
+        //above the breakpoint recruitment is R0, below it the stock cannot replace itself
+        if (R0 * spawnersPerRecruit < 0.2 * unfishedSSB / h) recruitment = T(0.0);
+        break;
+    default:
+        break;
+    }
+    return (recruitment < T(0.0)) ? T(0.0) : recruitment;
+}
+
+/**
+ * @brief Simulates one year step of the Age-Structured Model for any scalar type.
+ * @param numbersAtAge The numbers at age, replaced by the numbers at the end of the year.
+ * @param params The biological and fishing parameters.
+ * @param recruitment The number of age 0 fish entering the population at the end of the year.
+ * @return The total catch in biomass for the year.
+ */
+template <typename T>
+T AgeStructuredModelStep(std::vector<T>& numbersAtAge, const AgeModelParameters<T>& params, const T& recruitment)
+{
+    using std::exp;
+    int maxAge = params.maxAge;
+    const std::vector<T> N_start = numbersAtAge; //numbers at start of year
+    std::vector<T>& N_end = numbersAtAge; //numbers at end of year
+    T totalCatchBiomass = T(0.0);
+    const T& M = params.naturalMortality;
+    const T& F_max = params.fishingMortality;
+
+    // Loop from age 1 to maxAge - 1
+    for (int age = 1; age < maxAge; ++age)
+    {
+        T sel = getSelectivityAtAge(age - 1, params); //selectivity of the cohort from the previous age
+        T F = F_max * sel;
+        T Z = M + F; //total mortality
+        N_end[age] = N_start[age - 1] * exp(-Z);
+
+        //baranov catch equation (biomass)
+        totalCatchBiomass += (F / Z) * (1.0 - exp(-Z)) * N_start[age - 1] * getWeightAtAge(age - 1, params);
+    }
+
+    //handle the plus group (age maxAge)
+    T sel_recruit = getSelectivityAtAge(maxAge - 1, params);
+    T F_recruit = F_max * sel_recruit;
+    T Z_recruit = M + F_recruit;
+    T recruits_to_plus_group = N_start[maxAge - 1] * exp(-Z_recruit);
+
+    T sel_plus = getSelectivityAtAge(maxAge, params);
+    T F_plus = F_max * sel_plus;
+    T Z_plus = M + F_plus;
+    T survivors_from_plus_group = N_start[maxAge] * exp(-Z_plus);
+
+    //total fish in maxAge
+    N_end[maxAge] = recruits_to_plus_group + survivors_from_plus_group;
+
+    totalCatchBiomass += (F_recruit / Z_recruit) * (1.0 - exp(-Z_recruit)) * N_start[maxAge - 1] * getWeightAtAge(maxAge - 1, params);
+    totalCatchBiomass += (F_plus / Z_plus) * (1.0 - exp(-Z_plus)) * N_start[maxAge] * getWeightAtAge(maxAge, params);
+
+    //fish reproduction
+    N_end[0] = recruitment;
+
+    return totalCatchBiomass;
+}
+
+/**
+ * @brief Simulates one year step of the Age-Structured Model in place, from tabulated rates.
+ * Gives the same results as AgeStructuredModelStep without copying the numbers at age, so it can step
+ * preallocated (e.g. contiguous batched or structure-of-arrays particle) storage.
+ * @param numbersAtAge The maxAge + 1 numbers at age, replaced by the numbers at the end of the year.
+ * @param survival The survival e^-Z at each age.
+ * @param catchFactor The Baranov catch factor (F / Z)(1 - e^-Z) at each age.
+ * @param weightAtAge The weight at each age.
+ * @param recruitment The number of age 0 fish entering the population at the end of the year.
+ * @param stride The distance between the numbers of consecutive ages (e.g. the particle count of structure-of-arrays storage).
+ * @return The total catch in biomass for the year.
+ */
+template <typename T>
+T stepTabulatedAgeModel(T* numbersAtAge, int maxAge, const T* survival, const T* catchFactor, const T* weightAtAge, const T& recruitment,
+    std::size_t stride = 1)
+{
+    T totalCatchBiomass = T(0.0);
+    for (int age = 0; age <= maxAge; ++age)
+    {
+        totalCatchBiomass += catchFactor[age] * numbersAtAge[age * stride] * weightAtAge[age];
+    }
+
+    //from the oldest age down, so every cohort is read before it is overwritten
+    numbersAtAge[maxAge * stride] = numbersAtAge[(maxAge - 1) * stride] * survival[maxAge - 1] + numbersAtAge[maxAge * stride] * survival[maxAge];
+    for (int age = maxAge - 1; age >= 1; --age)
+    {
+        numbersAtAge[age * stride] = numbersAtAge[(age - 1) * stride] * survival[age - 1];
+    }
+    numbersAtAge[0] = recruitment;
+
+    return totalCatchBiomass;
+}
+
+/**
+ * @brief The totals of an age-structured model step.
+ */
+template <typename T>
+struct AgeStepTotals
+{
+    //of the numbers at the end of the year
+    T totalBiomass = T(0.0);
+    T spawningStockBiomass = T(0.0);
+
+    //the catch of the year
+    T catchNumbers = T(0.0);
+    T catchBiomass = T(0.0);
+};
+
+/**
+ * @brief Simulates one year step of the Age-Structured Model in place, from tabulated rates, and reduces the
+ * totals in the same sweep over ages. The numbers of the previous age are carried up the ages, so every cohort
+ * is read, aged and weighed once, where a step followed by the biomass and SSB reductions takes three passes.
+ * The catch is the same as stepTabulatedAgeModel, and the totals the same as Fishery::getTotalBiomass and
+ * getSpawningStockBiomass of the new numbers (the sums are taken in the same order).
+ * @param numbersAtAge The maxAge + 1 numbers at age, replaced by the numbers at the end of the year.
+ * @param maturityAtAge The fraction mature at each age.
+ * @param recruitment The number of age 0 fish entering the population at the end of the year.
+ */
+template <typename T>
+AgeStepTotals<T> stepFusedAgeModel(T* numbersAtAge, int maxAge, const T* survival, const T* catchFactor, const T* weightAtAge,
+    const T* maturityAtAge, const T& recruitment)
+{
+    AgeStepTotals<T> totals;
+    T previous = numbersAtAge[0];
+    numbersAtAge[0] = recruitment;
+    totals.totalBiomass += recruitment * weightAtAge[0];
+    totals.spawningStockBiomass += recruitment * weightAtAge[0] * maturityAtAge[0];
+
+    for (int age = 1; age < maxAge; ++age)
+    {
+        T current = numbersAtAge[age];
+        T caught = catchFactor[age - 1] * previous;
+        totals.catchNumbers += caught;
+        totals.catchBiomass += caught * weightAtAge[age - 1];
+
+        T survivors = previous * survival[age - 1];
+        numbersAtAge[age] = survivors;
+        totals.totalBiomass += survivors * weightAtAge[age];
+        totals.spawningStockBiomass += survivors * weightAtAge[age] * maturityAtAge[age];
+        previous = current;
+    }
+
+    //the plus group gains the survivors of the age below and keeps its own
+    T plusGroup = numbersAtAge[maxAge];
+    T caught = catchFactor[maxAge - 1] * previous;
+    totals.catchNumbers += caught;
+    totals.catchBiomass += caught * weightAtAge[maxAge - 1];
+    caught = catchFactor[maxAge] * plusGroup;
+    totals.catchNumbers += caught;
+    totals.catchBiomass += caught * weightAtAge[maxAge];
+
+    T survivors = previous * survival[maxAge - 1] + plusGroup * survival[maxAge];
+    numbersAtAge[maxAge] = survivors;
+    totals.totalBiomass += survivors * weightAtAge[maxAge];
+    totals.spawningStockBiomass += survivors * weightAtAge[maxAge] * maturityAtAge[maxAge];
+
+    return totals;
+}
+
+/**
+ * @class AgeModelTables
+ * @brief The rates of the age-structured model tabulated for any maximum age, as FixedAgeModel does for a
+ * compile-time one: the weight, maturity and selectivity at age once, and the survival and catch factor for the
+ * current natural and fishing mortality, recomputed only when one of them changes. Steps with stepFusedAgeModel.
+ * With T = double the results are those of AgeStructuredModelStep and the Fishery reductions.
+ */
+template <typename T>
+class AgeModelTables
+{
+public:
+    explicit AgeModelTables(const AgeModelParameters<T>& params)
+        : maxAge(params.maxAge)
+    {
+        for (int age = 0; age <= maxAge; ++age)
+        {
+            weightAtAge.push_back(getWeightAtAge(age, params));
+            maturityAtAge.push_back(getMaturityAtAge(age, params));
+            selectivityAtAge.push_back(getSelectivityAtAge(age, params));
+        }
+        survival.resize(maxAge + 1);
+        catchFactor.resize(maxAge + 1);
+        updateMortality(params.naturalMortality, params.fishingMortality);
+    }
+
+    int getMaxAge() const { return maxAge; }
+
+    /**
+     * @brief Sets the natural and fishing mortality of the next steps, recomputing the tables if they changed.
+     */
+    void setMortality(const T& naturalMortality, const T& fishingMortality)
+    {
+        if (naturalMortality != currentNaturalMortality || fishingMortality != currentFishingMortality)
+        {
+            updateMortality(naturalMortality, fishingMortality);
+        }
+    }
+
+    /**
+     * @brief Simulates one year step in place (see stepFusedAgeModel).
+     */
+    AgeStepTotals<T> step(T* numbersAtAge, const T& recruitment) const
+    {
+        return stepFusedAgeModel(numbersAtAge, maxAge, survival.data(), catchFactor.data(), weightAtAge.data(), maturityAtAge.data(), recruitment);
+    }
+
+    /**
+     * @brief The total biomass and spawning stock biomass of the numbers at age, in one pass (no catch).
+     */
+    AgeStepTotals<T> getTotals(const T* numbersAtAge) const
+    {
+        AgeStepTotals<T> totals;
+        for (int age = 0; age <= maxAge; ++age)
+        {
+            totals.totalBiomass += numbersAtAge[age] * weightAtAge[age];
+            totals.spawningStockBiomass += numbersAtAge[age] * weightAtAge[age] * maturityAtAge[age];
+        }
+        return totals;
+    }
+
+private:
+    void updateMortality(const T& naturalMortality, const T& fishingMortality)
+    {
+        using std::exp;
+        currentNaturalMortality = naturalMortality;
+        currentFishingMortality = fishingMortality;
+        for (int age = 0; age <= maxAge; ++age)
+        {
+            T F = fishingMortality * selectivityAtAge[age];
+            T Z = naturalMortality + F;
+            survival[age] = exp(-Z);
+            catchFactor[age] = (F / Z) * (1.0 - exp(-Z));
+        }
+    }
+
+    int maxAge;
+    std::vector<T> weightAtAge;
+    std::vector<T> maturityAtAge;
+    std::vector<T> selectivityAtAge;
+    std::vector<T> survival;
+    std::vector<T> catchFactor;
+    T currentNaturalMortality;
+    T currentFishingMortality;
+};
+
+/**
+ * @brief Projects the age-structured model without recruitment noise.
+ * @param initialNumbers The numbers at age at year 0.
+ * @param params The biological and fishing parameters. Recruitment follows the stock-recruitment relationship
+ *        of the SSB at the start of each year (constantRecruitment for StockRecruitment::Constant).
+ * @param years The number of years to project.
+ * @param outBiomass (Output) Total biomass for years 0..years.
+ * @param outSSB (Output) Spawning stock biomass for years 0..years.
+ * @param outCatch (Output) Catch in biomass for years 0..years (0 at year 0).
+ */
+template <typename T>
+void projectAgeModelDeterministic(const std::vector<double>& initialNumbers, const AgeModelParameters<T>& params, int years,
+    std::vector<T>& outBiomass, std::vector<T>& outSSB, std::vector<T>& outCatch)
+{
+    std::vector<T> numbersAtAge(initialNumbers.begin(), initialNumbers.end());
+    outBiomass.assign(years + 1, T(0.0));
+    outSSB.assign(years + 1, T(0.0));
+    outCatch.assign(years + 1, T(0.0));
+
+    T unfishedSSB = (params.stockRecruitment == StockRecruitment::Constant) ? T(0.0) : getUnfishedSpawningStockBiomass(params);
+
+    outBiomass[0] = getTotalBiomass(numbersAtAge, params);
+    outSSB[0] = getSpawningStockBiomass(numbersAtAge, params);
+    for (int year = 1; year <= years; ++year)
+    {
+        T recruitment = getExpectedRecruitment(outSSB[year - 1], params, unfishedSSB);
+        outCatch[year] = AgeStructuredModelStep(numbersAtAge, params, recruitment);
+        outBiomass[year] = getTotalBiomass(numbersAtAge, params);
+        outSSB[year] = getSpawningStockBiomass(numbersAtAge, params);
+    }
+}
@@ -3,6 +3,8 @@
 #include <string>
 #include <fstream>
 #include <iomanip>
+#include <vector>
+#include "Tracing.h"
 
 /**
  * @class CSVManager
@@ -22,6 +24,7 @@ public:
      */
     bool open(const std::string& filename)
     {
+        TraceScope trace("CSVOpen", "io");
         if (fileStream.is_open())
         {
             fileStream.close();
@@ -37,11 +40,21 @@ public:
         return true;
     }
 
+    /**
+     * @brief Writes the values of the open file in scientific notation (e.g. probabilities far below 1e-8).
+     */
+    void setScientific(int precision)
+    {
+        fileStream << std::scientific << std::setprecision(precision);
+    }
+
     /**
      * @brief Closes the currently open file stream.
      */
     void close()
     {
+        //flushes the buffered rows to disk
+        TraceScope trace("CSVClose", "io");
         if (fileStream.is_open())
         {
             fileStream.close();
@@ -112,6 +125,22 @@ public:
         }
     }
 
+    /**
+     * @brief Writes a labelled row of values (e.g. one parameter of an analysis and its results).
+     */
+    void writeRow(const std::string& label, const std::vector<double>& values)
+    {
+        if (fileStream.is_open())
+        {
+            fileStream << label;
+            for (double value : values)
+            {
+                fileStream << separator << value;
+            }
+            fileStream << "\n";
+        }
+    }
+
 private:
     std::ofstream fileStream;
     std::string separator = ",";
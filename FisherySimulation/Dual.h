@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @class Dual
+ * @brief A forward-mode automatic differentiation number carrying a value and N partial derivatives.
+ * Running a scalar-generic kernel with Dual<N> instead of double yields the exact derivatives of every
+ * output with respect to N seeded inputs in a single pass.
+ */
+template <std::size_t N>
+struct Dual
+{
+    double value;
+    std::array<double, N> derivatives;
+
+    Dual() : value(0.0) { derivatives.fill(0.0); }
+
+    //constants have zero derivatives
+    Dual(double constant) : value(constant) { derivatives.fill(0.0); }
+
+    /**
+     * @brief Creates an independent variable, i.e. a value whose derivative with respect to input index is 1.
+     */
+    static Dual variable(double value, std::size_t index)
+    {
+        Dual result(value);
+        result.derivatives[index] = 1.0;
+        return result;
+    }
+
+    Dual& operator+=(const Dual& other)
+    {
+        value += other.value;
+        for (std::size_t i = 0; i < N; ++i) derivatives[i] += other.derivatives[i];
+        return *this;
+    }
+
+    Dual& operator-=(const Dual& other)
+    {
+        value -= other.value;
+        for (std::size_t i = 0; i < N; ++i) derivatives[i] -= other.derivatives[i];
+        return *this;
+    }
+
+    Dual& operator*=(const Dual& other)
+    {
+        for (std::size_t i = 0; i < N; ++i) derivatives[i] = derivatives[i] * other.value + value * other.derivatives[i];
+        value *= other.value;
+        return *this;
+    }
+
+    Dual& operator/=(const Dual& other)
+    {
+        double inverse = 1.0 / other.value;
+        double quotient = value * inverse;
+        for (std::size_t i = 0; i < N; ++i) derivatives[i] = (derivatives[i] - quotient * other.derivatives[i]) * inverse;
+        value = quotient;
+        return *this;
+    }
+};
+
+template <std::size_t N> Dual<N> operator-(const Dual<N>& x)
+{
+    Dual<N> result(-x.value);
+    for (std::size_t i = 0; i < N; ++i) result.derivatives[i] = -x.derivatives[i];
+    return result;
+}
+
+template <std::size_t N> Dual<N> operator+(Dual<N> a, const Dual<N>& b) { return a += b; }
+template <std::size_t N> Dual<N> operator-(Dual<N> a, const Dual<N>& b) { return a -= b; }
+template <std::size_t N> Dual<N> operator*(Dual<N> a, const Dual<N>& b) { return a *= b; }
+template <std::size_t N> Dual<N> operator/(Dual<N> a, const Dual<N>& b) { return a /= b; }
+
+//mixed operations with plain constants, so kernels can use double literals
+template <std::size_t N> Dual<N> operator+(Dual<N> a, double b) { a.value += b; return a; }
+template <std::size_t N> Dual<N> operator+(double a, Dual<N> b) { b.value += a; return b; }
+template <std::size_t N> Dual<N> operator-(Dual<N> a, double b) { a.value -= b; return a; }
+template <std::size_t N> Dual<N> operator-(double a, const Dual<N>& b) { Dual<N> result = -b; result.value += a; return result; }
+
+template <std::size_t N> Dual<N> operator*(Dual<N> a, double b)
+{
+    a.value *= b;
+    for (std::size_t i = 0; i < N; ++i) a.derivatives[i] *= b;
+    return a;
+}
+template <std::size_t N> Dual<N> operator*(double a, const Dual<N>& b) { return b * a; }
+
+template <std::size_t N> Dual<N> operator/(Dual<N> a, double b) { return a * (1.0 / b); }
+template <std::size_t N> Dual<N> operator/(double a, const Dual<N>& b)
+{
+    double quotient = a / b.value;
+    Dual<N> result(quotient);
+    double scale = -quotient / b.value;
+    for (std::size_t i = 0; i < N; ++i) result.derivatives[i] = scale * b.derivatives[i];
+    return result;
+}
+
+template <std::size_t N> bool operator<(const Dual<N>& a, const Dual<N>& b) { return a.value < b.value; }
+template <std::size_t N> bool operator>(const Dual<N>& a, const Dual<N>& b) { return a.value > b.value; }
+
+//elementary functions, found by argument-dependent lookup from the generic kernels
+
+template <std::size_t N> Dual<N> exp(const Dual<N>& x)
+{
+    double e = std::exp(x.value);
+    Dual<N> result(e);
+    for (std::size_t i = 0; i < N; ++i) result.derivatives[i] = e * x.derivatives[i];
+    return result;
+}
+
+template <std::size_t N> Dual<N> log(const Dual<N>& x)
+{
+    Dual<N> result(std::log(x.value));
+    double inverse = 1.0 / x.value;
+    for (std::size_t i = 0; i < N; ++i) result.derivatives[i] = inverse * x.derivatives[i];
+    return result;
+}
+
+template <std::size_t N> Dual<N> pow(const Dual<N>& base, double exponent)
+{
+    double p = std::pow(base.value, exponent);
+    Dual<N> result(p);
+    double scale = exponent * std::pow(base.value, exponent - 1.0);
+    for (std::size_t i = 0; i < N; ++i) result.derivatives[i] = scale * base.derivatives[i];
+    return result;
+}
+
+template <std::size_t N> Dual<N> pow(const Dual<N>& base, const Dual<N>& exponent)
+{
+    double p = std::pow(base.value, exponent.value);
+    Dual<N> result(p);
+    double baseScale = exponent.value * std::pow(base.value, exponent.value - 1.0);
+    //d(a^b)/db = a^b ln(a), which is only defined for a positive base
+    double exponentScale = (base.value > 0.0) ? p * std::log(base.value) : 0.0;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        result.derivatives[i] = baseScale * base.derivatives[i] + exponentScale * exponent.derivatives[i];
+    }
+    return result;
+}
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Fishery.h"
+
+#ifdef _WIN32 //windows
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else //posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file.
+ * The pages are shared by every thread (and every process) reading the file, and are only loaded from disk
+ * when first touched, so large inputs cost neither a copy nor a read up front.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /**
+     * @brief Maps a file, replacing any previous mapping.
+     * @return True if the file was opened and mapped, false if it is missing or empty.
+     */
+    bool open(const std::string& filename)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) return false;
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); //the view keeps the mapping alive
+        if (view == nullptr) return false;
+
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        int descriptor = ::open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0) return false;
+
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+        ::close(descriptor); //the mapping keeps the file alive
+        if (view == MAP_FAILED) return false;
+
+        //series are read front to back in step order
+        madvise(view, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<std::size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+        if (mappedData == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(mappedData);
+#else
+        munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+
+    const char* data() const { return mappedData; }
+    std::size_t size() const { return mappedSize; }
+
+private:
+    const char* mappedData = nullptr;
+    std::size_t mappedSize = 0;
+};
+
+/**
+ * @class ForcingSeries
+ * @brief A set of evenly spaced environmental time series (one per scenario), read from a binary or CSV file.
+ *
+ * Binary files are used in place: the file is memory-mapped and the values are read straight from the mapped
+ * pages, so a large multi-scenario file is never copied, however many threads read it. The layout is a
+ * 40-byte header followed by the values as native (little-endian) doubles, scenario-major:
+ *     char magic[8] = "FSFORCE1", uint32 scenarioCount, uint32 reserved (0), uint64 stepCount,
+ *     double startTime, double timeStep, then values[scenario * stepCount + step].
+ * Binary scenarios are named by their index ("0", "1", ...).
+ *
+ * CSV files have a header "Year,<scenario1>,<scenario2>,..." and one row per time step, with evenly spaced
+ * times. Lines starting with '#' are comments. They are parsed once from the mapping into one shared buffer.
+ *
+ * Times are in years from the start of the simulation. A series is only handed out as a
+ * std::shared_ptr<const ForcingSeries> and never changes after loading, so any number of threads can
+ * read it without synchronization.
+ */
+class ForcingSeries
+{
+public:
+    ForcingSeries(const ForcingSeries&) = delete;
+    ForcingSeries& operator=(const ForcingSeries&) = delete;
+
+    /**
+     * @brief Loads a forcing file, detecting the binary format from its magic bytes.
+     * @return The series, or nullptr (after printing an error) if the file is missing or malformed.
+     */
+    static std::shared_ptr<const ForcingSeries> load(const std::string& filename)
+    {
+        std::shared_ptr<ForcingSeries> series(new ForcingSeries());
+        if (!series->file.open(filename))
+        {
+            std::cout << "Error: Could not open forcing file: " << filename << std::endl;
+            return nullptr;
+        }
+
+        bool isBinary = series->file.size() >= 8 && std::memcmp(series->file.data(), "FSFORCE1", 8) == 0;
+        bool loaded = isBinary ? series->loadBinary(filename) : series->loadCsv(filename);
+        if (!loaded) return nullptr;
+        return series;
+    }
+
+    std::size_t getScenarioCount() const { return scenarioNames.size(); }
+    std::size_t getStepCount() const { return stepCount; }
+    double getStartTime() const { return startTime; }
+    double getTimeStep() const { return timeStep; }
+    const std::vector<std::string>& getScenarioNames() const { return scenarioNames; }
+
+    //true when the values are read in place from the mapped file
+    bool isMapped() const { return parsedValues.empty(); }
+
+    /**
+     * @return The index of the named scenario, or -1 if there is none.
+     */
+    int findScenario(const std::string& name) const
+    {
+        auto it = std::find(scenarioNames.begin(), scenarioNames.end(), name);
+        return (it == scenarioNames.end()) ? -1 : static_cast<int>(it - scenarioNames.begin());
+    }
+
+    /**
+     * @brief The value of a scenario at a time, linearly interpolated between the two neighbouring steps.
+     * Times before the first or after the last step hold the first or last value.
+     */
+    double getValue(std::size_t scenario, double time) const
+    {
+        const double* series = values + scenario * stepCount;
+        double position = (time - startTime) / timeStep;
+        if (!(position > 0.0)) return series[0];
+        if (position >= static_cast<double>(stepCount - 1)) return series[stepCount - 1];
+
+        std::size_t step = static_cast<std::size_t>(position);
+        double fraction = position - static_cast<double>(step);
+        return series[step] + fraction * (series[step + 1] - series[step]);
+    }
+
+private:
+    ForcingSeries() = default;
+
+    bool loadBinary(const std::string& filename)
+    {
+        const std::size_t headerSize = 40;
+        std::uint32_t scenarioCount = 0;
+        std::uint64_t steps = 0;
+        if (file.size() >= headerSize)
+        {
+            const char* header = file.data();
+            std::memcpy(&scenarioCount, header + 8, sizeof(scenarioCount));
+            std::memcpy(&steps, header + 16, sizeof(steps));
+            std::memcpy(&startTime, header + 24, sizeof(startTime));
+            std::memcpy(&timeStep, header + 32, sizeof(timeStep));
+        }
+
+        if (scenarioCount == 0 || steps == 0 || !(timeStep > 0.0) || !std::isfinite(startTime))
+        {
+            std::cout << "Error: Forcing file " << filename << " has an invalid binary header." << std::endl;
+            return false;
+        }
+        if ((file.size() - headerSize) / sizeof(double) / scenarioCount < steps)
+        {
+            std::cout << "Error: Forcing file " << filename << " is shorter than its header states." << std::endl;
+            return false;
+        }
+
+        //the mapping is page aligned and the header keeps the values 8-byte aligned
+        stepCount = static_cast<std::size_t>(steps);
+        values = reinterpret_cast<const double*>(file.data() + headerSize);
+        for (std::uint32_t scenario = 0; scenario < scenarioCount; ++scenario)
+        {
+            scenarioNames.push_back(std::to_string(scenario));
+        }
+        return true;
+    }
+
+    bool loadCsv(const std::string& filename)
+    {
+        auto splitLine = [](const std::string& line)
+        {
+            std::vector<std::string> cells;
+            std::stringstream ss(line);
+            std::string cell;
+            while (std::getline(ss, cell, ','))
+            {
+                cell.erase(0, cell.find_first_not_of(" \t\r"));
+                cell.erase(cell.find_last_not_of(" \t\r") + 1);
+                cells.push_back(cell);
+            }
+            return cells;
+        };
+
+        //rows are collected step-major, then transposed so every scenario is contiguous
+        std::vector<double> times;
+        std::vector<double> rows;
+        const char* cursor = file.data();
+        const char* end = file.data() + file.size();
+        while (cursor < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+            if (lineEnd == nullptr) lineEnd = end;
+            std::string line(cursor, lineEnd);
+            cursor = lineEnd + 1;
+
+            if (line.empty() || line[0] == '#' || line == "\r") continue;
+            std::vector<std::string> cells = splitLine(line);
+            if (scenarioNames.empty())
+            {
+                scenarioNames.assign(cells.begin() + 1, cells.end());
+                if (scenarioNames.empty())
+                {
+                    std::cout << "Error: Forcing file " << filename << " needs a header 'Year,<scenario>,...'." << std::endl;
+                    return false;
+                }
+                continue;
+            }
+
+            if (cells.size() != scenarioNames.size() + 1)
+            {
+                std::cout << "Error: Forcing file " << filename << " has a row with " << cells.size()
+                    << " cells, expected " << (scenarioNames.size() + 1) << "." << std::endl;
+                return false;
+            }
+            try
+            {
+                times.push_back(std::stod(cells[0]));
+                for (std::size_t scenario = 0; scenario < scenarioNames.size(); ++scenario)
+                {
+                    rows.push_back(std::stod(cells[scenario + 1]));
+                }
+            }
+            catch (std::exception&)
+            {
+                std::cout << "Error: Forcing file " << filename << " has a non-numeric value in the row '" << line << "'." << std::endl;
+                return false;
+            }
+        }
+
+        if (times.empty())
+        {
+            std::cout << "Error: Forcing file " << filename << " has no values." << std::endl;
+            return false;
+        }
+
+        startTime = times[0];
+        timeStep = (times.size() > 1) ? times[1] - times[0] : 1.0;
+        for (std::size_t step = 1; step < times.size(); ++step)
+        {
+            double expected = startTime + step * timeStep;
+            if (!(timeStep > 0.0) || std::fabs(times[step] - expected) > 1e-6 * std::max(1.0, std::fabs(expected)))
+            {
+                std::cout << "Error: Forcing file " << filename << " must have increasing, evenly spaced times." << std::endl;
+                return false;
+            }
+        }
+
+        stepCount = times.size();
+        std::size_t scenarioCount = scenarioNames.size();
+        parsedValues.resize(stepCount * scenarioCount);
+        for (std::size_t step = 0; step < stepCount; ++step)
+        {
+            for (std::size_t scenario = 0; scenario < scenarioCount; ++scenario)
+            {
+                parsedValues[scenario * stepCount + step] = rows[step * scenarioCount + scenario];
+            }
+        }
+        values = parsedValues.data();
+
+        //the text is no longer needed once parsed
+        file.close();
+        return true;
+    }
+
+    MappedFile file;
+    std::vector<double> parsedValues;
+    const double* values = nullptr;
+
+    std::vector<std::string> scenarioNames;
+    std::size_t stepCount = 0;
+    double startTime = 0.0;
+    double timeStep = 1.0;
+};
+
+/**
+ * @brief The model parameters that can be driven by an environmental time series.
+ */
+enum class ForcedParameter
+{
+    CarryingCapacity,   //simple model
+    ReproductionRate,   //simple and delay models
+    Catchability,       //delay model
+    NaturalMortality,   //age-structured model
+    Recruitment         //age-structured model, the (unfished) recruitment R0
+};
+
+/**
+ * @brief Maps a parameters.json name to a forced parameter.
+ * @return True if the name is known.
+ */
+inline bool parseForcedParameter(const std::string& name, ForcedParameter& outParameter)
+{
+    if (name == "carryingCapacity") outParameter = ForcedParameter::CarryingCapacity;
+    else if (name == "reproductionRate") outParameter = ForcedParameter::ReproductionRate;
+    else if (name == "catchability") outParameter = ForcedParameter::Catchability;
+    else if (name == "naturalMortality") outParameter = ForcedParameter::NaturalMortality;
+    else if (name == "recruitment") outParameter = ForcedParameter::Recruitment;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief Checks whether a forced parameter is used by a model (1 simple, 2 delay, 3 age-structured).
+ */
+inline bool isForcedParameterUsedBy(ForcedParameter parameter, int modelChoice)
+{
+    switch (parameter)
+    {
+    case ForcedParameter::CarryingCapacity: return modelChoice == 1;
+    case ForcedParameter::ReproductionRate: return modelChoice == 1 || modelChoice == 2;
+    case ForcedParameter::Catchability: return modelChoice == 2;
+    default: return modelChoice == 3;
+    }
+}
+
+/**
+ * @brief One parameter driven by one scenario of a forcing series.
+ */
+struct ForcingInput
+{
+    ForcedParameter parameter = ForcedParameter::NaturalMortality;
+
+    //true to multiply the parameter's loaded value by the series, false to replace it
+    bool multiply = true;
+
+    std::shared_ptr<const ForcingSeries> series;
+    std::size_t scenario = 0;
+
+    //true to give the replicates of an ensemble the scenarios in turn (replicate % scenarioCount)
+    bool cycleScenarios = false;
+
+    //the loaded value of the parameter, the base of the multiplier
+    double baseValue = 1.0;
+};
+
+/**
+ * @class EnvironmentalForcing
+ * @brief The set of forcing inputs of a run, applied to a fishery before every model step.
+ * The inputs only hold shared pointers to the series, so copying the forcing into every replicate or
+ * thread copies a few pointers, never the data.
+ */
+class EnvironmentalForcing
+{
+public:
+    void addInput(const ForcingInput& input) { inputs.push_back(input); }
+    const std::vector<ForcingInput>& getInputs() const { return inputs; }
+    bool isEmpty() const { return inputs.empty(); }
+
+    /**
+     * @brief Returns a copy whose multipliers apply to the parameter values currently loaded in the fishery.
+     */
+    EnvironmentalForcing bind(Fishery& fishery) const
+    {
+        EnvironmentalForcing bound = *this;
+        for (ForcingInput& input : bound.inputs)
+        {
+            switch (input.parameter)
+            {
+            case ForcedParameter::CarryingCapacity: input.baseValue = fishery.getSimpleCarryingCapacity(); break;
+            case ForcedParameter::ReproductionRate: input.baseValue = fishery.getSimpleReproductionRate(); break;
+            case ForcedParameter::Catchability: input.baseValue = fishery.getCatchability(); break;
+            case ForcedParameter::NaturalMortality: input.baseValue = fishery.getNaturalMortality(); break;
+            case ForcedParameter::Recruitment: input.baseValue = fishery.getConstantRecruitment(); break;
+            }
+        }
+        return bound;
+    }
+
+    /**
+     * @brief Sets every forced parameter of the fishery to its value at a simulation time.
+     * @param fishery The fishery about to be stepped from this time.
+     * @param time The time in years since the start of the simulation (fractional for sub-annual steps).
+     * @param replicate The replicate index, selecting the scenario of cycling inputs.
+     */
+    void apply(Fishery& fishery, double time, std::size_t replicate = 0) const
+    {
+        for (const ForcingInput& input : inputs)
+        {
+            std::size_t scenario = input.cycleScenarios ? replicate % input.series->getScenarioCount() : input.scenario;
+            double value = input.series->getValue(scenario, time);
+            if (input.multiply) value *= input.baseValue;
+
+            switch (input.parameter)
+            {
+            case ForcedParameter::CarryingCapacity: fishery.setSimpleCarryingCapacity(value); break;
+            case ForcedParameter::ReproductionRate: fishery.setSimpleReproductionRate(value); break;
+            case ForcedParameter::Catchability: fishery.setCatchability(value); break;
+            case ForcedParameter::NaturalMortality: fishery.setNaturalMortality(value); break;
+            case ForcedParameter::Recruitment: fishery.setConstantRecruitment(value); break;
+            }
+        }
+    }
+
+private:
+    std::vector<ForcingInput> inputs;
+};
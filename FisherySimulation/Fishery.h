@@ -1,6 +1,10 @@
 #pragma once
 
 #include "json.h"
+#include "AgeStructuredModel.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <random>
 
 class Fishery
@@ -25,16 +29,57 @@ public :
 		catchabilityStdDev = 0.0;
 		recruitmentStdDev = 0.0;
 
+		stockRecruitment = StockRecruitment::Constant;
+		steepness = 1.0;
+		recruitmentAutocorrelation = 0.0;
+		recruitmentDeviation = std::numeric_limits<double>::quiet_NaN();
+		unfishedSSB = 0.0;
+
+		antithetic = false;
+		presetIndex = 0;
+		tapeNormals = nullptr;
+		tapeLength = 0;
+		tapeIndex = 0;
+
 		std::random_device rd;
 		rng = std::mt19937(rd());
 	};
 
-	double getLogNormalRecruitment(double sigma) {
-		// create a normal distribution centered at 0
-		std::normal_distribution<double> dist(0.0, sigma);
+	//reseeds the random number generator so the following noise draws are reproducible
+	//the stream index gives independent sequences for the same seed (e.g. one per ensemble replicate)
+	void setSeed(std::uint32_t seed, std::uint32_t stream = 0)
+	{
+		std::seed_seq sequence{ seed, stream };
+		rng.seed(sequence);
+	}
+
+	//variance reduction for ensembles: the antithetic twin of a replicate uses the same stream with every
+	//standard normal draw negated, and preset draws (e.g. quasi-random points) replace the first draws of the stream
+	void setAntithetic(bool negate) { antithetic = negate; }
+	void setPresetNormals(const std::vector<double>& normals)
+	{
+		presetNormals = normals;
+		presetIndex = 0;
+	}
+
+	//common random numbers: the draws are read from a noise tape held elsewhere (e.g. a memory-mapped file shared
+	//by every scenario) instead of the generator, for the first count draws; the tape must outlive the draws
+	void setNoiseTape(const double* normals, std::size_t count)
+	{
+		tapeNormals = normals;
+		tapeLength = count;
+		tapeIndex = 0;
+	}
 
-		// calculate the random fluctuation
-		double fluctuation = dist(rng);
+	//fills out with the next count standard normal draws of the stream (e.g. to record a noise tape)
+	void fillStandardNormals(double* out, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i) out[i] = drawStandardNormal();
+	}
+
+	double getLogNormalRecruitment(double sigma) {
+		// calculate the random fluctuation, normally distributed around 0
+		double fluctuation = sigma * drawStandardNormal();
 
 		// Apply Log-Normal noise: Recruitment = Constant * e^(fluctuation)
 		return constantRecruitment * std::exp(fluctuation);
@@ -45,8 +90,7 @@ public :
 	 * @param sigma The standard deviation (e.g., 0.1 for 10% variability).
 	 */
 	double getStochasticMultiplier(double sigma) {
-		std::normal_distribution<double> dist(1.0, sigma);
-		double val = dist(rng);
+		double val = 1.0 + sigma * drawStandardNormal();
 		// Safety clamp to prevent negative biology (optional but recommended)
 		return (val < 0.0) ? 0.0 : val;
 	}
@@ -83,8 +127,46 @@ public :
 		maturity_k = matk;
 		constantRecruitment = constR;
 		numbersAtAge.resize(maxAge + 1, 0.0);
+		updateAgeTables();
+	}
+
+	/**
+	 * @brief Sets the stock-recruitment relationship; constantRecruitment acts as the unfished recruitment R0.
+	 * @param type The relationship between the spawning stock biomass and the expected recruitment.
+	 * @param h The steepness, the fraction of R0 produced at 20% of the unfished SSB.
+	 */
+	void setStockRecruitment(StockRecruitment type, double h)
+	{
+		stockRecruitment = type;
+		steepness = h;
+		updateAgeTables();
 	}
 
+	/**
+	 * @brief Changes the natural mortality between steps (e.g. from an environmental forcing).
+	 * The unfished SSB of the stock-recruitment relationship stays at its value for the loaded parameters.
+	 */
+	void setNaturalMortality(double M) { naturalMortality = M; }
+
+	/**
+	 * @brief Changes the (unfished) recruitment between steps (e.g. from an environmental forcing).
+	 * The unfished SSB stays at its value for the loaded parameters, so every stock-recruitment
+	 * relationship is scaled by the same factor at any spawning stock.
+	 */
+	void setConstantRecruitment(double R) { constantRecruitment = R; }
+
+	StockRecruitment getStockRecruitment() const { return stockRecruitment; }
+	double getSteepness() const { return steepness; }
+	double getUnfishedSSB() const { return unfishedSSB; }
+
+	//the lag-1 autocorrelation of the log recruitment deviations
+	void setRecruitmentAutocorrelation(double rho) { recruitmentAutocorrelation = rho; }
+	double getRecruitmentAutocorrelation() const { return recruitmentAutocorrelation; }
+
+	//forgets the last recruitment deviation, so the next one is drawn from the stationary distribution (e.g. at the
+	//start of a new episode)
+	void resetRecruitmentDeviation() { recruitmentDeviation = std::numeric_limits<double>::quiet_NaN(); }
+
 	/**
 	 * @brief Sets the initial population numbers for each age class.
 	 */
@@ -109,8 +191,7 @@ public :
 	 */
 	double getWeightAtAge(int age) const 
 	{
-		double length = vb_Linf * (1.0 - std::exp(-vb_k * (age - vb_t0)));
-		return lw_a * std::pow(length, lw_b);
+		return ::getWeightAtAge(age, vb_Linf, vb_k, vb_t0, lw_a, lw_b);
 	}
 
 	/**
@@ -118,7 +199,7 @@ public :
 	 */
 	double getMaturityAtAge(int age) const 
 	{
-		return 1.0 / (1.0 + std::exp(-maturity_k * (age - maturity_A50)));
+		return getLogisticAtAge(age, maturity_A50, maturity_k);
 	}
 
 	/**
@@ -129,7 +210,7 @@ public :
 		double totalBiomass = 0.0;
 		for (int age = 0; age <= maxAge; ++age) 
 		{
-			totalBiomass += numbersAtAge[age] * getWeightAtAge(age);
+			totalBiomass += numbersAtAge[age] * weightAtAge[age];
 		}
 		return totalBiomass;
 	}
@@ -142,7 +223,7 @@ public :
 		double ssb = 0.0;
 		for (int age = 0; age <= maxAge; ++age) 
 		{
-			ssb += numbersAtAge[age] * getWeightAtAge(age) * getMaturityAtAge(age);
+			ssb += numbersAtAge[age] * weightAtAge[age] * maturityAtAge[age];
 		}
 		return ssb;
 	}
@@ -150,6 +231,13 @@ public :
 	int getMaxAge() const { return maxAge; }
 	double getNaturalMortality() const { return naturalMortality; }
 	double getConstantRecruitment() const { return constantRecruitment; }
+	double getVbLinf() const { return vb_Linf; }
+	double getVbK() const { return vb_k; }
+	double getVbT0() const { return vb_t0; }
+	double getLwA() const { return lw_a; }
+	double getLwB() const { return lw_b; }
+	double getMaturityA50() const { return maturity_A50; }
+	double getMaturityK() const { return maturity_k; }
 
 	void setReproductionStdDev(double sigma) { reproductionStdDev = sigma; }
 	double getReproductionStdDev() const { return reproductionStdDev; }
@@ -165,21 +253,67 @@ public :
 	double getNoisyMultiplier(double sigma)
 	{
 		if (sigma <= 0.0) return 1.0; // Deterministic fallback
-		std::normal_distribution<double> dist(1.0, sigma);
-		double val = dist(rng);
+		double val = 1.0 + sigma * drawStandardNormal();
 		return (val < 0.0) ? 0.0 : val; // Clamp to 0 to prevent negative biology
 	}
 
-	//returns a recruitment R ~ LogNormal(ln(recruitment), sigma)
+	//returns a recruitment R ~ LogNormal(ln(expected recruitment), sigma) for the current spawning stock
 	//used for age-structured model
 	double getNoisyRecruitment()
 	{
-		if (recruitmentStdDev <= 0.0) return constantRecruitment;
+		double expected = (stockRecruitment == StockRecruitment::Constant) ? constantRecruitment : getExpectedRecruitment(getSpawningStockBiomass());
+		if (recruitmentStdDev <= 0.0) return expected;
+
+		return expected * getRecruitmentMultiplier();
+	}
+
+	//returns a noisy recruitment for a spawning stock biomass computed elsewhere (e.g. by another model form)
+	double getRecruitment(double ssb)
+	{
+		return getExpectedRecruitment(ssb) * getRecruitmentMultiplier();
+	}
+
+	//returns the stock-recruitment relationship at the given spawning stock biomass, without noise
+	double getExpectedRecruitment(double ssb) const
+	{
+		return getExpectedRecruitment(ssb, unfishedSSB);
+	}
+
+	//as getExpectedRecruitment(ssb), scaled by the unfished spawning stock biomass of another model form
+	//(e.g. the length-structured model), whose spawning stock differs from the age model's
+	double getExpectedRecruitment(double ssb, double unfishedSpawningBiomass) const
+	{
+		AgeModelParameters<double> params;
+		params.constantRecruitment = constantRecruitment;
+		params.stockRecruitment = stockRecruitment;
+		params.steepness = steepness;
+		return ::getExpectedRecruitment(ssb, params, unfishedSpawningBiomass);
+	}
+
+	//returns the log-normal recruitment deviation e^X, where X is a stationary AR(1) process with standard deviation sigma
+	//without autocorrelation X ~ Normal(0, sigma), and getNoisyRecruitment() == constantRecruitment * getRecruitmentMultiplier()
+	double getRecruitmentMultiplier()
+	{
+		return getRecruitmentMultiplier(recruitmentDeviation);
+	}
+
+	//as getRecruitmentMultiplier(), for an AR(1) deviation held outside the fishery (e.g. one per particle of a particle filter)
+	//the deviation is advanced in place; NaN means no deviation has been drawn yet, so the first one comes from the
+	//stationary distribution Normal(0, sigma) rather than a process started at 0
+	double getRecruitmentMultiplier(double& deviation)
+	{
+		if (recruitmentStdDev <= 0.0) return 1.0;
 
 		//log-normal formulation
-		//we want the median to be constantRecruitment, so we center the underlying normal at 0
-		std::normal_distribution<double> dist(0.0, recruitmentStdDev);
-		return constantRecruitment * std::exp(dist(rng));
+		//we want the median to be the expected recruitment, so we center the underlying normal at 0
+		double innovation = recruitmentStdDev * drawStandardNormal();
+		if (recruitmentAutocorrelation != 0.0 && !std::isnan(deviation))
+		{
+			double rho = recruitmentAutocorrelation;
+			innovation = rho * deviation + std::sqrt(1.0 - rho * rho) * innovation;
+		}
+		deviation = innovation;
+		return std::exp(deviation);
 	}
 
 private:
@@ -241,6 +375,87 @@ private:
 	double catchabilityStdDev;
 	double recruitmentStdDev;
 
+	//Stock-Recruitment Variables
+
+	//the relationship between spawning stock biomass and recruitment, and its steepness
+	StockRecruitment stockRecruitment;
+	double steepness;
+
+	//the lag-1 autocorrelation of the log recruitment deviations, and the last deviation drawn (NaN before the first)
+	double recruitmentAutocorrelation;
+	double recruitmentDeviation;
+
+	//cached weight and maturity at age, so the yearly biomass and SSB sums need no exp/pow calls
+	std::vector<double> weightAtAge;
+	std::vector<double> maturityAtAge;
+
+	//the unfished spawning stock biomass SSB0, the scale of the stock-recruitment relationship
+	double unfishedSSB;
+
+	//rebuilds the cached tables after a change of the biological or stock-recruitment parameters
+	void updateAgeTables()
+	{
+		weightAtAge.assign(maxAge + 1, 0.0);
+		maturityAtAge.assign(maxAge + 1, 0.0);
+		for (int age = 0; age <= maxAge; ++age)
+		{
+			weightAtAge[age] = getWeightAtAge(age);
+			maturityAtAge[age] = getMaturityAtAge(age);
+		}
+
+		AgeModelParameters<double> params;
+		params.maxAge = maxAge;
+		params.naturalMortality = naturalMortality;
+		params.vb_Linf = vb_Linf;
+		params.vb_k = vb_k;
+		params.vb_t0 = vb_t0;
+		params.lw_a = lw_a;
+		params.lw_b = lw_b;
+		params.maturity_A50 = maturity_A50;
+		params.maturity_k = maturity_k;
+		params.constantRecruitment = constantRecruitment;
+		unfishedSSB = getUnfishedSpawningStockBiomass(params);
+	}
+
+	//variance reduction state, see setAntithetic, setPresetNormals and setNoiseTape
+	bool antithetic;
+	std::vector<double> presetNormals;
+	std::size_t presetIndex;
+	const double* tapeNormals;
+	std::size_t tapeLength;
+	std::size_t tapeIndex;
+
+	//every noise term is a transformed standard normal draw, so the variance reduction applies to all of them
+	double drawStandardNormal()
+	{
+		double z;
+		if (presetIndex < presetNormals.size())
+		{
+			z = presetNormals[presetIndex++];
+		}
+		else if (tapeIndex < tapeLength)
+		{
+			z = tapeNormals[tapeIndex++];
+		}
+		else
+		{
+			//Box-Muller on the raw generator output: the algorithm of std::normal_distribution differs between standard
+			//libraries, while mt19937 itself is fully specified, so seeded runs draw the same noise on every platform
+			double radius = std::sqrt(-2.0 * std::log(drawOpenUniform()));
+			double angle = 6.283185307179586 * drawOpenUniform();
+			z = radius * std::cos(angle);
+		}
+		return antithetic ? -z : z;
+	}
+
+	//uniform in (0, 1) from the top 53 bits of two generator outputs, drawn in sequence
+	double drawOpenUniform()
+	{
+		std::uint32_t high = static_cast<std::uint32_t>(rng()) >> 5;
+		std::uint32_t low = static_cast<std::uint32_t>(rng()) >> 6;
+		return (high * 67108864.0 + low + 0.5) / 9007199254740992.0;
+	}
+
 	//rng seed
 	std::mt19937 rng;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * @file FisheryEnvironment.h
+ * @brief A C interface to step a batch of independent fisheries, e.g. from a reinforcement learning trainer
+ * in another language.
+ *
+ * An environment holds batchSize instances of one model, loaded from a parameters.json document. Every call to
+ * fishery_env_step applies one action per instance and advances all of them by one year:
+ *   - simpleModel: the action is the harvest rate (tons per year), the reward the harvest actually taken.
+ *   - delayModel: the action is the harvesting effort E, held for the stepsPerYear steps of the year, and the
+ *     reward the catch of the year.
+ *   - ageStructuredModel: the action is the fishing mortality F, and the reward the catch in biomass.
+ * Negative actions are treated as 0.
+ *
+ * The observations of an instance are contiguous, observations[instance * observationSize + i]:
+ *   - simpleModel: the fish stock.
+ *   - delayModel: the population n, the effort E of the last action and the market stock S.
+ *   - ageStructuredModel: the total biomass, the spawning stock biomass, then the numbers at age 0..maxAge.
+ *
+ * An episode ends after episodeYears steps, or when the stock is exhausted. The instance is then reset at once
+ * (auto-reset): its done flag is 1, its reward is that of the final step, and its observations are those of the
+ * start of the next episode, whose recruitment deviations are independent of the previous one. Stepping allocates no memory, and large batches are stepped in parallel. Each
+ * instance draws its noise from its own stream of the seed, so the results do not depend on the thread count.
+ *
+ * A NULL environment or buffer is rejected: the function does nothing (the size queries return 0) and sets the
+ * message of fishery_env_last_error.
+ *
+ * The functions are implemented in FisherySimulation.cpp. Define FISHERY_ENV_LIBRARY when compiling it to leave
+ * out the console program and build a shared library instead.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(FISHERY_ENV_LIBRARY)
+#define FISHERY_ENV_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(FISHERY_ENV_IMPORT)
+#define FISHERY_ENV_API __declspec(dllimport)
+#else
+#define FISHERY_ENV_API
+#endif
+
+typedef struct FisheryEnvironment FisheryEnvironment;
+
+/**
+ * @brief Creates an environment.
+ * @param parametersJson The text of a parameters.json document.
+ * @param modelName "simpleModel", "delayModel" or "ageStructuredModel".
+ * @param batchSize The number of instances.
+ * @param episodeYears The length of an episode, or 0 for the simulationYears of the model.
+ * @param seed The seed of the noise streams.
+ * @return The environment, or NULL on an error (see fishery_env_last_error).
+ */
+FISHERY_ENV_API FisheryEnvironment* fishery_env_create(const char* parametersJson, const char* modelName, int batchSize, int episodeYears, unsigned int seed);
+
+/**
+ * @brief Destroys an environment created by fishery_env_create. Accepts NULL.
+ */
+FISHERY_ENV_API void fishery_env_destroy(FisheryEnvironment* env);
+
+/**
+ * @brief The number of instances of the environment.
+ */
+FISHERY_ENV_API int fishery_env_batch_size(const FisheryEnvironment* env);
+
+/**
+ * @brief The number of observations per instance.
+ */
+FISHERY_ENV_API int fishery_env_observation_size(const FisheryEnvironment* env);
+
+/**
+ * @brief Starts a new episode in every instance.
+ * @param observations (Output) batchSize * observationSize values.
+ */
+FISHERY_ENV_API void fishery_env_reset(FisheryEnvironment* env, double* observations);
+
+/**
+ * @brief Steps every instance by one year.
+ * @param actions batchSize actions.
+ * @param observations (Output) batchSize * observationSize values.
+ * @param rewards (Output) batchSize rewards.
+ * @param dones (Output) batchSize flags, 1 where an episode ended and the instance was reset.
+ */
+FISHERY_ENV_API void fishery_env_step(FisheryEnvironment* env, const double* actions, double* observations, double* rewards, unsigned char* dones);
+
+/**
+ * @brief The message of the last error on the calling thread, or an empty string.
+ */
+FISHERY_ENV_API const char* fishery_env_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
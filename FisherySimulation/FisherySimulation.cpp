@@ -3,7 +3,33 @@
 #include "Fishery.h"
 #include "FishingIndustry.h"
 #include "CSVManager.h"
+#include "Dual.h"
+#include "EnvironmentalForcing.h"
+#include "FisheryEnvironment.h"
+#include "FixedAgeModel.h"
+#include "HarvestPolicy.h"
+#include "IndividualBasedModel.h"
+#include "LengthStructuredModel.h"
+#include "LeslieMatrix.h"
+#include "ModelFitting.h"
+#include "MultiFleetModel.h"
+#include "MultilevelSplitting.h"
+#include "MultiSpeciesModel.h"
+#include "NoiseTape.h"
+#include "ParticleFilter.h"
+#include "RegressionCheck.h"
+#include "OnlineStatistics.h"
+#include "SeasonalAgeModel.h"
+#include "SensitivityAnalysis.h"
+#include "SpatialModel.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+#include "VarianceReduction.h"
+#include <atomic>
 #include <chrono>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <sstream> 
 #include "json.h" //slightly modified nlohmann json all-in-one header
 
@@ -17,6 +43,16 @@
 
 using json = nlohmann::json;
 
+/**
+ * @brief Seeds the noise of a model from its optional "seed" key, so single runs can be reproduced.
+ * A missing seed or 0 keeps the random seed of the fishery.
+ */
+void loadModelSeed(const json& modelParams, Fishery& fishery)
+{
+    std::uint32_t seed = modelParams.contains("seed") ? modelParams.at("seed").get<std::uint32_t>() : 0;
+    if (seed != 0) fishery.setSeed(seed);
+}
+
 /**
  * @brief Loads simulation parameters from a JSON file.
  * @param filename The name of the JSON configuration file.
@@ -39,6 +75,7 @@ bool loadParametersFromJSON(const json& params, Fishery& fishery, FishingIndustr
             fishery.setFishStock(modelParams.at("initialFishStock").get<double>());
             industry.setSimpleHarvestRate(modelParams.at("harvestRate").get<double>());
             fishery.setReproductionStdDev(modelParams.at("reproductionStdDev").get<double>());
+            loadModelSeed(modelParams, fishery);
         }
         else if (modelChoice == 2) 
         {
@@ -55,6 +92,7 @@ bool loadParametersFromJSON(const json& params, Fishery& fishery, FishingIndustr
             industry.setHarvestingEffort(modelParams.at("initialHarvestingEffort").get<double>());
             industry.setFishMarketStock(modelParams.at("initialFishMarketStock").get<double>());
             fishery.setCatchabilityStdDev(modelParams.at("catchabilityStdDev").get<double>());
+            loadModelSeed(modelParams, fishery);
         }
         else if (modelChoice == 3) 
         {
@@ -77,6 +115,37 @@ bool loadParametersFromJSON(const json& params, Fishery& fishery, FishingIndustr
 
             fishery.setRecruitmentStdDev(modelParams.at("recruitmentStdDev").get<double>());
 
+            //the recruitment keys are optional and default to independent deviations around constant recruitment
+            if (modelParams.contains("recruitmentAutocorrelation"))
+            {
+                double recruitmentAutocorrelation = modelParams.at("recruitmentAutocorrelation").get<double>();
+                if (!(std::fabs(recruitmentAutocorrelation) < 1.0))
+                {
+                    std::cout << "Error: 'recruitmentAutocorrelation' must lie in (-1, 1)." << std::endl;
+                    return false;
+                }
+                fishery.setRecruitmentAutocorrelation(recruitmentAutocorrelation);
+            }
+
+            StockRecruitment stockRecruitment = StockRecruitment::Constant;
+            std::string stockRecruitmentName = modelParams.contains("stockRecruitment") ? modelParams.at("stockRecruitment").get<std::string>() : "constant";
+            if (!parseStockRecruitment(stockRecruitmentName, stockRecruitment))
+            {
+                std::cout << "Error: Unknown stockRecruitment '" << stockRecruitmentName
+                    << "'. Use constant, bevertonHolt, ricker or hockeyStick." << std::endl;
+                return false;
+            }
+            double steepness = 1.0;
+            if (modelParams.contains("steepness"))
+            {
+                steepness = modelParams.at("steepness").get<double>();
+                if (stockRecruitment != StockRecruitment::Constant && !(steepness > 0.2 && (steepness <= 1.0 || stockRecruitment == StockRecruitment::Ricker)))
+                {
+                    std::cout << "Error: 'steepness' must lie in (0.2, 1] (above 0.2 for ricker)." << std::endl;
+                    return false;
+                }
+            }
+
             industry.setAgeModelParams(
                 modelParams.at("fishingMortality").get<double>(),
                 modelParams.at("selectivity_A50").get<double>(),
@@ -90,201 +159,5136 @@ bool loadParametersFromJSON(const json& params, Fishery& fishery, FishingIndustr
                     << ") does not match 'maxAge' + 1 (" << (maxAge + 1) << ")." << std::endl;
                 return false;
             }
-            fishery.setInitialNumbers(initialNumbers);
+            fishery.setInitialNumbers(initialNumbers);
+            fishery.setStockRecruitment(stockRecruitment, steepness);
+            loadModelSeed(modelParams, fishery);
+        }
+        return true;
+    }
+    catch (json::parse_error& e) 
+    {
+        std::cout << "Error: Failed to parse JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+    catch (json::exception& e) 
+    {
+        std::cout << "Error: Missing parameter in JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+    catch (std::exception& e) 
+    {
+        std::cout << "An unexpected error occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/**
+ * @brief Gets the current working directory.
+ * @return A string with the path to the current working directory.
+ */
+std::string getCurrentWorkingDirectory() 
+{
+    char buff[FILENAME_MAX];
+    if (GetCurrentDir(buff, FILENAME_MAX)) 
+    {
+        std::string current_working_dir(buff);
+        return current_working_dir;
+    }
+    //return a fallback message if CWD can't be found
+    return "[current application directory]";
+}
+
+/**
+ * @brief Gets the current date and time as a string for filenames.
+ * @return A string formatted as YYYYMMDD_HHMMSS.
+ */
+std::string getCurrentTimestamp() 
+{
+    auto now = std::chrono::system_clock::now();
+    auto in_time_t = std::chrono::system_clock::to_time_t(now);
+
+    std::stringstream ss;
+    std::tm buf;
+
+#ifdef _WIN32
+    localtime_s(&buf, &in_time_t); //windows
+#else
+    localtime_r(&in_time_t, &buf); //POSIX
+#endif
+
+    ss << std::put_time(&buf, "%Y%m%d_%H%M%S");
+    return ss.str();
+}
+
+/**
+ * @brief Gets the current date and time as a human-readable string for logging.
+ * @return A string formatted as YYYY-MM-DD HH:MM:SS
+ */
+std::string getReadableTimestamp() 
+{
+    auto now = std::chrono::system_clock::now();
+    auto in_time_t = std::chrono::system_clock::to_time_t(now);
+    std::stringstream ss;
+    std::tm buf;
+
+#ifdef _WIN32
+    localtime_s(&buf, &in_time_t); //windows
+#else
+    localtime_r(&in_time_t, &buf); //posix
+#endif
+
+    ss << std::put_time(&buf, "%Y-%m-%d %H:%M:%S");
+    return ss.str();
+}
+
+/*  @brief Simulates a growth and harvesting step in the fishery
+*   This function utilizes a basic model with a logistic growth simulation
+*   Calculates the natural growth of the fish population for a step, then
+*   subtracts the harvested fish stock. Templated on the scalar type of the state.
+*   @param stock The fish stock at the start of the step
+*   @param noise The multiplicative noise on the reproduction rate
+*/
+template <typename T>
+T SimpleModelGrowthAmount(const T& stock, const T& reproductionRate, const T& carryingCapacity, const T& harvestRate, const T& noise)
+{
+    //apply noise to reproduction rate
+    T noisyRate = reproductionRate * noise;
+
+    //calculate the natural growth of the fish stock
+    T naturalGrowth = noisyRate * stock * (1 - stock / carryingCapacity);
+
+    //calculate the impact of harvesting on the fish stock
+    //this number CAN be negative
+    T finalGrowth = naturalGrowth - harvestRate;
+
+    return finalGrowth;
+}
+
+/*  @brief Calculates the change in fish stock for a step in the simple model
+*   @param fishery The fishery being simulated
+*   @param fishingindustry The fishing industry harvesting from the fishery
+*/
+double SimpleModelGrowthAmount(Fishery& fishery, FishingIndustry& fishingindustry)
+{
+    double noise = fishery.getNoisyMultiplier(fishery.getReproductionStdDev());
+    return SimpleModelGrowthAmount(fishery.getFishStock(), fishery.getSimpleReproductionRate(), fishery.getSimpleCarryingCapacity(),
+        fishingindustry.getSimpleHarvestRate(), noise);
+}
+
+/*  @brief Simulates a growth and harvesting step of the delay equations for any scalar type
+*   The parameters are read from the fishery and fishing industry, the state is held in T.
+*   @param n The fish stock, E the harvesting effort and S the market stock, updated in place
+*   @param noise The multiplicative noise on the catchability
+*   @return The catch rate qnE of the step
+*/
+template <typename T>
+T DelayEquationModelStep(T& n, T& E, T& S, Fishery& fishery, FishingIndustry& fishingindustry, const T& noise, const T& timeStep)
+{
+    //step catch - equation 1
+    T currentCatch = (T(fishery.getCatchability()) * noise) * n * E;
+
+    //calculate the rate of change for each variable
+    //dn/dt = rn(1-n) - qnE
+    T dn_dt = T(fishery.getSimpleReproductionRate()) * n * (1 - n) - currentCatch;
+
+    //dE/dt = p((1-η)qnE + δS) - cE
+    T dE_dt = T(fishingindustry.getFishPrice()) * ((1 - T(fishingindustry.getCatchStockingRate())) * currentCatch + T(fishingindustry.getStockReturnRate()) * S) - T(fishingindustry.getFishingCost()) * E;
+
+    //dS/dt = ηqnE - δS
+    T dS_dt = T(fishingindustry.getCatchStockingRate()) * currentCatch - T(fishingindustry.getStockReturnRate()) * S;
+
+    //update the state variables using a simple forward Euler step (assuming Δt = 1).
+    n = std::max(T(0.0), n + dn_dt * timeStep);
+    E = std::max(T(0.0), E + dE_dt * timeStep);
+    S = std::max(T(0.0), S + dS_dt * timeStep);
+
+    return currentCatch;
+}
+
+/*  @brief Simulates a growth and harvesting step in the fishery
+*   This function implements a system of delay equations
+*   @param fishery The fishery being simulated
+*   @param fishingindustry The fishing industry harvesting from the fishery
+*/
+void DelayEquationModelStep(Fishery& fishery, FishingIndustry& fishingindustry, double timeStep)
+{
+    double noise = fishery.getNoisyMultiplier(fishery.getCatchabilityStdDev());
+
+    double n = fishery.getFishStock();
+    double E = fishingindustry.getHarvestingEffort();
+    double S = fishingindustry.getFishMarketStock();
+    DelayEquationModelStep(n, E, S, fishery, fishingindustry, noise, timeStep);
+
+    fishery.setFishStock(n);
+    fishingindustry.setHarvestingEffort(E);
+    fishingindustry.setFishMarketStock(S);
+
+    return;
+}
+
+/**
+ * @brief Collects the age-structured model parameters of a fishery and fishing industry, in the scalar type T.
+ */
+template <typename T = double>
+AgeModelParameters<T> getAgeModelParameters(const Fishery& fishery, const FishingIndustry& industry)
+{
+    AgeModelParameters<T> params;
+    params.maxAge = fishery.getMaxAge();
+    params.naturalMortality = T(fishery.getNaturalMortality());
+    params.fishingMortality = T(industry.getFishingMortality());
+    params.vb_Linf = T(fishery.getVbLinf());
+    params.vb_k = T(fishery.getVbK());
+    params.vb_t0 = T(fishery.getVbT0());
+    params.lw_a = T(fishery.getLwA());
+    params.lw_b = T(fishery.getLwB());
+    params.maturity_A50 = T(fishery.getMaturityA50());
+    params.maturity_k = T(fishery.getMaturityK());
+    params.selectivity_A50 = T(industry.getSelectivityA50());
+    params.selectivity_k = T(industry.getSelectivityK());
+    params.constantRecruitment = T(fishery.getConstantRecruitment());
+    params.stockRecruitment = fishery.getStockRecruitment();
+    params.steepness = T(fishery.getSteepness());
+    return params;
+}
+
+/**
+ * @brief Simulates one year step of the Age-Structured Model.
+ * Wraps the scalar-generic step in AgeStructuredModel.h with the state and noise of the fishery.
+ * @param fishery The fishery object (contains state and bio params).
+ * @param industry The industry object (contains fishing params).
+ * @return The total catch in biomass for the year.
+ */
+double AgeStructuredModelStep(Fishery& fishery, const FishingIndustry& industry) 
+{
+    std::vector<double> numbersAtAge = fishery.getNumbersAtAge();
+
+    //fish reproduction (new log-normal noisy recruitment)
+    double recruitment = fishery.getNoisyRecruitment();
+    double totalCatchBiomass = AgeStructuredModelStep(numbersAtAge, getAgeModelParameters(fishery, industry), recruitment);
+    fishery.setNumbersAtAge(numbersAtAge);
+
+    return totalCatchBiomass;
+}
+
+/**
+ * @brief Simulates one year step of the Age-Structured Model from tabulated rates, with the totals of the new
+ * numbers reduced in the same sweep over ages. Gives the same results as AgeStructuredModelStep followed by
+ * Fishery::getTotalBiomass and getSpawningStockBiomass.
+ * @param tables The rates of the fishery, retabulated here if its mortality changed (e.g. by environmental forcing).
+ * @param ssb The spawning stock biomass at the start of the year, from the totals of the previous step.
+ * @return The biomass and SSB at the end of the year, and the catch in numbers and biomass of the year.
+ */
+AgeStepTotals<double> AgeStructuredModelStep(Fishery& fishery, const FishingIndustry& industry, AgeModelTables<double>& tables, double ssb)
+{
+    tables.setMortality(fishery.getNaturalMortality(), industry.getFishingMortality());
+    std::vector<double> numbersAtAge = fishery.getNumbersAtAge();
+
+    //fish reproduction (new log-normal noisy recruitment)
+    double recruitment = fishery.getRecruitment(ssb);
+    AgeStepTotals<double> totals = tables.step(numbersAtAge.data(), recruitment);
+    fishery.setNumbersAtAge(numbersAtAge);
+
+    return totals;
+}
+
+/**
+ * @brief Loads the environmental forcing inputs of a model from the optional "environmentalForcing" section.
+ * Each input drives one parameter from one scenario of a forcing file (binary or CSV, see ForcingSeries).
+ * Inputs whose parameter is not used by the model are skipped, and every file is loaded once and shared
+ * by all the inputs that read it.
+ * @param params The parameter json.
+ * @param modelChoice 1 for Simple Model, 2 for Delay Model, 3 for Age-Structured Model.
+ * @param outForcing (Output) The forcing of the model, empty if the section is missing or disabled.
+ * @return True if the section is absent or valid, false otherwise.
+ */
+bool loadEnvironmentalForcing(const json& params, int modelChoice, EnvironmentalForcing& outForcing)
+{
+    outForcing = EnvironmentalForcing();
+    if (!params.contains("environmentalForcing")) return true;
+
+    try
+    {
+        auto forcingParams = params.at("environmentalForcing");
+        if (!forcingParams.at("enabled").get<bool>()) return true;
+
+        std::map<std::string, std::shared_ptr<const ForcingSeries>> loadedFiles;
+        for (auto& inputParams : forcingParams.at("inputs"))
+        {
+            ForcingInput input;
+            std::string parameterName = inputParams.at("parameter").get<std::string>();
+            if (!parseForcedParameter(parameterName, input.parameter))
+            {
+                std::cout << "Error: Unknown forcing parameter '" << parameterName
+                    << "'. Use carryingCapacity, reproductionRate, catchability, naturalMortality or recruitment." << std::endl;
+                return false;
+            }
+            if (!isForcedParameterUsedBy(input.parameter, modelChoice)) continue;
+
+            std::string mode = inputParams.at("mode").get<std::string>();
+            if (mode != "multiply" && mode != "replace")
+            {
+                std::cout << "Error: Forcing mode of '" << parameterName << "' must be multiply or replace." << std::endl;
+                return false;
+            }
+            input.multiply = (mode == "multiply");
+
+            std::string filename = inputParams.at("file").get<std::string>();
+            auto loaded = loadedFiles.find(filename);
+            if (loaded == loadedFiles.end())
+            {
+                std::shared_ptr<const ForcingSeries> series = ForcingSeries::load(filename);
+                if (!series) return false;
+                loaded = loadedFiles.emplace(filename, series).first;
+            }
+            input.series = loaded->second;
+
+            //a scenario is a column name, an index, or "all" to cycle through the scenarios over replicates
+            const json& scenario = inputParams.at("scenario");
+            if (scenario.is_number_integer())
+            {
+                int index = scenario.get<int>();
+                if (index < 0 || index >= static_cast<int>(input.series->getScenarioCount()))
+                {
+                    std::cout << "Error: Forcing file " << filename << " has no scenario " << index << "." << std::endl;
+                    return false;
+                }
+                input.scenario = static_cast<std::size_t>(index);
+            }
+            else if (scenario.get<std::string>() == "all")
+            {
+                input.cycleScenarios = true;
+            }
+            else
+            {
+                int index = input.series->findScenario(scenario.get<std::string>());
+                if (index < 0)
+                {
+                    std::cout << "Error: Forcing file " << filename << " has no scenario named '" << scenario.get<std::string>() << "'." << std::endl;
+                    return false;
+                }
+                input.scenario = static_cast<std::size_t>(index);
+            }
+
+            outForcing.addInput(input);
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing environmental forcing parameter in JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes one comment line per forcing input to a simulation log.
+ */
+void logEnvironmentalForcing(CSVManager& logger, const json& params, const EnvironmentalForcing& forcing)
+{
+    if (forcing.isEmpty()) return;
+
+    logger.writeComment("Environmental forcing: ");
+    std::stringstream ss;
+    ss << params.at("environmentalForcing").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+}
+
+/**
+ * @brief Maps a parameters.json model section name to the model choice used by loadParametersFromJSON.
+ * @return 1, 2 or 3, or 0 if the name is not a known model section.
+ */
+int getModelChoiceFromName(const std::string& modelName)
+{
+    if (modelName == "simpleModel") return 1;
+    if (modelName == "delayModel") return 2;
+    if (modelName == "ageStructuredModel") return 3;
+    return 0;
+}
+
+/**
+ * @brief Summary statistics of a single model run, used by the analysis modes.
+ * For the simple and delay models the stock is the fish stock, for the age-structured model it is the total biomass.
+ * SSB and catch are only produced by the age-structured model.
+ */
+struct ModelRunSummary
+{
+    double finalStock = 0.0;
+    double meanStock = 0.0;
+    double finalSSB = 0.0;
+    double meanSSB = 0.0;
+    double meanCatch = 0.0;
+};
+
+/**
+ * @brief Checks that an output name is one of the ModelRunSummary fields available for the given model.
+ */
+bool isValidModelOutput(int modelChoice, const std::string& output)
+{
+    if (output == "finalStock" || output == "meanStock") return true;
+    if (output == "finalSSB" || output == "meanSSB" || output == "meanCatch") return modelChoice == 3;
+    return false;
+}
+
+/**
+ * @brief Selects a named output from a run summary. The name must pass isValidModelOutput.
+ */
+double getModelOutput(const ModelRunSummary& summary, const std::string& output)
+{
+    if (output == "finalStock") return summary.finalStock;
+    if (output == "meanStock") return summary.meanStock;
+    if (output == "finalSSB") return summary.finalSSB;
+    if (output == "meanSSB") return summary.meanSSB;
+    return summary.meanCatch;
+}
+
+/**
+ * @brief Runs a model without console output or CSV logging.
+ * Mirrors the simulation loops in main(), with the yearly values averaged over the simulated years.
+ * @param params The parameter json, containing at least the section of the chosen model.
+ * @param modelChoice 1 for Simple Model, 2 for Delay Model, 3 for Age-Structured Model.
+ * @param outSummary (Output) The summary of the run.
+ * @param forcing (Optional) The environmental forcing of the model, applied relative to the loaded parameters.
+ * @return True if the parameters were loaded and the model was run, false otherwise.
+ */
+bool runHeadlessSimulation(const json& params, int modelChoice, ModelRunSummary& outSummary, const EnvironmentalForcing* forcing = nullptr)
+{
+    Fishery fishery = Fishery();
+    FishingIndustry industry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+
+    if (!loadParametersFromJSON(params, fishery, industry, modelChoice, simulationYears, stepsPerYear)) return false;
+    EnvironmentalForcing boundForcing = forcing ? forcing->bind(fishery) : EnvironmentalForcing();
+
+    outSummary = ModelRunSummary();
+    if (simulationYears <= 0) return true;
+
+    if (modelChoice == 1)
+    {
+        for (int year = 1; year <= simulationYears; ++year)
+        {
+            boundForcing.apply(fishery, year - 1);
+            double growth = SimpleModelGrowthAmount(fishery, industry);
+            fishery.setFishStock(std::max(0.0, fishery.getFishStock() + growth));
+            outSummary.meanStock += fishery.getFishStock();
+        }
+        outSummary.finalStock = fishery.getFishStock();
+    }
+    else if (modelChoice == 2)
+    {
+        double timeStep = 1.0 / stepsPerYear;
+        for (int year = 1; year <= simulationYears; ++year)
+        {
+            for (int i = 0; i < stepsPerYear; ++i)
+            {
+                boundForcing.apply(fishery, (year - 1) + i * timeStep);
+                DelayEquationModelStep(fishery, industry, timeStep);
+            }
+            outSummary.meanStock += fishery.getFishStock();
+        }
+        outSummary.finalStock = fishery.getFishStock();
+    }
+    else if (modelChoice == 3)
+    {
+        AgeModelTables<double> tables(getAgeModelParameters(fishery, industry));
+        double ssb = fishery.getSpawningStockBiomass();
+        for (int year = 1; year <= simulationYears; ++year)
+        {
+            boundForcing.apply(fishery, year - 1);
+            AgeStepTotals<double> totals = AgeStructuredModelStep(fishery, industry, tables, ssb);
+            ssb = totals.spawningStockBiomass;
+
+            outSummary.meanStock += totals.totalBiomass;
+            outSummary.meanSSB += ssb;
+            outSummary.meanCatch += totals.catchBiomass;
+            outSummary.finalStock = totals.totalBiomass;
+            outSummary.finalSSB = ssb;
+        }
+    }
+
+    outSummary.meanStock /= simulationYears;
+    outSummary.meanSSB /= simulationYears;
+    outSummary.meanCatch /= simulationYears;
+    return true;
+}
+
+/**
+ * @brief Runs the global sensitivity analysis configured in the "sensitivityAnalysis" section of parameters.json.
+ * Every model evaluation copies the chosen model section, overrides the varied parameters and runs
+ * the model headless on the shared thread pool.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runSensitivityAnalysis(const json& params)
+{
+    std::string modelName;
+    std::string output;
+    std::size_t baseSamples = 0;
+    std::size_t batchSize = 0;
+    std::uint32_t seed = 0;
+    bool disableNoise = true;
+    std::vector<SensitivityParameter> parameters;
+    json modelSection;
+
+    try
+    {
+        auto analysisParams = params.at("sensitivityAnalysis");
+        modelName = analysisParams.at("model").get<std::string>();
+        output = analysisParams.at("output").get<std::string>();
+        baseSamples = analysisParams.at("baseSamples").get<std::size_t>();
+        batchSize = analysisParams.at("batchSize").get<std::size_t>();
+        seed = analysisParams.at("seed").get<std::uint32_t>();
+        disableNoise = analysisParams.at("disableNoise").get<bool>();
+        modelSection = params.at(modelName);
+
+        for (auto& item : analysisParams.at("parameters").items())
+        {
+            std::vector<double> range = item.value().get<std::vector<double>>();
+            if (range.size() != 2 || !(range[0] < range[1]))
+            {
+                std::cout << "Error: Range of sensitivity parameter '" << item.key() << "' must be [lower, upper] with lower < upper." << std::endl;
+                return 1;
+            }
+            if (!modelSection.contains(item.key()) || !modelSection.at(item.key()).is_number())
+            {
+                std::cout << "Error: '" << item.key() << "' is not a numeric parameter of '" << modelName << "'." << std::endl;
+                return 1;
+            }
+            parameters.push_back({ item.key(), range[0], range[1] });
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing sensitivity analysis parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice == 0)
+    {
+        std::cout << "Error: Unknown model '" << modelName << "'. Use simpleModel, delayModel or ageStructuredModel." << std::endl;
+        return 1;
+    }
+    if (!isValidModelOutput(modelChoice, output))
+    {
+        std::cout << "Error: Output '" << output << "' is not available for '" << modelName << "'." << std::endl;
+        return 1;
+    }
+    if (parameters.empty() || baseSamples == 0 || batchSize == 0)
+    {
+        std::cout << "Error: The sensitivity analysis needs at least one parameter, and baseSamples and batchSize must be positive." << std::endl;
+        return 1;
+    }
+
+    if (disableNoise)
+    {
+        //the indices describe the deterministic response unless the noise levels are varied explicitly
+        for (const char* noiseKey : { "reproductionStdDev", "catchabilityStdDev", "recruitmentStdDev" })
+        {
+            if (modelSection.contains(noiseKey)) modelSection[noiseKey] = 0.0;
+        }
+    }
+
+    //the forcing files are loaded once and shared by every evaluation
+    EnvironmentalForcing forcing;
+    if (!loadEnvironmentalForcing(params, modelChoice, forcing)) return 1;
+
+    //check the base parameters once, so the parallel evaluations can not fail on loading
+    {
+        json baseParams;
+        baseParams[modelName] = modelSection;
+        ModelRunSummary summary;
+        if (!runHeadlessSimulation(baseParams, modelChoice, summary, &forcing))
+        {
+            std::cout << "Error loading " << modelName << " parameters. Exiting." << std::endl;
+            return 1;
+        }
+    }
+
+    //a sample the model rejects has no output; it is counted, and the indices are not reported
+    std::atomic<std::size_t> failedRuns(0);
+    auto model = [&](const std::vector<double>& values)
+    {
+        json runParams;
+        runParams[modelName] = modelSection;
+        for (std::size_t i = 0; i < parameters.size(); ++i)
+        {
+            runParams[modelName][parameters[i].name] = values[i];
+        }
+        ModelRunSummary summary;
+        if (!runHeadlessSimulation(runParams, modelChoice, summary, &forcing))
+        {
+            failedRuns.fetch_add(1, std::memory_order_relaxed);
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return getModelOutput(summary, output);
+    };
+
+    SobolSensitivityAnalysis analysis(parameters, model, seed);
+    ThreadPool& pool = ThreadPool::shared();
+
+    std::cout << "--- Global Sensitivity Analysis (Sobol) ---" << std::endl;
+    std::cout << "Model: " << modelName << ", output: " << output << ", " << parameters.size() << " parameters, "
+        << baseSamples * (parameters.size() + 2) << " model runs on " << pool.size() << " threads" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    printf("Base Samples | Model Runs | Output Variance\n");
+    printf("----------------------------------------------\n");
+    std::size_t done = 0;
+    while (done < baseSamples)
+    {
+        std::size_t batch = std::min(batchSize, baseSamples - done);
+        analysis.runBatch(batch, pool);
+        done += batch;
+
+        if (failedRuns.load() > 0)
+        {
+            std::cout << "Error: " << failedRuns.load() << " model runs failed to load their sampled parameters. "
+                << "Narrow the parameter ranges to values the model accepts." << std::endl;
+            return 1;
+        }
+
+        SensitivityIndices progress = analysis.getIndices();
+        printf("%12zu | %10zu | %15.6g\n", progress.baseSamples, progress.modelRuns, progress.outputVariance);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    SensitivityIndices indices = analysis.getIndices();
+
+    printf("\n%-24s | %11s | %11s\n", "Parameter", "First Order", "Total Order");
+    printf("----------------------------------------------------------\n");
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        printf("%-24s | %11.4f | %11.4f\n", parameters[i].name.c_str(), indices.firstOrder[i], indices.totalOrder[i]);
+    }
+    printf("%s\n", durationString.c_str());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "sensitivity_analysis_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Global Sensitivity Analysis (Sobol) of " + modelName);
+    logger.writeComment("Output: " + output);
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("sensitivityAnalysis").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("Output mean: " + std::to_string(indices.outputMean));
+    logger.writeComment("Output variance: " + std::to_string(indices.outputVariance));
+    logger.writeComment("");
+
+    logger.writeHeader("Parameter,FirstOrder,TotalOrder");
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        logger.writeRow(parameters[i].name, { indices.firstOrder[i], indices.totalOrder[i] });
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+//number of parameters differentiated by the age-structured gradient mode
+const std::size_t ageModelGradientCount = 13;
+using AgeModelDual = Dual<ageModelGradientCount>;
+
+//names of the differentiated parameters, in seed order
+const char* ageModelGradientNames[ageModelGradientCount] = {
+    "naturalMortality", "fishingMortality", "vb_Linf", "vb_k", "vb_t0", "lw_a", "lw_b",
+    "maturity_A50", "maturity_k", "selectivity_A50", "selectivity_k", "constantRecruitment", "steepness"
+};
+
+/**
+ * @brief Runs the age-structured model with dual numbers and reports exact gradients of biomass, SSB and catch.
+ * Every parameter of the "ageStructuredModel" section (except maxAge and the initial numbers) is seeded as an
+ * independent variable, so one run gives the derivatives with respect to all of them. Recruitment noise is
+ * drawn as usual, giving the pathwise gradients along the simulated realization.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runAgeModelGradients(const json& params)
+{
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    //seed every parameter as an independent variable
+    AgeModelParameters<double> base = getAgeModelParameters(myFishery, myFishingIndustry);
+    AgeModelParameters<AgeModelDual> dualParams;
+    dualParams.maxAge = base.maxAge;
+    dualParams.stockRecruitment = base.stockRecruitment;
+    for (std::size_t i = 0; i < ageModelGradientCount; ++i)
+    {
+        *findAgeModelParameter(dualParams, ageModelGradientNames[i]) = AgeModelDual::variable(*findAgeModelParameter(base, ageModelGradientNames[i]), i);
+    }
+
+    const std::vector<double>& initialNumbers = myFishery.getNumbersAtAge();
+    std::vector<AgeModelDual> numbersAtAge(initialNumbers.begin(), initialNumbers.end());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "age_structured_gradients" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Age-Structured Model Gradients (forward-mode automatic differentiation)");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    std::string header = "Year,TotalBiomass,SpawningStockBiomass,TotalCatch";
+    for (const char* output : { "TotalBiomass", "SpawningStockBiomass", "TotalCatch" })
+    {
+        for (const char* name : ageModelGradientNames)
+        {
+            header += std::string(",d") + output + "_d" + name;
+        }
+    }
+    logger.writeHeader(header);
+
+    auto writeGradientRow = [&](int year, const AgeModelDual& biomass, const AgeModelDual& ssb, const AgeModelDual& totalCatch)
+    {
+        std::vector<double> values = { biomass.value, ssb.value, totalCatch.value };
+        for (const AgeModelDual* output : { &biomass, &ssb, &totalCatch })
+        {
+            values.insert(values.end(), output->derivatives.begin(), output->derivatives.end());
+        }
+        logger.writeRow(std::to_string(year), values);
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::cout << "--- Age-Structured Model Gradients ---" << std::endl;
+    printf("Year | Total Biomass | Spawning Biomass | Total Catch (Biomass)\n");
+    printf("----------------------------------------------------------------------\n");
+
+    AgeModelDual totalBiomass = getTotalBiomass(numbersAtAge, dualParams);
+    AgeModelDual ssb = getSpawningStockBiomass(numbersAtAge, dualParams);
+    AgeModelDual cumulativeCatch = AgeModelDual(0.0);
+    printf("%4d | %15.2f | %18.2f | %20.2f\n", 0, totalBiomass.value, ssb.value, 0.0);
+    writeGradientRow(0, totalBiomass, ssb, AgeModelDual(0.0));
+
+    AgeModelDual unfishedSSB = getUnfishedSpawningStockBiomass(dualParams);
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        //ssb still holds the spawning stock at the start of the year
+        AgeModelDual recruitment = getExpectedRecruitment(ssb, dualParams, unfishedSSB) * myFishery.getRecruitmentMultiplier();
+        AgeModelDual totalCatch = AgeStructuredModelStep(numbersAtAge, dualParams, recruitment);
+        cumulativeCatch += totalCatch;
+
+        totalBiomass = getTotalBiomass(numbersAtAge, dualParams);
+        ssb = getSpawningStockBiomass(numbersAtAge, dualParams);
+
+        printf("%4d | %15.2f | %18.2f | %20.2f\n", year, totalBiomass.value, ssb.value, totalCatch.value);
+        writeGradientRow(year, totalBiomass, ssb, totalCatch);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    printf("\nGradients at year %d (cumulative catch over all years)\n", simulationYears);
+    printf("%-20s | %16s | %16s | %16s\n", "Parameter", "d(Biomass)", "d(SSB)", "d(Cum. Catch)");
+    printf("----------------------------------------------------------------------------\n");
+    for (std::size_t i = 0; i < ageModelGradientCount; ++i)
+    {
+        printf("%-20s | %16.6g | %16.6g | %16.6g\n", ageModelGradientNames[i],
+            totalBiomass.derivatives[i], ssb.derivatives[i], cumulativeCatch.derivatives[i]);
+    }
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Simulates the delay equation model without console output and records yearly values.
+ * @param params The parameter json, containing at least the "delayModel" section.
+ * @param outStock (Output) Fish stock n at the end of years 0..simulationYears.
+ * @param outEffort (Output) Harvesting effort E at the end of years 0..simulationYears.
+ * @param outCatch (Output) Catch q n E integrated over each year (0 at year 0).
+ * @return True if the parameters were loaded, false otherwise.
+ */
+bool simulateDelayModelTrajectory(const json& params, std::vector<double>& outStock, std::vector<double>& outEffort, std::vector<double>& outCatch)
+{
+    Fishery fishery = Fishery();
+    FishingIndustry industry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+
+    if (!loadParametersFromJSON(params, fishery, industry, 2, simulationYears, stepsPerYear)) return false;
+
+    double timeStep = 1.0 / stepsPerYear;
+    outStock.assign(simulationYears + 1, 0.0);
+    outEffort.assign(simulationYears + 1, 0.0);
+    outCatch.assign(simulationYears + 1, 0.0);
+    outStock[0] = fishery.getFishStock();
+    outEffort[0] = industry.getHarvestingEffort();
+
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        for (int i = 0; i < stepsPerYear; ++i)
+        {
+            //the catch of the step, as computed by DelayEquationModelStep without catchability noise
+            outCatch[year] += fishery.getCatchability() * fishery.getFishStock() * industry.getHarvestingEffort() * timeStep;
+            DelayEquationModelStep(fishery, industry, timeStep);
+        }
+        outStock[year] = fishery.getFishStock();
+        outEffort[year] = industry.getHarvestingEffort();
+    }
+    return true;
+}
+
+/**
+ * @brief A model parameter estimated by the fitting mode, bounded to [lower, upper].
+ * The optimizer works on an unbounded value x with parameter = lower + (upper - lower) / (1 + e^-x).
+ */
+struct FittedParameter
+{
+    std::string name;
+    double initial;
+    double lower;
+    double upper;
+
+    double toParameter(double x) const { return lower + (upper - lower) / (1.0 + std::exp(-x)); }
+    double toUnbounded(double value) const { return std::log((value - lower) / (upper - value)); }
+
+    //d(parameter)/dx
+    double derivative(double x) const
+    {
+        double value = toParameter(x);
+        return (value - lower) * (upper - value) / (upper - lower);
+    }
+};
+
+/**
+ * @brief Fits model parameters to observed series by maximum likelihood, configured in the "modelFitting" section.
+ * The age-structured model is differentiated exactly with dual numbers; the delay model uses central
+ * differences evaluated in parallel. The optimizer is BFGS on bounded-to-unbounded transformed parameters.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runModelFitting(const json& params)
+{
+    std::string modelName;
+    std::string observationsFile;
+    int maxIterations = 0;
+    double gradientTolerance = 0.0;
+    std::vector<ObservedSeries> series;
+    std::vector<FittedParameter> fitted;
+    json modelSection;
+
+    try
+    {
+        auto fittingParams = params.at("modelFitting");
+        modelName = fittingParams.at("model").get<std::string>();
+        observationsFile = fittingParams.at("observationsFile").get<std::string>();
+        maxIterations = fittingParams.at("maxIterations").get<int>();
+        gradientTolerance = fittingParams.at("gradientTolerance").get<double>();
+        modelSection = params.at(modelName);
+
+        for (auto& item : fittingParams.at("series").items())
+        {
+            ObservedSeries observed;
+            observed.name = item.key();
+            observed.prediction = item.value().at("prediction").get<std::string>();
+            observed.sigma = item.value().at("sigma").get<double>();
+            observed.scaled = item.value().at("scaled").get<bool>();
+            series.push_back(observed);
+        }
+
+        for (auto& item : fittingParams.at("parameters").items())
+        {
+            FittedParameter parameter;
+            parameter.name = item.key();
+            parameter.initial = item.value().at("initial").get<double>();
+            parameter.lower = item.value().at("lower").get<double>();
+            parameter.upper = item.value().at("upper").get<double>();
+            if (!(parameter.lower < parameter.initial && parameter.initial < parameter.upper))
+            {
+                std::cout << "Error: Fitted parameter '" << parameter.name << "' needs lower < initial < upper." << std::endl;
+                return 1;
+            }
+            fitted.push_back(parameter);
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing model fitting parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice != 2 && modelChoice != 3)
+    {
+        std::cout << "Error: Model fitting supports 'delayModel' and 'ageStructuredModel', not '" << modelName << "'." << std::endl;
+        return 1;
+    }
+    if (fitted.empty() || series.empty())
+    {
+        std::cout << "Error: Model fitting needs at least one parameter and one observed series." << std::endl;
+        return 1;
+    }
+    if (modelChoice == 3 && fitted.size() > ageModelGradientCount)
+    {
+        std::cout << "Error: At most " << ageModelGradientCount << " age-structured parameters can be fitted at once." << std::endl;
+        return 1;
+    }
+
+    for (const ObservedSeries& observed : series)
+    {
+        bool known = (observed.prediction == "catch" || observed.prediction == "biomass")
+            || (modelChoice == 3 && observed.prediction == "ssb") || (modelChoice == 2 && observed.prediction == "effort");
+        if (!known)
+        {
+            std::cout << "Error: Series '" << observed.name << "' predicts unknown output '" << observed.prediction << "'." << std::endl;
+            return 1;
+        }
+        if (observed.sigma <= 0.0)
+        {
+            std::cout << "Error: Series '" << observed.name << "' needs a positive sigma." << std::endl;
+            return 1;
+        }
+    }
+    for (const FittedParameter& parameter : fitted)
+    {
+        AgeModelParameters<double> lookup;
+        bool known = (modelChoice == 3) ? findAgeModelParameter(lookup, parameter.name) != nullptr
+            : modelSection.contains(parameter.name) && modelSection.at(parameter.name).is_number();
+        if (!known)
+        {
+            std::cout << "Error: '" << parameter.name << "' is not a fittable parameter of '" << modelName << "'." << std::endl;
+            return 1;
+        }
+    }
+
+    //observation errors are handled by the likelihood, so the process noise is switched off
+    for (const char* noiseKey : { "reproductionStdDev", "catchabilityStdDev", "recruitmentStdDev" })
+    {
+        if (modelSection.contains(noiseKey)) modelSection[noiseKey] = 0.0;
+    }
+    json baseParams;
+    baseParams[modelName] = modelSection;
+
+    Fishery baseFishery = Fishery();
+    FishingIndustry baseIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(baseParams, baseFishery, baseIndustry, modelChoice, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading " << modelName << " parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    if (!loadObservedSeries(observationsFile, series)) return 1;
+    for (const ObservedSeries& observed : series)
+    {
+        for (int year : observed.years)
+        {
+            if (year < 0 || year > simulationYears)
+            {
+                std::cout << "Error: Series '" << observed.name << "' has an observation in year " << year
+                    << ", outside the simulated years 0-" << simulationYears << "." << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    std::size_t k = fitted.size();
+
+    //age-structured model: exact gradient with dual numbers
+    AgeModelParameters<double> baseAgeParams = getAgeModelParameters(baseFishery, baseIndustry);
+    std::vector<double> initialNumbers = baseFishery.getNumbersAtAge();
+
+    auto ageObjective = [&](const std::vector<double>& theta, std::vector<double>& gradient)
+    {
+        AgeModelParameters<AgeModelDual> dualParams;
+        dualParams.maxAge = baseAgeParams.maxAge;
+        dualParams.stockRecruitment = baseAgeParams.stockRecruitment;
+        for (std::size_t i = 0; i < ageModelGradientCount; ++i)
+        {
+            *findAgeModelParameter(dualParams, ageModelGradientNames[i]) = AgeModelDual(*findAgeModelParameter(baseAgeParams, ageModelGradientNames[i]));
+        }
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            *findAgeModelParameter(dualParams, fitted[i].name) = AgeModelDual::variable(theta[i], i);
+        }
+
+        std::vector<AgeModelDual> biomass, ssb, catches;
+        projectAgeModelDeterministic(initialNumbers, dualParams, simulationYears, biomass, ssb, catches);
+
+        std::vector<const std::vector<AgeModelDual>*> predictions;
+        for (const ObservedSeries& observed : series)
+        {
+            predictions.push_back(observed.prediction == "catch" ? &catches : (observed.prediction == "ssb" ? &ssb : &biomass));
+        }
+
+        AgeModelDual nll = evaluateNegativeLogLikelihood(series, predictions, pool);
+        gradient.assign(nll.derivatives.begin(), nll.derivatives.begin() + k);
+        return nll.value;
+    };
+
+    //the same likelihood in plain doubles, without the derivatives
+    auto ageLikelihood = [&](const std::vector<double>& theta)
+    {
+        AgeModelParameters<double> ageParams = baseAgeParams;
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            *findAgeModelParameter(ageParams, fitted[i].name) = theta[i];
+        }
+
+        std::vector<double> biomass, ssb, catches;
+        projectAgeModelDeterministic(initialNumbers, ageParams, simulationYears, biomass, ssb, catches);
+
+        std::vector<const std::vector<double>*> predictions;
+        for (const ObservedSeries& observed : series)
+        {
+            predictions.push_back(observed.prediction == "catch" ? &catches : (observed.prediction == "ssb" ? &ssb : &biomass));
+        }
+        return evaluateNegativeLogLikelihood(series, predictions, pool);
+    };
+
+    //delay model: likelihood from a headless run with the fitted parameters overridden
+    auto delayLikelihood = [&](const std::vector<double>& theta)
+    {
+        json runParams = baseParams;
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            runParams[modelName][fitted[i].name] = theta[i];
+        }
+
+        std::vector<double> stock, effort, catches;
+        simulateDelayModelTrajectory(runParams, stock, effort, catches);
+
+        std::vector<const std::vector<double>*> predictions;
+        for (const ObservedSeries& observed : series)
+        {
+            predictions.push_back(observed.prediction == "catch" ? &catches : (observed.prediction == "effort" ? &effort : &stock));
+        }
+        return evaluateNegativeLogLikelihood(series, predictions, pool);
+    };
+
+    //objective in the unbounded space, with the gradient chained through the bound transform
+    auto objective = [&](const std::vector<double>& x, std::vector<double>* gradient)
+    {
+        std::vector<double> theta(k);
+        for (std::size_t i = 0; i < k; ++i) theta[i] = fitted[i].toParameter(x[i]);
+
+        //line search trials need the value alone
+        if (gradient == nullptr) return (modelChoice == 3) ? ageLikelihood(theta) : delayLikelihood(theta);
+
+        gradient->assign(k, 0.0);
+        if (modelChoice == 3)
+        {
+            std::vector<double> thetaGradient;
+            double value = ageObjective(theta, thetaGradient);
+            for (std::size_t i = 0; i < k; ++i) (*gradient)[i] = thetaGradient[i] * fitted[i].derivative(x[i]);
+            return value;
+        }
+
+        //central differences in x, with the 2k + 1 runs evaluated in parallel
+        const double h = 1e-5;
+        std::vector<double> values(2 * k + 1);
+        pool.parallelFor(2 * k + 1, [&](std::size_t run)
+        {
+            std::vector<double> shifted = theta;
+            if (run > 0)
+            {
+                std::size_t i = (run - 1) / 2;
+                double sign = ((run - 1) % 2 == 0) ? 1.0 : -1.0;
+                shifted[i] = fitted[i].toParameter(x[i] + sign * h);
+            }
+            values[run] = delayLikelihood(shifted);
+        });
+        for (std::size_t i = 0; i < k; ++i) (*gradient)[i] = (values[1 + 2 * i] - values[2 + 2 * i]) / (2.0 * h);
+        return values[0];
+    };
+
+    std::vector<double> x0(k);
+    for (std::size_t i = 0; i < k; ++i) x0[i] = fitted[i].toUnbounded(fitted[i].initial);
+
+    std::cout << "--- Model Fitting (Maximum Likelihood) ---" << std::endl;
+    std::cout << "Model: " << modelName << ", " << k << " parameters, " << series.size() << " observed series" << std::endl;
+    printf("Iteration | Negative Log-Likelihood | Gradient Norm\n");
+    printf("------------------------------------------------------\n");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    BFGSOptimizer optimizer(maxIterations, gradientTolerance);
+    std::vector<double> initialGradient;
+    double initialValue = objective(x0, &initialGradient);
+    printf("%9d | %23.6f | %13.6g\n", 0, initialValue, std::sqrt(std::inner_product(initialGradient.begin(), initialGradient.end(), initialGradient.begin(), 0.0)));
+    BFGSOptimizer::Result result = optimizer.minimize(objective, x0, [](int iteration, double value, double gradientNorm)
+    {
+        printf("%9d | %23.6f | %13.6g\n", iteration, value, gradientNorm);
+    });
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    std::vector<double> estimates(k);
+    for (std::size_t i = 0; i < k; ++i) estimates[i] = fitted[i].toParameter(result.x[i]);
+
+    printf("\n%s after %d iterations\n", result.converged ? "Converged" : "Stopped without convergence", result.iterations);
+    printf("%-24s | %14s | %14s\n", "Parameter", "Initial", "Estimate");
+    printf("----------------------------------------------------------\n");
+    for (std::size_t i = 0; i < k; ++i)
+    {
+        printf("%-24s | %14.6g | %14.6g\n", fitted[i].name.c_str(), fitted[i].initial, estimates[i]);
+    }
+    printf("%s\n", durationString.c_str());
+
+    //predictions at the estimates, for the fit log
+    json fittedParams = baseParams;
+    for (std::size_t i = 0; i < k; ++i)
+    {
+        fittedParams[modelName][fitted[i].name] = estimates[i];
+    }
+    std::vector<double> biomass, ssb, catches;
+    if (modelChoice == 3)
+    {
+        AgeModelParameters<double> estimatedAgeParams = baseAgeParams;
+        for (std::size_t i = 0; i < k; ++i) *findAgeModelParameter(estimatedAgeParams, fitted[i].name) = estimates[i];
+        projectAgeModelDeterministic(initialNumbers, estimatedAgeParams, simulationYears, biomass, ssb, catches);
+    }
+    else
+    {
+        //ssb holds the effort for the delay model
+        simulateDelayModelTrajectory(fittedParams, biomass, ssb, catches);
+    }
+    std::vector<const std::vector<double>*> predictions;
+    for (const ObservedSeries& observed : series)
+    {
+        bool second = observed.prediction == "ssb" || observed.prediction == "effort";
+        predictions.push_back(observed.prediction == "catch" ? &catches : (second ? &ssb : &biomass));
+    }
+    std::vector<double> scales;
+    double finalLikelihood = evaluateNegativeLogLikelihood(series, predictions, pool, &scales);
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "model_fit_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Maximum Likelihood Fit of " + modelName);
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("modelFitting").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logger.writeComment("Negative log-likelihood: " + std::to_string(finalLikelihood));
+    for (std::size_t i = 0; i < k; ++i)
+    {
+        logger.writeComment("Estimate " + fitted[i].name + ": " + std::to_string(estimates[i]));
+    }
+    for (std::size_t s = 0; s < series.size(); ++s)
+    {
+        if (series[s].scaled) logger.writeComment("Catchability " + series[s].name + ": " + std::to_string(scales[s]));
+    }
+    logger.writeComment("");
+
+    std::string header = "Year";
+    for (const ObservedSeries& observed : series)
+    {
+        header += "," + observed.name + "_Observed," + observed.name + "_Predicted";
+    }
+    logger.writeHeader(header);
+    for (int year = 0; year <= simulationYears; ++year)
+    {
+        std::vector<double> values;
+        for (std::size_t s = 0; s < series.size(); ++s)
+        {
+            auto it = std::find(series[s].years.begin(), series[s].years.end(), year);
+            values.push_back(it != series[s].years.end() ? series[s].values[it - series[s].years.begin()] : 0.0);
+            values.push_back(scales[s] * (*predictions[s])[year]);
+        }
+        logger.writeRow(std::to_string(year), values);
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Returns the names of the yearly outputs recorded for a model, matching its CSV log columns.
+ */
+std::vector<std::string> getTrajectoryVariableNames(int modelChoice)
+{
+    if (modelChoice == 1) return { "FishStock_tons" };
+    if (modelChoice == 2) return { "Population_n", "Effort_E", "MarketStock_S" };
+    return { "TotalBiomass", "SpawningStockBiomass", "TotalCatch" };
+}
+
+/**
+ * @brief Simulates the Age-Structured Model for simulateTrajectory, for any maximum age.
+ * @param outValues (Output) Year-major values, already sized for the three outputs.
+ */
+template <typename T>
+void simulateAgeTrajectory(Fishery& fishery, FishingIndustry& industry, int simulationYears, std::vector<double>& outValues,
+    const EnvironmentalForcing& forcing, std::size_t replicate)
+{
+    //growth and maturity are never forced, so only the survival and catch tables follow the forced mortality
+    AgeModelTables<T> tables(getAgeModelParameters<T>(fishery, industry));
+
+    const std::vector<double>& initialNumbers = fishery.getNumbersAtAge();
+    std::vector<T> numbersAtAge(initialNumbers.begin(), initialNumbers.end());
+    AgeStepTotals<T> totals = tables.getTotals(numbersAtAge.data());
+    T ssb = totals.spawningStockBiomass;
+    outValues[0] = totals.totalBiomass;
+    outValues[1] = ssb;
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        forcing.apply(fishery, year - 1, replicate);
+        tables.setMortality(T(fishery.getNaturalMortality()), T(industry.getFishingMortality()));
+        T recruitment = T(fishery.getRecruitment(ssb));
+        totals = tables.step(numbersAtAge.data(), recruitment);
+        ssb = totals.spawningStockBiomass;
+        outValues[year * 3 + 0] = totals.totalBiomass;
+        outValues[year * 3 + 1] = ssb;
+        outValues[year * 3 + 2] = totals.catchBiomass;
+    }
+    fishery.setNumbersAtAge(std::vector<double>(numbersAtAge.begin(), numbersAtAge.end()));
+}
+
+/**
+ * @brief Simulates the Age-Structured Model for simulateTrajectory with a compile-time maximum age
+ * (see FixedAgeModel.h). Gives the same results as simulateAgeTrajectory.
+ * @param outValues (Output) Year-major values, already sized for the three outputs.
+ */
+template <int MaxAge, typename T>
+void simulateFixedAgeTrajectory(Fishery& fishery, FishingIndustry& industry, int simulationYears, std::vector<double>& outValues,
+    const EnvironmentalForcing& forcing, std::size_t replicate)
+{
+    FixedAgeModel<MaxAge, T> model(getAgeModelParameters<T>(fishery, industry));
+    typename FixedAgeModel<MaxAge, T>::AgeArray numbersAtAge;
+    const std::vector<double>& initialNumbers = fishery.getNumbersAtAge();
+    for (int age = 0; age <= MaxAge; ++age) numbersAtAge[age] = T(initialNumbers[age]);
+
+    T ssb = model.getSpawningStockBiomass(numbersAtAge);
+    outValues[0] = model.getTotalBiomass(numbersAtAge);
+    outValues[1] = ssb;
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        forcing.apply(fishery, year - 1, replicate);
+        model.setMortality(T(fishery.getNaturalMortality()), T(industry.getFishingMortality()));
+        T recruitment = T(fishery.getRecruitment(ssb));
+        AgeStepTotals<T> totals = model.stepFused(numbersAtAge, recruitment);
+        ssb = totals.spawningStockBiomass;
+        outValues[year * 3 + 0] = totals.totalBiomass;
+        outValues[year * 3 + 1] = ssb;
+        outValues[year * 3 + 2] = totals.catchBiomass;
+    }
+    fishery.setNumbersAtAge(std::vector<double>(numbersAtAge.begin(), numbersAtAge.end()));
+}
+
+/**
+ * @brief Simulates a model and records its yearly outputs, without console output or CSV logging.
+ * The state is held and stepped in the scalar type T (double, or float for large ensembles), while the
+ * parameters, forcing and noise draws stay in double and are rounded to T when used, so a float and a
+ * double run of the same seeded fishery see the same noise. With T = double the results are those of the
+ * single-run models. The final state is written back to the fishery and industry.
+ * @param fishery The fishery, already loaded with the model parameters (and seeded).
+ * @param industry The fishing industry, already loaded with the model parameters.
+ * @param modelChoice 1 for Simple Model, 2 for Delay Model, 3 for Age-Structured Model.
+ * @param outValues (Output) Year-major values, outValues[year * variables + variable] for years 0..simulationYears.
+ * @param forcing The environmental forcing, bound to the loaded parameters (may be empty).
+ * @param replicate The replicate index, selecting the scenario of forcing inputs that cycle through scenarios.
+ */
+template <typename T = double>
+void simulateTrajectory(Fishery& fishery, FishingIndustry& industry, int modelChoice, int simulationYears, int stepsPerYear, std::vector<double>& outValues,
+    const EnvironmentalForcing& forcing, std::size_t replicate)
+{
+    std::size_t variables = getTrajectoryVariableNames(modelChoice).size();
+    outValues.assign((simulationYears + 1) * variables, 0.0);
+
+    if (modelChoice == 1)
+    {
+        T stock = T(fishery.getFishStock());
+        outValues[0] = stock;
+        for (int year = 1; year <= simulationYears; ++year)
+        {
+            forcing.apply(fishery, year - 1, replicate);
+            T noise = T(fishery.getNoisyMultiplier(fishery.getReproductionStdDev()));
+            T growth = SimpleModelGrowthAmount(stock, T(fishery.getSimpleReproductionRate()), T(fishery.getSimpleCarryingCapacity()),
+                T(industry.getSimpleHarvestRate()), noise);
+            stock = std::max(T(0.0), stock + growth);
+            outValues[year] = stock;
+        }
+        fishery.setFishStock(stock);
+    }
+    else if (modelChoice == 2)
+    {
+        T timeStep = T(1.0 / stepsPerYear);
+        T n = T(fishery.getFishStock());
+        T E = T(industry.getHarvestingEffort());
+        T S = T(industry.getFishMarketStock());
+        for (int year = 0; year <= simulationYears; ++year)
+        {
+            if (year > 0)
+            {
+                for (int i = 0; i < stepsPerYear; ++i)
+                {
+                    forcing.apply(fishery, (year - 1) + i * (1.0 / stepsPerYear), replicate);
+                    T noise = T(fishery.getNoisyMultiplier(fishery.getCatchabilityStdDev()));
+                    DelayEquationModelStep(n, E, S, fishery, industry, noise, timeStep);
+                }
+            }
+            outValues[year * 3 + 0] = n;
+            outValues[year * 3 + 1] = E;
+            outValues[year * 3 + 2] = S;
+        }
+        fishery.setFishStock(n);
+        industry.setHarvestingEffort(E);
+        industry.setFishMarketStock(S);
+    }
+    else if (modelChoice == 3)
+    {
+        //common maximum ages use the fixed-size model, the others the dynamic one
+        switch (fishery.getMaxAge())
+        {
+        case 5: simulateFixedAgeTrajectory<5, T>(fishery, industry, simulationYears, outValues, forcing, replicate); break;
+        case 10: simulateFixedAgeTrajectory<10, T>(fishery, industry, simulationYears, outValues, forcing, replicate); break;
+        case 20: simulateFixedAgeTrajectory<20, T>(fishery, industry, simulationYears, outValues, forcing, replicate); break;
+        default: simulateAgeTrajectory<T>(fishery, industry, simulationYears, outValues, forcing, replicate); break;
+        }
+    }
+}
+
+/**
+ * @brief A scenario of an ensemble: the model loaded with a set of parameter overrides, and its forcing.
+ */
+struct EnsembleScenario
+{
+    std::string name;
+    Fishery fishery;
+    FishingIndustry industry;
+    EnvironmentalForcing forcing;
+};
+
+/**
+ * @brief Loads the scenarios of an ensemble, each a copy of the model section with its overrides applied.
+ * The forcing files are loaded once and shared by all scenarios.
+ * @param scenarioParams The array of {"name", "parameters"} objects. Empty means a single unnamed scenario.
+ * @param outScenarios (Output) One loaded scenario per entry.
+ * @return True if every scenario was loaded, false otherwise.
+ */
+bool loadEnsembleScenarios(const json& params, const std::string& modelName, int modelChoice, const json& scenarioParams,
+    std::vector<EnsembleScenario>& outScenarios, int& outSimYears, int& outStepsPerYear)
+{
+    outScenarios.clear();
+
+    EnvironmentalForcing forcing;
+    if (!loadEnvironmentalForcing(params, modelChoice, forcing)) return false;
+
+    std::size_t scenarioCount = std::max<std::size_t>(1, scenarioParams.size());
+    for (std::size_t s = 0; s < scenarioCount; ++s)
+    {
+        json runParams = params;
+        EnsembleScenario scenario;
+        try
+        {
+            if (!scenarioParams.empty())
+            {
+                scenario.name = scenarioParams[s].at("name").get<std::string>();
+                for (auto& item : scenarioParams[s].at("parameters").items())
+                {
+                    if (!runParams[modelName].contains(item.key()) || item.key() == "simulationYears")
+                    {
+                        std::cout << "Error: Scenario '" << scenario.name << "' overrides '" << item.key() << "', which is not a scenario parameter of '" << modelName << "'." << std::endl;
+                        return false;
+                    }
+                    runParams[modelName][item.key()] = item.value();
+                }
+            }
+        }
+        catch (json::exception& e)
+        {
+            std::cout << "Error: Invalid ensemble scenario in JSON file:\n" << e.what() << std::endl;
+            return false;
+        }
+
+        if (!loadParametersFromJSON(runParams, scenario.fishery, scenario.industry, modelChoice, outSimYears, outStepsPerYear))
+        {
+            std::cout << "Error loading " << modelName << " parameters" << (scenario.name.empty() ? "" : " of scenario '" + scenario.name + "'") << ". Exiting." << std::endl;
+            return false;
+        }
+        scenario.forcing = forcing.bind(scenario.fishery);
+        outScenarios.push_back(scenario);
+    }
+    return true;
+}
+
+/**
+ * @brief The number of standard normal draws made by one simulated trajectory (0 without noise).
+ */
+std::size_t getNoiseDrawCount(const Fishery& fishery, int modelChoice, int simulationYears, int stepsPerYear)
+{
+    if (modelChoice == 1 && fishery.getReproductionStdDev() > 0.0) return simulationYears;
+    if (modelChoice == 2 && fishery.getCatchabilityStdDev() > 0.0) return static_cast<std::size_t>(simulationYears) * stepsPerYear;
+    if (modelChoice == 3 && fishery.getRecruitmentStdDev() > 0.0) return simulationYears;
+    return 0;
+}
+
+/**
+ * @brief Seeds the noise of an ensemble replicate for the chosen variance reduction.
+ * @param quasiRandomNormals The quasi-random draws, required with VarianceReduction::QuasiMonteCarlo (otherwise may be null).
+ * @param scratchNormals Scratch storage for the quasi-random draws.
+ * @param noiseTape The pre-generated draws of the noise streams (may be null). The stream's row of the tape is
+ *        read instead of seeding the generator.
+ * @return The noise stream of the replicate, shared by antithetic twins. It also selects the scenario of
+ *         forcing inputs that cycle through scenarios, so twins see the same environment.
+ */
+std::size_t seedReplicateNoise(Fishery& fishery, VarianceReduction method, const QuasiRandomNormals* quasiRandomNormals,
+    std::uint32_t seed, std::size_t replicate, std::vector<double>& scratchNormals, const NoiseTape* noiseTape = nullptr)
+{
+    std::size_t stream = (method == VarianceReduction::Antithetic) ? replicate / 2 : replicate;
+    if (noiseTape != nullptr) fishery.setNoiseTape(noiseTape->getDraws(stream), noiseTape->getDrawsPerReplicate());
+    else fishery.setSeed(seed, static_cast<std::uint32_t>(stream));
+    fishery.setAntithetic(method == VarianceReduction::Antithetic && replicate % 2 == 1);
+    if (method == VarianceReduction::QuasiMonteCarlo)
+    {
+        quasiRandomNormals->getNormals(replicate, scratchNormals);
+        fishery.setPresetNormals(scratchNormals);
+    }
+    return stream;
+}
+
+/**
+ * @brief Runs a stochastic ensemble configured in the "ensemble" section of parameters.json.
+ * Replicates are simulated in parallel chunks on the shared thread pool. Each chunk streams its yearly
+ * outputs into its own EnsembleStatistics, and the chunks are merged in order at the end, so no
+ * trajectory is stored. Writes the per-year summary (moments and quantiles) and the histograms as CSV.
+ *
+ * The noise can be sampled with antithetic pairs or quasi-Monte Carlo points (see VarianceReduction.h).
+ * With several scenarios (overrides of the model parameters, e.g. harvest levels), every replicate runs
+ * each scenario with the same noise (common random numbers), and the paired differences from the first
+ * scenario are recorded as extra outputs. With a "noiseTape" file, the noise is generated once into the file
+ * (see NoiseTape.h), or read from it if it already exists, and every scenario and later sweep replays it.
+ *
+ * The model state can be stepped in float32 ("precision"), halving the state memory of every replicate.
+ * With "validatePrecision", every replicate is also run in the other precision with the same noise, and the
+ * float32 rounding error is reported against the ensemble spread it has to stay well below.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runEnsemble(const json& params)
+{
+    std::string modelName;
+    std::size_t replicates = 0;
+    std::uint32_t seed = 0;
+    std::vector<double> quantiles;
+    std::size_t histogramBins = 0;
+    json histogramRanges;
+    std::string varianceReductionName;
+    json scenarioParams;
+    std::string precision;
+    bool validatePrecision = false;
+    std::string noiseTapeFile;
+
+    try
+    {
+        auto ensembleParams = params.at("ensemble");
+        if (ensembleParams.contains("noiseTape")) noiseTapeFile = ensembleParams.at("noiseTape").get<std::string>();
+        modelName = ensembleParams.at("model").get<std::string>();
+        replicates = ensembleParams.at("replicates").get<std::size_t>();
+        seed = ensembleParams.at("seed").get<std::uint32_t>();
+        quantiles = ensembleParams.at("quantiles").get<std::vector<double>>();
+        histogramBins = ensembleParams.at("histogramBins").get<std::size_t>();
+        histogramRanges = ensembleParams.at("histogramRanges");
+        varianceReductionName = ensembleParams.at("varianceReduction").get<std::string>();
+        scenarioParams = ensembleParams.at("scenarios");
+        precision = ensembleParams.at("precision").get<std::string>();
+        validatePrecision = ensembleParams.at("validatePrecision").get<bool>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing ensemble parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice == 0)
+    {
+        std::cout << "Error: Unknown model '" << modelName << "'. Use simpleModel, delayModel or ageStructuredModel." << std::endl;
+        return 1;
+    }
+    if (replicates == 0)
+    {
+        std::cout << "Error: The ensemble needs at least one replicate." << std::endl;
+        return 1;
+    }
+    for (double q : quantiles)
+    {
+        if (q < 0.0 || q > 1.0)
+        {
+            std::cout << "Error: Ensemble quantiles must lie in [0, 1]." << std::endl;
+            return 1;
+        }
+    }
+
+    VarianceReduction varianceReduction = VarianceReduction::None;
+    if (!parseVarianceReduction(varianceReductionName, varianceReduction))
+    {
+        std::cout << "Error: Unknown varianceReduction '" << varianceReductionName << "'. Use none, antithetic or quasiMonteCarlo." << std::endl;
+        return 1;
+    }
+    if (varianceReduction == VarianceReduction::Antithetic && replicates % 2 != 0)
+    {
+        std::cout << "Error: Antithetic sampling needs an even number of replicates." << std::endl;
+        return 1;
+    }
+    if (precision != "float64" && precision != "float32")
+    {
+        std::cout << "Error: Unknown precision '" << precision << "'. Use float64 or float32." << std::endl;
+        return 1;
+    }
+    bool singlePrecision = (precision == "float32");
+
+    std::vector<EnsembleScenario> scenarios;
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadEnsembleScenarios(params, modelName, modelChoice, scenarioParams, scenarios, simulationYears, stepsPerYear)) return 1;
+    std::size_t scenarioCount = scenarios.size();
+
+    //with several scenarios, the outputs are "<scenario>:<variable>" followed by the paired differences "<scenario>-<first>:<variable>"
+    std::vector<std::string> modelVariableNames = getTrajectoryVariableNames(modelChoice);
+    std::size_t modelVariables = modelVariableNames.size();
+    std::vector<std::string> variableNames;
+    std::vector<FixedHistogram> histograms;
+    for (std::size_t s = 0; s < scenarioCount; ++s)
+    {
+        for (std::size_t v = 0; v < modelVariables; ++v)
+        {
+            variableNames.push_back(scenarioCount > 1 ? scenarios[s].name + ":" + modelVariableNames[v] : modelVariableNames[v]);
+
+            FixedHistogram histogram;
+            if (histogramBins > 0 && histogramRanges.contains(modelVariableNames[v]))
+            {
+                std::vector<double> range;
+                try
+                {
+                    range = histogramRanges.at(modelVariableNames[v]).get<std::vector<double>>();
+                }
+                catch (json::exception& e)
+                {
+                    std::cout << "Error: Invalid histogram range of '" << modelVariableNames[v] << "' in JSON file:\n" << e.what() << std::endl;
+                    return 1;
+                }
+                if (range.size() != 2 || !(range[0] < range[1]))
+                {
+                    std::cout << "Error: Histogram range of '" << modelVariableNames[v] << "' must be [lower, upper] with lower < upper." << std::endl;
+                    return 1;
+                }
+                histogram = FixedHistogram(range[0], range[1], histogramBins);
+            }
+            histograms.push_back(histogram);
+        }
+    }
+    for (std::size_t s = 1; s < scenarioCount; ++s)
+    {
+        for (std::size_t v = 0; v < modelVariables; ++v)
+        {
+            variableNames.push_back(scenarios[s].name + "-" + scenarios[0].name + ":" + modelVariableNames[v]);
+            histograms.push_back(FixedHistogram());
+        }
+    }
+
+    //a noise tape replays the draws of the seed it was generated with, which must not contradict the configured one
+    std::uint32_t configuredSeed = seed;
+    if (seed == 0)
+    {
+        std::random_device rd;
+        seed = rd();
+    }
+
+    //quasi-random points cover the leading noise draws of each replicate
+    std::size_t noiseDraws = getNoiseDrawCount(scenarios[0].fishery, modelChoice, simulationYears, stepsPerYear);
+    QuasiRandomNormals quasiRandomNormals(noiseDraws, seed);
+
+    ThreadPool& pool = ThreadPool::shared();
+
+    //the noise tape holds a row per noise stream, long enough for the noisiest scenario
+    std::shared_ptr<const NoiseTape> noiseTape;
+    if (!noiseTapeFile.empty())
+    {
+        if (varianceReduction == VarianceReduction::QuasiMonteCarlo)
+        {
+            std::cout << "Error: A noise tape cannot be combined with quasiMonteCarlo sampling. Use none or antithetic." << std::endl;
+            return 1;
+        }
+        std::size_t streams = (varianceReduction == VarianceReduction::Antithetic) ? replicates / 2 : replicates;
+        std::size_t tapeDraws = 0;
+        for (const EnsembleScenario& scenario : scenarios)
+        {
+            tapeDraws = std::max(tapeDraws, getNoiseDrawCount(scenario.fishery, modelChoice, simulationYears, stepsPerYear));
+        }
+        if (tapeDraws == 0)
+        {
+            std::cout << "Error: The ensemble has no noise to record on a tape." << std::endl;
+            return 1;
+        }
+
+        if (!std::ifstream(noiseTapeFile).good())
+        {
+            TraceScope trace("GenerateNoiseTape", "io", "replicates", static_cast<long long>(streams));
+            if (!NoiseTape::generate(noiseTapeFile, seed, streams, tapeDraws, pool)) return 1;
+            std::cout << "Noise tape generated: " << noiseTapeFile << std::endl;
+        }
+        noiseTape = NoiseTape::load(noiseTapeFile);
+        if (!noiseTape) return 1;
+        if (noiseTape->getReplicateCount() < streams || noiseTape->getDrawsPerReplicate() < tapeDraws)
+        {
+            std::cout << "Error: Noise tape " << noiseTapeFile << " holds " << noiseTape->getReplicateCount() << " x " << noiseTape->getDrawsPerReplicate()
+                << " draws, but the ensemble needs " << streams << " x " << tapeDraws << ". Delete it to generate a new one." << std::endl;
+            return 1;
+        }
+
+        //the draws are those of the tape's seed; a seed of 0 adopts it
+        if (configuredSeed != 0 && configuredSeed != noiseTape->getSeed())
+        {
+            std::cout << "Error: Noise tape " << noiseTapeFile << " was generated with seed " << noiseTape->getSeed() << ", but the ensemble seed is "
+                << configuredSeed << ". Set the seed to " << noiseTape->getSeed() << " (or 0) to replay the tape, or delete it to generate a new one." << std::endl;
+            return 1;
+        }
+        seed = noiseTape->getSeed();
+    }
+
+    //a few chunks per thread balances the load, while keeping the merge cost small
+    std::size_t chunkCount = std::min(replicates, pool.size() * 4);
+    std::vector<EnsembleStatistics> chunkStatistics(chunkCount, EnsembleStatistics(variableNames, simulationYears, histograms));
+
+    //absolute and relative differences of the float32 outputs from float64, per model output
+    std::vector<std::vector<RunningMoments>> chunkAbsoluteErrors(chunkCount, std::vector<RunningMoments>(modelVariables));
+    std::vector<std::vector<RunningMoments>> chunkRelativeErrors(chunkCount, std::vector<RunningMoments>(modelVariables));
+
+    std::cout << "--- Ensemble Simulation ---" << std::endl;
+    std::cout << "Model: " << modelName << ", " << replicates << " replicates on " << pool.size() << " threads, seed " << seed << std::endl;
+    std::cout << "Precision: " << precision << (validatePrecision ? " (validated against " + std::string(singlePrecision ? "float64" : "float32") + ")" : "") << std::endl;
+    std::cout << "Variance reduction: " << varianceReductionName;
+    if (varianceReduction == VarianceReduction::QuasiMonteCarlo)
+    {
+        std::cout << " (" << quasiRandomNormals.getDimensions() << " of " << noiseDraws << " noise draws per replicate quasi-random)";
+    }
+    if (scenarioCount > 1)
+    {
+        std::cout << ", " << scenarioCount << " scenarios with common random numbers";
+    }
+    std::cout << std::endl;
+    if (noiseTape)
+    {
+        std::cout << "Noise tape: " << noiseTapeFile << " (seed " << noiseTape->getSeed() << ", " << noiseTape->getReplicateCount() << " x "
+            << noiseTape->getDrawsPerReplicate() << " draws, memory-mapped)" << std::endl;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    pool.parallelFor(chunkCount, [&](std::size_t chunk)
+    {
+        std::vector<double> trajectory;
+        std::vector<double> checkTrajectory;
+        std::vector<double> values(variableNames.size() * (simulationYears + 1));
+        std::vector<double> presetNormals;
+        for (std::size_t replicate = chunk; replicate < replicates; replicate += chunkCount)
+        {
+            TraceScope trace("Replicate", "ensemble", "replicate", static_cast<long long>(replicate));
+            for (std::size_t s = 0; s < scenarioCount; ++s)
+            {
+                //every scenario replays the same noise
+                Fishery fishery = scenarios[s].fishery;
+                FishingIndustry industry = scenarios[s].industry;
+                std::size_t stream = seedReplicateNoise(fishery, varianceReduction, &quasiRandomNormals, seed, replicate, presetNormals, noiseTape.get());
+
+                if (validatePrecision)
+                {
+                    //the copy starts from the same seeded noise state
+                    Fishery checkFishery = fishery;
+                    FishingIndustry checkIndustry = industry;
+                    if (singlePrecision) simulateTrajectory<double>(checkFishery, checkIndustry, modelChoice, simulationYears, stepsPerYear, checkTrajectory, scenarios[s].forcing, stream);
+                    else simulateTrajectory<float>(checkFishery, checkIndustry, modelChoice, simulationYears, stepsPerYear, checkTrajectory, scenarios[s].forcing, stream);
+                }
+                if (singlePrecision) simulateTrajectory<float>(fishery, industry, modelChoice, simulationYears, stepsPerYear, trajectory, scenarios[s].forcing, stream);
+                else simulateTrajectory<double>(fishery, industry, modelChoice, simulationYears, stepsPerYear, trajectory, scenarios[s].forcing, stream);
+
+                if (validatePrecision)
+                {
+                    const std::vector<double>& reference = singlePrecision ? checkTrajectory : trajectory;
+                    const std::vector<double>& single = singlePrecision ? trajectory : checkTrajectory;
+                    for (std::size_t i = 0; i < reference.size(); ++i)
+                    {
+                        double error = std::fabs(single[i] - reference[i]);
+                        chunkAbsoluteErrors[chunk][i % modelVariables].add(error);
+                        if (reference[i] != 0.0) chunkRelativeErrors[chunk][i % modelVariables].add(error / std::fabs(reference[i]));
+                    }
+                }
+                if (scenarioCount == 1)
+                {
+                    values.swap(trajectory);
+                    break;
+                }
+
+                std::size_t variables = variableNames.size();
+                for (int year = 0; year <= simulationYears; ++year)
+                {
+                    for (std::size_t v = 0; v < modelVariables; ++v)
+                    {
+                        double value = trajectory[year * modelVariables + v];
+                        values[year * variables + s * modelVariables + v] = value;
+                        if (s > 0)
+                        {
+                            std::size_t difference = (scenarioCount + s - 1) * modelVariables + v;
+                            values[year * variables + difference] = value - values[year * variables + v];
+                        }
+                    }
+                }
+            }
+            chunkStatistics[chunk].addReplicate(values);
+        }
+    });
+
+    EnsembleStatistics statistics = chunkStatistics[0];
+    std::vector<RunningMoments> absoluteErrors = chunkAbsoluteErrors[0];
+    std::vector<RunningMoments> relativeErrors = chunkRelativeErrors[0];
+    for (std::size_t chunk = 1; chunk < chunkCount; ++chunk)
+    {
+        statistics.merge(chunkStatistics[chunk]);
+        for (std::size_t v = 0; v < modelVariables; ++v)
+        {
+            absoluteErrors[v].merge(chunkAbsoluteErrors[chunk][v]);
+            relativeErrors[v].merge(chunkRelativeErrors[chunk][v]);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    //console fan chart of the first output
+    printf("%s\n", variableNames[0].c_str());
+    printf("Year | %14s | %14s | %14s | %14s\n", "Mean", "5%", "Median", "95%");
+    printf("----------------------------------------------------------------------------\n");
+    for (int year = 0; year <= simulationYears; ++year)
+    {
+        printf("%4d | %14.4f | %14.4f | %14.4f | %14.4f\n", year, statistics.getMoments(0, year).getMean(),
+            statistics.getQuantile(0, year, 0.05), statistics.getQuantile(0, year, 0.5), statistics.getQuantile(0, year, 0.95));
+    }
+
+    //the 95% confidence interval of each paired difference, against the interval of independent runs
+    if (scenarioCount > 1)
+    {
+        printf("\nPaired differences from %s in year %d (95%% confidence half-widths)\n", scenarios[0].name.c_str(), simulationYears);
+        printf("%-32s | %14s | %14s | %14s | %9s\n", "Difference", "Mean", "Paired", "Independent", "Var Ratio");
+        printf("--------------------------------------------------------------------------------------------------\n");
+        double scale = 1.96 / std::sqrt(static_cast<double>(replicates));
+        for (std::size_t s = 1; s < scenarioCount; ++s)
+        {
+            for (std::size_t v = 0; v < modelVariables; ++v)
+            {
+                std::size_t difference = (scenarioCount + s - 1) * modelVariables + v;
+                const RunningMoments& paired = statistics.getMoments(difference, simulationYears);
+                double independentVariance = statistics.getMoments(s * modelVariables + v, simulationYears).getVariance() +
+                    statistics.getMoments(v, simulationYears).getVariance();
+                double pairedVariance = paired.getVariance();
+                printf("%-32s | %14.4f | %14.4f | %14.4f | %9.2f\n", variableNames[difference].c_str(), paired.getMean(),
+                    scale * std::sqrt(pairedVariance), scale * std::sqrt(independentVariance),
+                    (pairedVariance > 0.0) ? independentVariance / pairedVariance : std::numeric_limits<double>::infinity());
+            }
+        }
+    }
+
+    //the float32 rounding error against the replicate spread (the ensemble standard deviation, averaged over the years)
+    std::vector<double> errorToSpread(modelVariables, 0.0);
+    if (validatePrecision)
+    {
+        printf("\nPrecision check: float32 against float64 (all replicates, scenarios and years)\n");
+        printf("%-24s | %14s | %14s | %14s | %14s\n", "Output", "Mean Abs Error", "Max Abs Error", "Max Rel Error", "Max Err/Spread");
+        printf("--------------------------------------------------------------------------------------------\n");
+        for (std::size_t v = 0; v < modelVariables; ++v)
+        {
+            double spread = 0.0;
+            for (int year = 0; year <= simulationYears; ++year) spread += statistics.getMoments(v, year).getStdDev() / (simulationYears + 1);
+            errorToSpread[v] = (spread > 0.0) ? absoluteErrors[v].getMax() / spread : std::numeric_limits<double>::infinity();
+            printf("%-24s | %14.6g | %14.6g | %14.6g | %14.6g\n", modelVariableNames[v].c_str(), absoluteErrors[v].getMean(),
+                absoluteErrors[v].getMax(), relativeErrors[v].getMax(), errorToSpread[v]);
+        }
+    }
+    printf("%s\n", durationString.c_str());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "ensemble_" + modelName + "_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Ensemble of " + modelName + " (" + std::to_string(replicates) + " replicates, seed " + std::to_string(seed) + ")");
+    logger.writeComment("Variance reduction: " + varianceReductionName);
+    logger.writeComment("Precision: " + precision);
+    if (validatePrecision)
+    {
+        for (std::size_t v = 0; v < modelVariables; ++v)
+        {
+            std::stringstream check;
+            check << "Precision check " << modelVariableNames[v] << ": mean abs error " << absoluteErrors[v].getMean() << ", max abs error "
+                << absoluteErrors[v].getMax() << ", max rel error " << relativeErrors[v].getMax() << ", max error / spread " << errorToSpread[v];
+            logger.writeComment(check.str());
+        }
+    }
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("ensemble").dump(4) << "\n" << params.at(modelName).dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logEnvironmentalForcing(logger, params, scenarios[0].forcing);
+
+    std::string header = "Year,Variable,Count,Mean,StdDev,Min,Max";
+    for (double q : quantiles)
+    {
+        header += ",Q" + std::to_string(q).substr(0, 5);
+    }
+    logger.writeHeader(header);
+    for (std::size_t v = 0; v < variableNames.size(); ++v)
+    {
+        for (int year = 0; year <= simulationYears; ++year)
+        {
+            const RunningMoments& moments = statistics.getMoments(v, year);
+            std::vector<double> values = { static_cast<double>(moments.getCount()), moments.getMean(), moments.getStdDev(), moments.getMin(), moments.getMax() };
+            for (double q : quantiles)
+            {
+                values.push_back(statistics.getQuantile(v, year, q));
+            }
+            logger.writeRow(std::to_string(year) + "," + variableNames[v], values);
+        }
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+
+    bool anyHistogram = false;
+    for (const FixedHistogram& histogram : histograms) anyHistogram = anyHistogram || histogram.isEnabled();
+    if (anyHistogram)
+    {
+        std::string histogramFilename = "ensemble_histograms_" + modelName + "_" + timestamp + ".csv";
+        logger.open(histogramFilename);
+        logger.writeComment("Histograms of " + modelName + " ensemble (" + std::to_string(replicates) + " replicates)");
+        logger.writeComment("");
+        logger.writeHeader("Year,Variable,BinLower,BinUpper,Count");
+        for (std::size_t v = 0; v < variableNames.size(); ++v)
+        {
+            if (!histograms[v].isEnabled()) continue;
+            for (int year = 0; year <= simulationYears; ++year)
+            {
+                const FixedHistogram& histogram = statistics.getHistogram(v, year);
+                std::string label = std::to_string(year) + "," + variableNames[v];
+                logger.writeRow(label, { -std::numeric_limits<double>::infinity(), histogram.getBinLower(0), static_cast<double>(histogram.getUnderflow()) });
+                for (std::size_t bin = 0; bin < histogram.getBinCount(); ++bin)
+                {
+                    logger.writeRow(label, { histogram.getBinLower(bin), histogram.getBinUpper(bin), static_cast<double>(histogram.getCount(bin)) });
+                }
+                logger.writeRow(label, { histogram.getBinUpper(histogram.getBinCount() - 1), std::numeric_limits<double>::infinity(), static_cast<double>(histogram.getOverflow()) });
+            }
+        }
+        logger.close();
+        std::cout << getCurrentWorkingDirectory() << "/" << histogramFilename << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Runs the equilibrium analysis configured in the "equilibriumAnalysis" section of parameters.json.
+ * Uses the Leslie (matrix) form of the deterministic age-structured model: checks the matrix projection
+ * against the year-by-year step, projects far ahead by repeated squaring, and evaluates the equilibrium
+ * biomass, SSB, yield and convergence rate over a grid of fishing mortalities. With a stock-recruitment
+ * relationship, the grid equilibria use the equilibrium recruitment at each fishing mortality.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runEquilibriumAnalysis(const json& params)
+{
+    double fishingMortalityMin = 0.0;
+    double fishingMortalityMax = 0.0;
+    int gridPoints = 0;
+    unsigned long long projectionYears = 0;
+
+    try
+    {
+        auto analysisParams = params.at("equilibriumAnalysis");
+        fishingMortalityMin = analysisParams.at("fishingMortalityMin").get<double>();
+        fishingMortalityMax = analysisParams.at("fishingMortalityMax").get<double>();
+        gridPoints = analysisParams.at("gridPoints").get<int>();
+        projectionYears = analysisParams.at("projectionYears").get<unsigned long long>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing equilibrium analysis parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    if (gridPoints < 2 || fishingMortalityMin < 0.0 || !(fishingMortalityMin < fishingMortalityMax))
+    {
+        std::cout << "Error: The fishing mortality grid needs 0 <= min < max and at least 2 points." << std::endl;
+        return 1;
+    }
+
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    AgeModelParameters<double> baseParams = getAgeModelParameters(myFishery, myFishingIndustry);
+    std::vector<double> initialNumbers = myFishery.getNumbersAtAge();
+
+    //a plus group that never declines makes (I - A) singular, so there is no equilibrium at that F
+    //the plus-group mortality grows with F, so checking the base F and the grid minimum covers every F solved for
+    auto plusGroupSurvival = [&](double fishingMortality)
+    {
+        return std::exp(-(baseParams.naturalMortality + fishingMortality * getSelectivityAtAge(baseParams.maxAge, baseParams)));
+    };
+    for (double fishingMortality : { baseParams.fishingMortality, fishingMortalityMin })
+    {
+        if (!(plusGroupSurvival(fishingMortality) < 1.0))
+        {
+            std::cout << "Error: No equilibrium for F = " << fishingMortality << ": the plus group has no mortality. Use a positive naturalMortality or fishing mortality." << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "--- Equilibrium Analysis (Leslie Matrix) ---" << std::endl;
+    if (myFishery.getRecruitmentStdDev() > 0.0)
+    {
+        std::cout << "Note: recruitmentStdDev is ignored, the matrix form is deterministic." << std::endl;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    //check the matrix projection against the year-by-year step
+    LeslieModel baseModel(baseParams);
+    std::vector<double> stepped = initialNumbers;
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        AgeStructuredModelStep(stepped, baseParams, baseParams.constantRecruitment);
+    }
+    std::vector<double> projected = baseModel.project(initialNumbers, simulationYears);
+    double maxRelativeDifference = 0.0;
+    for (std::size_t age = 0; age < stepped.size(); ++age)
+    {
+        double scale = std::max(std::fabs(stepped[age]), 1e-300);
+        maxRelativeDifference = std::max(maxRelativeDifference, std::fabs(projected[age] - stepped[age]) / scale);
+    }
+
+    std::vector<double> longHorizon = baseModel.project(initialNumbers, projectionYears);
+    std::vector<double> baseEquilibrium = baseModel.equilibrium();
+
+    printf("Matrix vs step projection over %d years: max relative difference %.3g\n", simulationYears, maxRelativeDifference);
+    printf("Biomass after %llu years: %.2f (equilibrium %.2f)\n", projectionYears, baseModel.getTotalBiomass(longHorizon), baseModel.getTotalBiomass(baseEquilibrium));
+    printf("Dominant eigenvalue at F = %.4f: %.6f\n\n", baseParams.fishingMortality, baseModel.dominantEigenvalue());
+
+    //equilibrium over the fishing mortality grid
+    //the matrix equilibrium is for recruitment R0; it scales linearly to the stock-recruitment equilibrium
+    double unfishedSSB = getUnfishedSpawningStockBiomass(baseParams);
+    std::vector<std::vector<double>> results(gridPoints);
+    ThreadPool::shared().parallelFor(static_cast<std::size_t>(gridPoints), [&](std::size_t i)
+    {
+        AgeModelParameters<double> gridParams = baseParams;
+        gridParams.fishingMortality = fishingMortalityMin + (fishingMortalityMax - fishingMortalityMin) * i / (gridPoints - 1);
+        LeslieModel model(gridParams);
+        std::vector<double> equilibrium = model.equilibrium();
+        if (gridParams.stockRecruitment != StockRecruitment::Constant)
+        {
+            double spawnersPerRecruit = model.getSpawningStockBiomass(equilibrium) / gridParams.constantRecruitment;
+            double scale = getEquilibriumRecruitment(spawnersPerRecruit, gridParams, unfishedSSB) / gridParams.constantRecruitment;
+            for (double& numbers : equilibrium) numbers *= scale;
+        }
+        results[i] = { gridParams.fishingMortality, model.getTotalBiomass(equilibrium), model.getSpawningStockBiomass(equilibrium),
+            model.getCatch(equilibrium), model.dominantEigenvalue() };
+    }, 16);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < results.size(); ++i)
+    {
+        if (results[i][3] > results[best][3]) best = i;
+    }
+
+    printf("F        | Equilibrium Biomass | Equilibrium SSB | Equilibrium Yield | Eigenvalue\n");
+    printf("-------------------------------------------------------------------------------------\n");
+    int printEvery = std::max(1, gridPoints / 20);
+    for (int i = 0; i < gridPoints; ++i)
+    {
+        if (i % printEvery != 0 && i != gridPoints - 1 && static_cast<std::size_t>(i) != best) continue;
+        printf("%8.4f | %19.2f | %15.2f | %17.2f | %10.6f%s\n", results[i][0], results[i][1], results[i][2], results[i][3], results[i][4],
+            static_cast<std::size_t>(i) == best ? "  <- max yield" : "");
+    }
+    printf("%s\n", durationString.c_str());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "equilibrium_analysis_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Equilibrium Analysis (Leslie Matrix) of ageStructuredModel");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("equilibriumAnalysis").dump(4) << "\n" << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    logger.writeHeader("FishingMortality,EquilibriumBiomass,EquilibriumSSB,EquilibriumYield,DominantEigenvalue");
+    for (const std::vector<double>& row : results)
+    {
+        logger.writeRow(std::to_string(row[0]), std::vector<double>(row.begin() + 1, row.end()));
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Runs the seasonal age-structured model configured in the "seasonalAgeModel" section of parameters.json.
+ * Uses the biological parameters, initial numbers and simulation length of "ageStructuredModel", splits every
+ * year into stepsPerYear seasons with the given seasonal fishing pattern, and logs one row per season.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runSeasonalAgeModel(const json& params)
+{
+    int seasonsPerYear = 0;
+    std::vector<double> seasonalFishingPattern;
+
+    try
+    {
+        auto seasonalParams = params.at("seasonalAgeModel");
+        seasonsPerYear = seasonalParams.at("stepsPerYear").get<int>();
+        if (seasonalParams.contains("seasonalFishingPattern"))
+        {
+            seasonalFishingPattern = seasonalParams.at("seasonalFishingPattern").get<std::vector<double>>();
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing seasonal age model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    if (seasonsPerYear < 1)
+    {
+        std::cout << "Error: seasonalAgeModel.stepsPerYear must be at least 1." << std::endl;
+        return 1;
+    }
+    if (!seasonalFishingPattern.empty() && static_cast<int>(seasonalFishingPattern.size()) != seasonsPerYear)
+    {
+        std::cout << "Error: seasonalFishingPattern needs one value per step (" << seasonsPerYear << ")." << std::endl;
+        return 1;
+    }
+    if (!seasonalFishingPattern.empty() && !(std::accumulate(seasonalFishingPattern.begin(), seasonalFishingPattern.end(), 0.0) > 0.0))
+    {
+        std::cout << "Error: seasonalFishingPattern must have a positive sum." << std::endl;
+        return 1;
+    }
+
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    SeasonalAgeModel model(getAgeModelParameters(myFishery, myFishingIndustry), seasonsPerYear, seasonalFishingPattern);
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "seasonal_age_structured_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Seasonal Age-Structured Model");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("seasonalAgeModel").dump(4) << "\n" << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    //biomass and SSB at the start of each season, catch during the season
+    logger.writeHeader("Time,Year,Season,TotalBiomass,SpawningStockBiomass,SeasonCatch");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::cout << "--- Seasonal Age-Structured Model Simulation (" << seasonsPerYear << " steps per year) ---" << std::endl;
+    printf("Year | Total Biomass | Spawning Biomass | Total Catch (Biomass)\n");
+    printf("----------------------------------------------------------------------\n");
+
+    std::vector<double> numbersAtAge = myFishery.getNumbersAtAge();
+    std::vector<double> catchAtAge(numbersAtAge.size());
+    printf("%4d | %15.2f | %18.2f | %20.2f\n", 0, model.getTotalBiomass(numbersAtAge), model.getSpawningStockBiomass(numbersAtAge), 0.0);
+
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        //the spawning stock at the start of the year produces the recruits added at its end
+        double spawningStock = model.getSpawningStockBiomass(numbersAtAge);
+        double totalCatch = 0.0;
+        for (int season = 0; season < seasonsPerYear; ++season)
+        {
+            double biomass = model.getTotalBiomass(numbersAtAge, season);
+            double ssb = model.getSpawningStockBiomass(numbersAtAge, season);
+            double seasonCatch = model.stepSeason(numbersAtAge, season, catchAtAge);
+            totalCatch += seasonCatch;
+
+            double time = (year - 1) + static_cast<double>(season) / seasonsPerYear;
+            logger.writeRow(std::to_string(time), { static_cast<double>(year), static_cast<double>(season + 1), biomass, ssb, seasonCatch });
+        }
+        model.advanceYear(numbersAtAge, myFishery.getRecruitment(spawningStock));
+
+        printf("%4d | %15.2f | %18.2f | %20.2f\n", year, model.getTotalBiomass(numbersAtAge), model.getSpawningStockBiomass(numbersAtAge), totalCatch);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Runs the length-structured model configured in the "lengthStructuredModel" section of parameters.json.
+ * Shares the growth, weight, mortality, recruitment and initial numbers of "ageStructuredModel". Replicates with
+ * independent recruitment noise are simulated in parallel groups; within a group the populations are stored
+ * interleaved so the growth-transition matrix is applied to all of them in one blocked product.
+ * Writes the per-year mean and standard deviation of biomass, SSB and catch.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runLengthStructuredModel(const json& params)
+{
+    LengthModelSettings settings;
+    std::size_t replicates = 0;
+    std::uint32_t seed = 0;
+
+    try
+    {
+        auto lengthParams = params.at("lengthStructuredModel");
+        settings.lengthBins = lengthParams.at("lengthBins").get<int>();
+        settings.maxLength = lengthParams.at("maxLength").get<double>();
+        settings.growthCV = lengthParams.at("growthCV").get<double>();
+        settings.lengthAtAgeCV = lengthParams.at("lengthAtAgeCV").get<double>();
+        settings.selectivity_L50 = lengthParams.at("selectivity_L50").get<double>();
+        settings.selectivity_slope = lengthParams.at("selectivity_slope").get<double>();
+        settings.maturity_L50 = lengthParams.at("maturity_L50").get<double>();
+        settings.maturity_slope = lengthParams.at("maturity_slope").get<double>();
+        replicates = lengthParams.at("replicates").get<std::size_t>();
+        seed = lengthParams.at("seed").get<std::uint32_t>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing length-structured model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    if (settings.lengthBins < 2 || !(settings.maxLength > 0.0) || settings.growthCV < 0.0 || settings.lengthAtAgeCV < 0.0)
+    {
+        std::cout << "Error: The length-structured model needs at least 2 length bins, a positive maxLength and non-negative CVs." << std::endl;
+        return 1;
+    }
+    if (replicates == 0)
+    {
+        std::cout << "Error: The length-structured model needs at least one replicate." << std::endl;
+        return 1;
+    }
+
+    Fishery prototypeFishery = Fishery();
+    FishingIndustry prototypeIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, prototypeFishery, prototypeIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    if (seed == 0)
+    {
+        std::random_device rd;
+        seed = rd();
+    }
+
+    LengthStructuredModel model(getAgeModelParameters(prototypeFishery, prototypeIndustry), settings);
+    std::vector<double> initialNumbers = model.getNumbersAtLength(prototypeFishery.getNumbersAtAge());
+    std::size_t bins = model.getBinCount();
+
+    //the stock-recruitment relationship is anchored to the length model's own unfished spawning stock
+    double unfishedSSB = model.getUnfishedSpawningStockBiomass();
+
+    //populations simulated together by one task, interleaved bin by bin
+    const std::size_t groupSize = 64;
+    std::size_t groupCount = (replicates + groupSize - 1) / groupSize;
+    const std::size_t outputs = 3;
+    std::vector<std::vector<RunningMoments>> groupMoments(groupCount, std::vector<RunningMoments>((simulationYears + 1) * outputs));
+
+    std::cout << "--- Length-Structured Model Simulation ---" << std::endl;
+    printf("%zu length bins, growth matrix with %zu non-zeros (%.1f%% dense)\n", bins, model.getGrowthMatrix().getNonZeroCount(),
+        100.0 * model.getGrowthMatrix().getNonZeroCount() / (bins * bins));
+    std::cout << replicates << " replicates on " << ThreadPool::shared().size() << " threads, seed " << seed << std::endl;
+    std::cout << "Unfished spawning stock biomass of the length model: " << unfishedSSB << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    ThreadPool::shared().parallelFor(groupCount, [&](std::size_t group)
+    {
+        std::size_t first = group * groupSize;
+        std::size_t count = std::min(groupSize, replicates - first);
+
+        std::vector<Fishery> fisheries(count, prototypeFishery);
+        std::vector<double> numbers(bins * count);
+        for (std::size_t v = 0; v < count; ++v)
+        {
+            fisheries[v].setSeed(seed, static_cast<std::uint32_t>(first + v));
+            for (std::size_t bin = 0; bin < bins; ++bin) numbers[bin * count + v] = initialNumbers[bin];
+        }
+
+        std::vector<RunningMoments>& moments = groupMoments[group];
+        std::vector<double> recruitment(count), totalCatch(count, 0.0), scratch;
+        for (int year = 0; year <= simulationYears; ++year)
+        {
+            if (year > 0)
+            {
+                for (std::size_t v = 0; v < count; ++v)
+                {
+                    double ssb = model.getSpawningStockBiomass(numbers, count, v);
+                    recruitment[v] = fisheries[v].getExpectedRecruitment(ssb, unfishedSSB) * fisheries[v].getRecruitmentMultiplier();
+                }
+                model.stepBlock(numbers, count, recruitment.data(), scratch, totalCatch.data());
+            }
+            for (std::size_t v = 0; v < count; ++v)
+            {
+                moments[year * outputs + 0].add(model.getTotalBiomass(numbers, count, v));
+                moments[year * outputs + 1].add(model.getSpawningStockBiomass(numbers, count, v));
+                moments[year * outputs + 2].add(totalCatch[v]);
+            }
+        }
+    }, 1);
+
+    std::vector<RunningMoments> moments = groupMoments[0];
+    for (std::size_t group = 1; group < groupCount; ++group)
+    {
+        for (std::size_t cell = 0; cell < moments.size(); ++cell) moments[cell].merge(groupMoments[group][cell]);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    printf("Year | Mean Total Biomass | Mean Spawning Biomass | Mean Catch (Biomass)\n");
+    printf("------------------------------------------------------------------------------\n");
+    for (int year = 0; year <= simulationYears; ++year)
+    {
+        printf("%4d | %18.2f | %21.2f | %20.2f\n", year, moments[year * outputs + 0].getMean(),
+            moments[year * outputs + 1].getMean(), moments[year * outputs + 2].getMean());
+    }
+    printf("%s\n", durationString.c_str());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "length_structured_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Length-Structured Model (" + std::to_string(replicates) + " replicates, seed " + std::to_string(seed) + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("lengthStructuredModel").dump(4) << "\n" << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("Unfished spawning stock biomass: " + std::to_string(unfishedSSB));
+    logger.writeComment("");
+
+    logger.writeHeader("Year,MeanTotalBiomass,StdDevTotalBiomass,MeanSpawningStockBiomass,StdDevSpawningStockBiomass,MeanTotalCatch,StdDevTotalCatch");
+    for (int year = 0; year <= simulationYears; ++year)
+    {
+        std::vector<double> row;
+        for (std::size_t output = 0; output < outputs; ++output)
+        {
+            row.push_back(moments[year * outputs + output].getMean());
+            row.push_back(moments[year * outputs + output].getStdDev());
+        }
+        logger.writeRow(std::to_string(year), row);
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Runs the individual-based model configured in the "individualBasedModel" section of parameters.json.
+ * The population is seeded from the initialNumbers of "ageStructuredModel", scaled by individualsPerFish.
+ * The aggregated AgeStructuredModelStep is run alongside with the same recruitment deviations, so the two
+ * trajectories can be compared year by year.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runIndividualBasedModel(const json& params)
+{
+    IndividualModelSettings settings;
+
+    try
+    {
+        auto individualParams = params.at("individualBasedModel");
+        settings.individualsPerFish = individualParams.at("individualsPerFish").get<double>();
+        settings.linfCV = individualParams.at("linfCV").get<double>();
+        settings.seed = individualParams.at("seed").get<std::uint32_t>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing individual-based model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!(settings.individualsPerFish > 0.0) || settings.linfCV < 0.0)
+    {
+        std::cout << "Error: individualsPerFish must be positive and linfCV non-negative." << std::endl;
+        return 1;
+    }
+
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    if (settings.seed == 0)
+    {
+        std::random_device rd;
+        settings.seed = rd();
+    }
+    myFishery.setSeed(settings.seed);
+
+    ThreadPool& pool = ThreadPool::shared();
+    AgeModelParameters<double> ageParams = getAgeModelParameters(myFishery, myFishingIndustry);
+    std::vector<double> numbersAtAge = myFishery.getNumbersAtAge();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    IndividualBasedModel model(ageParams, settings);
+    model.initialize(numbersAtAge, pool);
+
+    std::cout << "--- Individual-Based Model Simulation ---" << std::endl;
+    std::cout << model.getArena().size() << " initial individuals (" << settings.individualsPerFish << " per fish) on "
+        << pool.size() << " threads, seed " << settings.seed << std::endl;
+    printf("Year | Individuals | Total Biomass (IBM / Age) | Spawning Biomass (IBM / Age) | Total Catch (IBM / Age)\n");
+    printf("---------------------------------------------------------------------------------------------------------------\n");
+
+    //year, individuals, then the IBM and age model value of biomass, SSB and catch
+    std::vector<std::vector<double>> results;
+    results.push_back({ 0.0, static_cast<double>(model.getArena().size()), model.getTotalBiomass(pool), getTotalBiomass(numbersAtAge, ageParams),
+        model.getSpawningStockBiomass(pool), getSpawningStockBiomass(numbersAtAge, ageParams), 0.0, 0.0 });
+
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        //both forms share the recruitment deviation, each applies it to its own spawning stock
+        double deviation = myFishery.getRecruitmentMultiplier();
+        double recruitment = myFishery.getExpectedRecruitment(results.back()[4]) * deviation;
+        double ageModelRecruitment = myFishery.getExpectedRecruitment(results.back()[5]) * deviation;
+        IndividualYearSummary summary = model.stepYear(recruitment, static_cast<std::uint32_t>(year), pool);
+        double ageModelCatch = AgeStructuredModelStep(numbersAtAge, ageParams, ageModelRecruitment);
+
+        results.push_back({ static_cast<double>(year), static_cast<double>(model.getArena().size()), model.getTotalBiomass(pool),
+            getTotalBiomass(numbersAtAge, ageParams), model.getSpawningStockBiomass(pool), getSpawningStockBiomass(numbersAtAge, ageParams),
+            summary.totalCatch, ageModelCatch });
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    double maxRelativeDifference = 0.0;
+    for (const std::vector<double>& row : results)
+    {
+        printf("%4.0f | %11.0f | %12.2f / %12.2f | %13.2f / %13.2f | %11.2f / %11.2f\n", row[0], row[1], row[2], row[3], row[4], row[5], row[6], row[7]);
+        for (std::size_t column = 2; column < row.size(); column += 2)
+        {
+            if (row[column + 1] > 0.0) maxRelativeDifference = std::max(maxRelativeDifference, std::fabs(row[column] / row[column + 1] - 1.0));
+        }
+    }
+    printf("Max relative difference to the age model: %.4f\n", maxRelativeDifference);
+    printf("%s\n", durationString.c_str());
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "individual_based_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Individual-Based Model (seed " + std::to_string(settings.seed) + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("individualBasedModel").dump(4) << "\n" << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    logger.writeHeader("Year,Individuals,TotalBiomass,AgeModelTotalBiomass,SpawningStockBiomass,AgeModelSpawningStockBiomass,TotalCatch,AgeModelTotalCatch");
+    for (const std::vector<double>& row : results)
+    {
+        logger.writeRow(std::to_string(static_cast<int>(row[0])), std::vector<double>(row.begin() + 1, row.end()));
+    }
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Reads the fleets of a "fleets" array in parameters.json.
+ * Each fleet gives either "fishingMortality" or "effort" and "catchability", plus its selectivity ogive,
+ * "price" per unit of catch biomass and "costPerEffort".
+ * @return True on success, false (after printing the error) on a missing or invalid value.
+ */
+bool loadFleetsFromJSON(const json& fleetParams, std::vector<FishingFleet>& fleets)
+{
+    fleets.clear();
+    try
+    {
+        for (const json& entry : fleetParams)
+        {
+            FishingFleet fleet;
+            fleet.name = entry.at("name").get<std::string>();
+            if (entry.contains("fishingMortality"))
+            {
+                fleet.effort = entry.value("effort", 1.0);
+                fleet.catchability = entry.at("fishingMortality").get<double>() / fleet.effort;
+            }
+            else
+            {
+                fleet.effort = entry.at("effort").get<double>();
+                fleet.catchability = entry.at("catchability").get<double>();
+            }
+            fleet.selectivity_A50 = entry.at("selectivity_A50").get<double>();
+            fleet.selectivity_k = entry.at("selectivity_k").get<double>();
+            fleet.price = entry.at("price").get<double>();
+            fleet.costPerEffort = entry.at("costPerEffort").get<double>();
+
+            if (!(fleet.effort > 0.0) || fleet.catchability < 0.0)
+            {
+                std::cout << "Error: Fleet '" << fleet.name << "' needs a positive effort and a non-negative fishing mortality." << std::endl;
+                return false;
+            }
+            fleets.push_back(fleet);
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing fleet parameter in JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+
+    if (fleets.empty())
+    {
+        std::cout << "Error: At least one fleet is required." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the multi-fleet age-structured model configured in the "multiFleetModel" section of parameters.json.
+ * Uses the biology, recruitment and initial numbers of "ageStructuredModel"; its single fishingMortality and
+ * selectivity are replaced by the fleets. Logs the catch and profit of every fleet per year.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runMultiFleetModel(const json& params)
+{
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 3, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading age-structured model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    std::vector<FishingFleet> fleets;
+    try
+    {
+        if (!loadFleetsFromJSON(params.at("multiFleetModel").at("fleets"), fleets))
+        {
+            return 1;
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing multi-fleet model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    myFishingIndustry.setFleets(fleets);
+
+    MultiFleetAgeModel model(getAgeModelParameters(myFishery, myFishingIndustry), myFishingIndustry.getFleets());
+    std::size_t fleetCount = fleets.size();
+    std::vector<double> fleetFishingMortality;
+    for (const FishingFleet& fleet : fleets)
+    {
+        fleetFishingMortality.push_back(fleet.getFishingMortality());
+    }
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "multi_fleet_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Multi-Fleet Age-Structured Model");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("multiFleetModel").dump(4) << "\n" << params.at("ageStructuredModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    std::string header = "Year,TotalBiomass,SpawningStockBiomass,TotalCatch";
+    for (const FishingFleet& fleet : fleets)
+    {
+        header += "," + fleet.name + "_Catch," + fleet.name + "_Profit";
+    }
+    logger.writeHeader(header);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::cout << "--- Multi-Fleet Age-Structured Model Simulation (" << fleetCount << " fleets) ---" << std::endl;
+    printf("Year | Total Biomass | Spawning Biomass | Total Catch (Biomass) | Total Profit\n");
+    printf("-------------------------------------------------------------------------------------\n");
+
+    std::vector<double> numbersAtAge = myFishery.getNumbersAtAge();
+    std::vector<double> fleetCatch(fleetCount, 0.0);
+    std::vector<double> cumulativeCatch(fleetCount, 0.0), cumulativeRevenue(fleetCount, 0.0), cumulativeCost(fleetCount, 0.0);
+
+    double initialTotalBiomass = model.getTotalBiomass(numbersAtAge);
+    double initialSSB = model.getSpawningStockBiomass(numbersAtAge);
+    printf("%4d | %15.2f | %18.2f | %21.2f | %12.2f\n", 0, initialTotalBiomass, initialSSB, 0.0, 0.0);
+    std::vector<double> row = { initialTotalBiomass, initialSSB, 0.0 };
+    row.resize(3 + 2 * fleetCount, 0.0);
+    logger.writeRow("0", row);
+
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        double recruitment = myFishery.getRecruitment(model.getSpawningStockBiomass(numbersAtAge));
+        double totalCatch = model.step(numbersAtAge, fleetFishingMortality, recruitment, fleetCatch);
+        double totalBiomass = model.getTotalBiomass(numbersAtAge);
+        double ssb = model.getSpawningStockBiomass(numbersAtAge);
+
+        row = { totalBiomass, ssb, totalCatch };
+        double totalProfit = 0.0;
+        for (std::size_t fleet = 0; fleet < fleetCount; ++fleet)
+        {
+            double revenue = fleets[fleet].price * fleetCatch[fleet];
+            double cost = fleets[fleet].costPerEffort * fleets[fleet].effort;
+            cumulativeCatch[fleet] += fleetCatch[fleet];
+            cumulativeRevenue[fleet] += revenue;
+            cumulativeCost[fleet] += cost;
+            totalProfit += revenue - cost;
+            row.push_back(fleetCatch[fleet]);
+            row.push_back(revenue - cost);
+        }
+
+        printf("%4d | %15.2f | %18.2f | %21.2f | %12.2f\n", year, totalBiomass, ssb, totalCatch, totalProfit);
+        logger.writeRow(std::to_string(year), row);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    printf("\nFleet                | Total Catch (Biomass) | Revenue         | Cost            | Profit\n");
+    printf("----------------------------------------------------------------------------------------------\n");
+    for (std::size_t fleet = 0; fleet < fleetCount; ++fleet)
+    {
+        printf("%-20s | %21.2f | %15.2f | %15.2f | %15.2f\n", fleets[fleet].name.c_str(), cumulativeCatch[fleet],
+            cumulativeRevenue[fleet], cumulativeCost[fleet], cumulativeRevenue[fleet] - cumulativeCost[fleet]);
+    }
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief A precision target of the adaptive ensemble: a statistic of one output and the confidence
+ * interval half-width it must reach.
+ */
+struct PrecisionTarget
+{
+    std::string label;
+    std::size_t variable = 0;
+
+    //a simulation year, or yearFinal/yearMinimum/yearAverage (the last year, the trajectory's minimum or average)
+    int year = 0;
+
+    //true for the probability that the output falls below the threshold, false for the mean of the output
+    bool probability = false;
+    double threshold = 0.0;
+
+    //the required half-width, relative to the estimate when relative is true
+    double halfWidth = 0.0;
+    bool relative = false;
+
+    static const int yearFinal = -1;
+    static const int yearMinimum = -2;
+    static const int yearAverage = -3;
+};
+
+/**
+ * @brief Reduces a trajectory to the sample of a precision target (the output, or an indicator for probabilities).
+ * @param trajectory Year-major values as produced by simulateTrajectory.
+ */
+double getTargetSample(const PrecisionTarget& target, const std::vector<double>& trajectory, std::size_t variables, int simulationYears)
+{
+    double value = 0.0;
+    if (target.year == PrecisionTarget::yearMinimum || target.year == PrecisionTarget::yearAverage)
+    {
+        double minimum = std::numeric_limits<double>::infinity();
+        double sum = 0.0;
+        for (int year = 1; year <= simulationYears; ++year)
+        {
+            double yearValue = trajectory[year * variables + target.variable];
+            minimum = std::min(minimum, yearValue);
+            sum += yearValue;
+        }
+        value = (target.year == PrecisionTarget::yearMinimum) ? minimum : sum / std::max(1, simulationYears);
+    }
+    else
+    {
+        int year = (target.year == PrecisionTarget::yearFinal) ? simulationYears : target.year;
+        value = trajectory[year * variables + target.variable];
+    }
+
+    if (target.probability) return (value < target.threshold) ? 1.0 : 0.0;
+    return value;
+}
+
+/**
+ * @brief Runs the adaptive ensemble configured in the "adaptiveEnsemble" section of parameters.json.
+ * Each scenario is simulated in parallel batches of replicates until the confidence interval of every
+ * target (the mean of an output, or the probability that it falls below a threshold) is as narrow as
+ * required, or the replicate budget runs out. Easy scenarios stop after a few batches, while hard ones
+ * keep sampling. Probabilities use the Wilson score interval, which stays valid for rare events. With
+ * antithetic sampling the samples are the averages of each pair, and the intervals use the pairs' spread;
+ * a probability interval is never narrower than the Wilson interval of the replicates, since the pairs'
+ * spread is exactly 0 until the first event.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runAdaptiveEnsemble(const json& params)
+{
+    std::string modelName;
+    std::uint32_t seed = 0;
+    std::string varianceReductionName;
+    double confidence = 0.0;
+    std::size_t batchSize = 0;
+    std::size_t minReplicates = 0;
+    std::size_t maxReplicates = 0;
+    json targetParams;
+    json scenarioParams;
+
+    try
+    {
+        auto ensembleParams = params.at("adaptiveEnsemble");
+        modelName = ensembleParams.at("model").get<std::string>();
+        seed = ensembleParams.at("seed").get<std::uint32_t>();
+        varianceReductionName = ensembleParams.at("varianceReduction").get<std::string>();
+        confidence = ensembleParams.at("confidence").get<double>();
+        batchSize = ensembleParams.at("batchSize").get<std::size_t>();
+        minReplicates = ensembleParams.at("minReplicates").get<std::size_t>();
+        maxReplicates = ensembleParams.at("maxReplicates").get<std::size_t>();
+        targetParams = ensembleParams.at("targets");
+        scenarioParams = ensembleParams.at("scenarios");
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing adaptive ensemble parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice == 0)
+    {
+        std::cout << "Error: Unknown model '" << modelName << "'. Use simpleModel, delayModel or ageStructuredModel." << std::endl;
+        return 1;
+    }
+    VarianceReduction varianceReduction = VarianceReduction::None;
+    if (!parseVarianceReduction(varianceReductionName, varianceReduction) || varianceReduction == VarianceReduction::QuasiMonteCarlo)
+    {
+        //quasi-random points are not independent, so their spread does not give a confidence interval
+        std::cout << "Error: The adaptive ensemble supports the varianceReduction none or antithetic." << std::endl;
+        return 1;
+    }
+    bool antithetic = (varianceReduction == VarianceReduction::Antithetic);
+    if (!(confidence > 0.0 && confidence < 1.0))
+    {
+        std::cout << "Error: 'confidence' must lie in (0, 1)." << std::endl;
+        return 1;
+    }
+    if (batchSize == 0 || maxReplicates == 0 || minReplicates > maxReplicates || (antithetic && (batchSize % 2 != 0 || maxReplicates % 2 != 0)))
+    {
+        std::cout << "Error: batchSize and maxReplicates must be positive (and even for antithetic sampling), with minReplicates <= maxReplicates." << std::endl;
+        return 1;
+    }
+
+    std::vector<EnsembleScenario> scenarios;
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadEnsembleScenarios(params, modelName, modelChoice, scenarioParams, scenarios, simulationYears, stepsPerYear)) return 1;
+    if (simulationYears <= 0)
+    {
+        std::cout << "Error: The adaptive ensemble needs at least one simulation year." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> variableNames = getTrajectoryVariableNames(modelChoice);
+    std::vector<PrecisionTarget> targets;
+    try
+    {
+        for (auto& item : targetParams)
+        {
+            PrecisionTarget target;
+            std::string output = item.at("output").get<std::string>();
+            auto variable = std::find(variableNames.begin(), variableNames.end(), output);
+            if (variable == variableNames.end())
+            {
+                std::cout << "Error: '" << output << "' is not an output of '" << modelName << "'." << std::endl;
+                return 1;
+            }
+            target.variable = static_cast<std::size_t>(variable - variableNames.begin());
+
+            const json& year = item.at("year");
+            std::string yearLabel;
+            if (year.is_number_integer())
+            {
+                target.year = year.get<int>();
+                yearLabel = "year " + std::to_string(target.year);
+                if (target.year < 0 || target.year > simulationYears)
+                {
+                    std::cout << "Error: Target year " << target.year << " is outside the simulation (0-" << simulationYears << ")." << std::endl;
+                    return 1;
+                }
+            }
+            else
+            {
+                yearLabel = year.get<std::string>();
+                if (yearLabel == "final") target.year = PrecisionTarget::yearFinal;
+                else if (yearLabel == "minimum") target.year = PrecisionTarget::yearMinimum;
+                else if (yearLabel == "average") target.year = PrecisionTarget::yearAverage;
+                else
+                {
+                    std::cout << "Error: Target year must be a year, final, minimum or average." << std::endl;
+                    return 1;
+                }
+            }
+
+            std::string statistic = item.at("statistic").get<std::string>();
+            if (statistic == "probabilityBelow")
+            {
+                target.probability = true;
+                target.threshold = item.at("threshold").get<double>();
+            }
+            else if (statistic != "mean")
+            {
+                std::cout << "Error: Target statistic must be mean or probabilityBelow." << std::endl;
+                return 1;
+            }
+
+            target.relative = item.contains("relativeHalfWidth");
+            target.halfWidth = target.relative ? item.at("relativeHalfWidth").get<double>() : item.at("halfWidth").get<double>();
+            if (!(target.halfWidth > 0.0))
+            {
+                std::cout << "Error: The required half-width of a target must be positive." << std::endl;
+                return 1;
+            }
+
+            std::stringstream label;
+            if (target.probability) label << "P(" << output << " " << yearLabel << " < " << target.threshold << ")";
+            else label << "E(" << output << " " << yearLabel << ")";
+            target.label = label.str();
+            targets.push_back(target);
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Invalid adaptive ensemble target in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    if (targets.empty())
+    {
+        std::cout << "Error: The adaptive ensemble needs at least one target." << std::endl;
+        return 1;
+    }
+
+    if (seed == 0)
+    {
+        std::random_device rd;
+        seed = rd();
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    double z = inverseNormalCdf(0.5 + 0.5 * confidence);
+    std::size_t replicatesPerSample = antithetic ? 2 : 1;
+    std::size_t variables = variableNames.size();
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "adaptive_ensemble_" + modelName + "_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Adaptive ensemble of " + modelName + " (seed " + std::to_string(seed) + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("adaptiveEnsemble").dump(4) << "\n" << params.at(modelName).dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logEnvironmentalForcing(logger, params, scenarios[0].forcing);
+    logger.writeHeader("Scenario,Target,Replicates,Estimate,HalfWidth,RequiredHalfWidth,Converged");
+
+    std::cout << "--- Adaptive Ensemble Simulation ---" << std::endl;
+    std::cout << "Model: " << modelName << ", batches of " << batchSize << " replicates on " << pool.size() << " threads, seed " << seed
+        << ", " << confidence * 100.0 << "% confidence intervals" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    struct ScenarioResult
+    {
+        std::size_t replicates = 0;
+        bool converged = false;
+        std::vector<double> estimates;
+        std::vector<double> halfWidths;
+    };
+    std::vector<ScenarioResult> results(scenarios.size());
+
+    for (std::size_t s = 0; s < scenarios.size(); ++s)
+    {
+        const EnsembleScenario& scenario = scenarios[s];
+        std::string scenarioName = scenario.name.empty() ? modelName : scenario.name;
+        std::vector<RunningMoments> targetMoments(targets.size());
+        ScenarioResult& result = results[s];
+        result.estimates.assign(targets.size(), 0.0);
+        result.halfWidths.assign(targets.size(), std::numeric_limits<double>::infinity());
+
+        std::cout << "\nScenario: " << scenarioName << std::endl;
+        printf("%10s", "Replicates");
+        for (const PrecisionTarget& target : targets) printf(" | %36s", target.label.c_str());
+        printf("\n");
+
+        std::size_t nextReport = batchSize;
+        while (result.replicates < maxReplicates && !result.converged)
+        {
+            std::size_t batch = std::min(batchSize, maxReplicates - result.replicates);
+            std::size_t samples = batch / replicatesPerSample;
+            std::vector<double> batchSamples(samples * targets.size(), 0.0);
+
+            pool.parallelFor(samples, [&](std::size_t sample)
+            {
+                std::vector<double> trajectory;
+                std::vector<double> presetNormals;
+                for (std::size_t twin = 0; twin < replicatesPerSample; ++twin)
+                {
+                    std::size_t replicate = result.replicates + sample * replicatesPerSample + twin;
+                    Fishery fishery = scenario.fishery;
+                    FishingIndustry industry = scenario.industry;
+                    std::size_t stream = seedReplicateNoise(fishery, varianceReduction, nullptr, seed, replicate, presetNormals);
+                    simulateTrajectory(fishery, industry, modelChoice, simulationYears, stepsPerYear, trajectory, scenario.forcing, stream);
+
+                    for (std::size_t t = 0; t < targets.size(); ++t)
+                    {
+                        batchSamples[sample * targets.size() + t] += getTargetSample(targets[t], trajectory, variables, simulationYears) / replicatesPerSample;
+                    }
+                }
+            });
+
+            //merged in replicate order, so the result does not depend on the thread count
+            for (std::size_t sample = 0; sample < samples; ++sample)
+            {
+                for (std::size_t t = 0; t < targets.size(); ++t) targetMoments[t].add(batchSamples[sample * targets.size() + t]);
+            }
+            result.replicates += batch;
+
+            bool allMet = result.replicates >= minReplicates;
+            for (std::size_t t = 0; t < targets.size(); ++t)
+            {
+                const RunningMoments& moments = targetMoments[t];
+                double n = static_cast<double>(moments.getCount());
+                double estimate = moments.getMean();
+                double halfWidth = z * moments.getStdDev() / std::sqrt(n);
+                if (targets[t].probability)
+                {
+                    //Wilson score interval of the event rate over the replicates
+                    double trials = n * replicatesPerSample;
+                    double wilson = z * std::sqrt(estimate * (1.0 - estimate) / trials + z * z / (4.0 * trials * trials)) / (1.0 + z * z / trials);
+                    halfWidth = antithetic ? std::max(halfWidth, wilson) : wilson;
+                }
+                double required = targets[t].relative ? targets[t].halfWidth * std::fabs(estimate) : targets[t].halfWidth;
+
+                result.estimates[t] = estimate;
+                result.halfWidths[t] = halfWidth;
+                allMet = allMet && n > 1.0 && halfWidth <= required;
+            }
+            result.converged = allMet;
+
+            for (std::size_t t = 0; t < targets.size(); ++t)
+            {
+                double required = targets[t].relative ? targets[t].halfWidth * std::fabs(result.estimates[t]) : targets[t].halfWidth;
+                logger.writeRow(scenarioName + "," + targets[t].label, { static_cast<double>(result.replicates), result.estimates[t],
+                    result.halfWidths[t], required, result.converged ? 1.0 : 0.0 });
+            }
+
+            //report at every doubling of the replicates, and at the end
+            bool finished = result.converged || result.replicates >= maxReplicates;
+            if (result.replicates >= nextReport || finished)
+            {
+                printf("%10zu", result.replicates);
+                for (std::size_t t = 0; t < targets.size(); ++t) printf(" | %17.6g +- %15.6g", result.estimates[t], result.halfWidths[t]);
+                printf("\n");
+                while (nextReport <= result.replicates) nextReport *= 2;
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    printf("\n%-20s | %10s | %s\n", "Scenario", "Replicates", "Converged");
+    printf("-----------------------------------------------\n");
+    for (std::size_t s = 0; s < scenarios.size(); ++s)
+    {
+        printf("%-20s | %10zu | %s\n", (scenarios[s].name.empty() ? modelName : scenarios[s].name).c_str(), results[s].replicates,
+            results[s].converged ? "yes" : "no (replicate budget reached)");
+    }
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief A particle of the rare-event splitting: a copy of the model state and its current model step
+ * (a year, or a sub-year step of the Delay Model).
+ */
+struct CollapseParticle
+{
+    Fishery fishery;
+    FishingIndustry industry;
+    int step = 0;
+};
+
+/**
+ * @brief The stock output watched for a collapse (the first output of the simple and delay models,
+ * TotalBiomass or SpawningStockBiomass of the Age-Structured Model).
+ */
+double getCollapseScore(CollapseParticle& particle, int modelChoice, std::size_t variable)
+{
+    if (modelChoice == 3) return (variable == 0) ? particle.fishery.getTotalBiomass() : particle.fishery.getSpawningStockBiomass();
+    return particle.fishery.getFishStock();
+}
+
+/**
+ * @brief Advances a particle by one model step, with the same forcing times as simulateTrajectory.
+ */
+void advanceCollapseParticle(CollapseParticle& particle, int modelChoice, int stepsPerYear, const EnvironmentalForcing& forcing)
+{
+    if (modelChoice == 1)
+    {
+        forcing.apply(particle.fishery, particle.step);
+        double growth = SimpleModelGrowthAmount(particle.fishery, particle.industry);
+        particle.fishery.setFishStock(std::max(0.0, particle.fishery.getFishStock() + growth));
+    }
+    else if (modelChoice == 2)
+    {
+        double timeStep = 1.0 / stepsPerYear;
+        forcing.apply(particle.fishery, particle.step * timeStep);
+        DelayEquationModelStep(particle.fishery, particle.industry, timeStep);
+    }
+    else
+    {
+        forcing.apply(particle.fishery, particle.step);
+        AgeStructuredModelStep(particle.fishery, particle.industry);
+    }
+    ++particle.step;
+}
+
+/**
+ * @brief Estimates the probability that a stock output collapses below a threshold within a horizon, configured
+ * in the "collapseProbability" section of parameters.json. Such probabilities are often far below 1e-4, out of reach
+ * of plain Monte Carlo, so they are estimated by adaptive multilevel splitting (see MultilevelSplitting.h): the
+ * model state is cloned at intermediate stock levels, and the paths that approach the collapse are multiplied.
+ *
+ * Splitting pays off when the watched output carries memory (e.g. a depleted logistic stock recovers slowly); an
+ * output that is renewed every year by independent noise gives little gain over plain Monte Carlo.
+ *
+ * Every scenario is estimated by several independent repetitions, whose spread gives the standard error. An
+ * optional plain Monte Carlo run gives a check for events that are not too rare. Forcing inputs that cycle
+ * through scenarios use their first scenario, since a cloned path must keep its environment.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runCollapseProbability(const json& params)
+{
+    std::string modelName;
+    std::string output;
+    double threshold = 0.0;
+    int horizonYears = 0;
+    SplittingSettings settings;
+    std::size_t repetitions = 0;
+    std::size_t plainMonteCarloRuns = 0;
+    std::uint32_t seed = 0;
+    json scenarioParams;
+
+    try
+    {
+        auto collapseParams = params.at("collapseProbability");
+        modelName = collapseParams.at("model").get<std::string>();
+        output = collapseParams.at("output").get<std::string>();
+        threshold = collapseParams.at("threshold").get<double>();
+        horizonYears = collapseParams.at("horizonYears").get<int>();
+        settings.particles = collapseParams.at("particles").get<std::size_t>();
+        settings.levelProportion = collapseParams.at("levelProportion").get<double>();
+        settings.maxLevels = collapseParams.at("maxLevels").get<std::size_t>();
+        repetitions = collapseParams.at("repetitions").get<std::size_t>();
+        plainMonteCarloRuns = collapseParams.at("plainMonteCarloRuns").get<std::size_t>();
+        seed = collapseParams.at("seed").get<std::uint32_t>();
+        scenarioParams = collapseParams.at("scenarios");
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing collapse probability parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice == 0)
+    {
+        std::cout << "Error: Unknown model '" << modelName << "'. Use simpleModel, delayModel or ageStructuredModel." << std::endl;
+        return 1;
+    }
+    //only the stock outputs are part of the model state
+    std::vector<std::string> stockOutputs = getTrajectoryVariableNames(modelChoice);
+    stockOutputs.resize(modelChoice == 3 ? 2 : 1);
+    auto variable = std::find(stockOutputs.begin(), stockOutputs.end(), output);
+    if (variable == stockOutputs.end())
+    {
+        std::cout << "Error: '" << output << "' is not a stock output of '" << modelName << "'." << std::endl;
+        return 1;
+    }
+    std::size_t variableIndex = static_cast<std::size_t>(variable - stockOutputs.begin());
+    if (horizonYears <= 0 || settings.particles < 2 || repetitions < 2)
+    {
+        std::cout << "Error: horizonYears must be positive, with at least 2 particles and 2 repetitions." << std::endl;
+        return 1;
+    }
+    if (!(settings.levelProportion > 0.0 && settings.levelProportion < 1.0) || settings.levelProportion * settings.particles < 1.0)
+    {
+        std::cout << "Error: 'levelProportion' must lie in (0, 1) and keep at least one of the particles at each level." << std::endl;
+        return 1;
+    }
+
+    std::vector<EnsembleScenario> scenarios;
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadEnsembleScenarios(params, modelName, modelChoice, scenarioParams, scenarios, simulationYears, stepsPerYear)) return 1;
+    int horizonSteps = horizonYears * (modelChoice == 2 ? stepsPerYear : 1);
+
+    if (seed == 0)
+    {
+        std::random_device rd;
+        seed = rd();
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "collapse_probability_" + modelName + "_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+    logger.setScientific(8);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Collapse probability of " + modelName + " by multilevel splitting (seed " + std::to_string(seed) + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("collapseProbability").dump(4) << "\n" << params.at(modelName).dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logEnvironmentalForcing(logger, params, scenarios[0].forcing);
+    logger.writeHeader("Scenario,Method,Repetition,Probability,Levels,ModelSteps,Converged");
+
+    std::cout << "--- Rare-Event Collapse Probability (Multilevel Splitting) ---" << std::endl;
+    std::cout << "Model: " << modelName << ", P(" << output << " <= " << threshold << " within " << horizonYears << " years), "
+        << settings.particles << " particles per level, " << repetitions << " repetitions on " << pool.size() << " threads, seed " << seed << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    struct ScenarioSummary
+    {
+        double probability = 0.0;
+        double standardError = 0.0;
+        double steps = 0.0;
+        std::size_t converged = 0;
+        double plainProbability = 0.0;
+        double plainStandardError = 0.0;
+        double plainSteps = 0.0;
+    };
+    std::vector<ScenarioSummary> summaries(scenarios.size());
+
+    for (std::size_t s = 0; s < scenarios.size(); ++s)
+    {
+        const EnsembleScenario& scenario = scenarios[s];
+        std::string scenarioName = scenario.name.empty() ? modelName : scenario.name;
+        CollapseParticle initial{ scenario.fishery, scenario.industry, 0 };
+
+        std::cout << "\nScenario: " << scenarioName << std::endl;
+        printf("%10s | %14s | %6s | %12s | %s\n", "Repetition", "Probability", "Levels", "Model Steps", "Converged");
+        printf("---------------------------------------------------------------\n");
+
+        RunningMoments estimates;
+        std::size_t totalSteps = 0;
+        std::size_t convergedRepetitions = 0;
+        for (std::size_t repetition = 0; repetition < repetitions; ++repetition)
+        {
+            //every repetition has its own noise streams
+            std::uint32_t repetitionSeed = seed + static_cast<std::uint32_t>(repetition);
+            MultilevelSplitting<CollapseParticle>::Simulator simulate =
+                [&](CollapseParticle& particle, std::uint32_t stream, double stopLevel, std::size_t& outSteps)
+            {
+                particle.fishery.setSeed(repetitionSeed, stream);
+                double minimum = getCollapseScore(particle, modelChoice, variableIndex);
+                while (particle.step < horizonSteps && minimum > stopLevel)
+                {
+                    advanceCollapseParticle(particle, modelChoice, stepsPerYear, scenario.forcing);
+                    minimum = std::min(minimum, getCollapseScore(particle, modelChoice, variableIndex));
+                    ++outSteps;
+                }
+                return minimum;
+            };
+
+            settings.seed = repetitionSeed;
+            SplittingResult result = MultilevelSplitting<CollapseParticle>(settings).estimate(initial, threshold, simulate, pool);
+            estimates.add(result.probability);
+            totalSteps += result.simulatedSteps;
+            if (result.converged) ++convergedRepetitions;
+
+            printf("%10zu | %14.6e | %6zu | %12zu | %s\n", repetition + 1, result.probability, result.levels.size(), result.simulatedSteps,
+                result.converged ? "yes" : "no");
+            logger.writeRow(scenarioName + ",splitting," + std::to_string(repetition + 1), { result.probability,
+                static_cast<double>(result.levels.size()), static_cast<double>(result.simulatedSteps), result.converged ? 1.0 : 0.0 });
+        }
+
+        ScenarioSummary& summary = summaries[s];
+        summary.probability = estimates.getMean();
+        summary.standardError = estimates.getStdDev() / std::sqrt(static_cast<double>(repetitions));
+        summary.steps = static_cast<double>(totalSteps);
+        summary.converged = convergedRepetitions;
+
+        if (plainMonteCarloRuns > 0)
+        {
+            //independent of the splitting streams (one seed past the repetitions)
+            std::uint32_t plainSeed = seed + static_cast<std::uint32_t>(repetitions);
+            std::vector<char> collapsed(plainMonteCarloRuns, 0);
+            std::vector<std::size_t> steps(plainMonteCarloRuns, 0);
+            pool.parallelFor(plainMonteCarloRuns, [&](std::size_t run)
+            {
+                CollapseParticle particle = initial;
+                particle.fishery.setSeed(plainSeed, static_cast<std::uint32_t>(run));
+                double score = getCollapseScore(particle, modelChoice, variableIndex);
+                while (particle.step < horizonSteps && score > threshold)
+                {
+                    advanceCollapseParticle(particle, modelChoice, stepsPerYear, scenario.forcing);
+                    score = getCollapseScore(particle, modelChoice, variableIndex);
+                    ++steps[run];
+                }
+                collapsed[run] = (score <= threshold) ? 1 : 0;
+            });
+
+            std::size_t hits = std::count(collapsed.begin(), collapsed.end(), 1);
+            std::size_t plainSteps = 0;
+            for (std::size_t run = 0; run < plainMonteCarloRuns; ++run) plainSteps += steps[run];
+            summary.plainProbability = static_cast<double>(hits) / plainMonteCarloRuns;
+            summary.plainStandardError = std::sqrt(summary.plainProbability * (1.0 - summary.plainProbability) / plainMonteCarloRuns);
+            summary.plainSteps = static_cast<double>(plainSteps);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+
+    //plain Monte Carlo needs P(1 - P) / SE^2 runs (of up to horizonSteps steps) for the same standard error
+    printf("\n%-20s | %14s | %14s | %14s | %18s\n", "Scenario", "Probability", "Std Error", "Model Steps", "Plain MC Runs Eq.");
+    printf("-------------------------------------------------------------------------------------------\n");
+    for (std::size_t s = 0; s < scenarios.size(); ++s)
+    {
+        const ScenarioSummary& summary = summaries[s];
+        double equivalentRuns = (summary.standardError > 0.0) ?
+            summary.probability * (1.0 - summary.probability) / (summary.standardError * summary.standardError) : 0.0;
+        printf("%-20s | %14.6e | %14.6e | %14.0f | %18.0f\n", (scenarios[s].name.empty() ? modelName : scenarios[s].name).c_str(),
+            summary.probability, summary.standardError, summary.steps, equivalentRuns);
+        if (plainMonteCarloRuns > 0)
+        {
+            printf("%-20s | %14.6e | %14.6e | %14s | %18zu\n", "  plain Monte Carlo", summary.plainProbability, summary.plainStandardError, "", plainMonteCarloRuns);
+        }
+    }
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+
+    //the estimate of each scenario over its repetitions (and plain Monte Carlo runs, which always run to the end) in a file of its own
+    std::string summaryFilename = "collapse_probability_summary_" + modelName + "_" + timestamp + ".csv";
+    logger.open(summaryFilename);
+    logger.setScientific(8);
+    logger.writeComment("Collapse probability of " + modelName + " by scenario (seed " + std::to_string(seed) + ")");
+    logger.writeComment("");
+    logger.writeHeader("Scenario,Method,Runs,Probability,StdError,ModelSteps,Converged");
+    for (std::size_t s = 0; s < scenarios.size(); ++s)
+    {
+        const ScenarioSummary& summary = summaries[s];
+        std::string scenarioName = scenarios[s].name.empty() ? modelName : scenarios[s].name;
+        logger.writeRow(scenarioName + ",splitting", { static_cast<double>(repetitions), summary.probability, summary.standardError,
+            summary.steps, static_cast<double>(summary.converged) });
+        if (plainMonteCarloRuns > 0)
+        {
+            logger.writeRow(scenarioName + ",plainMonteCarlo", { static_cast<double>(plainMonteCarloRuns), summary.plainProbability,
+                summary.plainStandardError, summary.plainSteps, static_cast<double>(plainMonteCarloRuns) });
+        }
+    }
+    logger.close();
+
+    std::cout << getCurrentWorkingDirectory() << "/" << summaryFilename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief A case of the regression check: one model, run in one precision by one kernel.
+ */
+struct RegressionCase
+{
+    std::string name;
+    std::string modelName;
+    bool singlePrecision = false;
+
+    //runs the dynamic age kernel instead of the fixed-size one, against the reference of referenceName
+    bool dynamicAgeKernel = false;
+    std::string referenceName;
+};
+
+/**
+ * @brief Simulates the replicates of a regression case, each seeded with (seed, replicate) and without forcing.
+ * @param outValues (Output) Replicate-major trajectories, as stored in a GoldenCase.
+ * @return False if the model parameters could not be loaded.
+ */
+bool runRegressionCase(const json& params, const RegressionCase& regressionCase, std::uint32_t seed, std::size_t replicates,
+    std::size_t& outVariables, std::vector<double>& outValues)
+{
+    Fishery baseFishery;
+    FishingIndustry baseIndustry;
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    int modelChoice = getModelChoiceFromName(regressionCase.modelName);
+    if (!loadParametersFromJSON(params, baseFishery, baseIndustry, modelChoice, simulationYears, stepsPerYear)) return false;
+
+    outVariables = getTrajectoryVariableNames(modelChoice).size();
+    outValues.clear();
+    EnvironmentalForcing noForcing;
+    std::vector<double> trajectory;
+    for (std::size_t replicate = 0; replicate < replicates; ++replicate)
+    {
+        Fishery fishery = baseFishery;
+        FishingIndustry industry = baseIndustry;
+        fishery.setSeed(seed, static_cast<std::uint32_t>(replicate));
+        if (regressionCase.dynamicAgeKernel)
+        {
+            trajectory.assign((simulationYears + 1) * outVariables, 0.0);
+            simulateAgeTrajectory<double>(fishery, industry, simulationYears, trajectory, noForcing, replicate);
+        }
+        else if (regressionCase.singlePrecision)
+        {
+            simulateTrajectory<float>(fishery, industry, modelChoice, simulationYears, stepsPerYear, trajectory, noForcing, replicate);
+        }
+        else
+        {
+            simulateTrajectory<double>(fishery, industry, modelChoice, simulationYears, stepsPerYear, trajectory, noForcing, replicate);
+        }
+        outValues.insert(outValues.end(), trajectory.begin(), trajectory.end());
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the regression check configured in the "regressionCheck" section of parameters.json.
+ * Every model is run with a fixed seed in float64 and float32 (and the age model also with its dynamic kernel),
+ * and the trajectories are compared with the reference outputs stored in referenceFile, value by value in units
+ * in the last place of the case's precision. With maxUlps 0 the check is bitwise. The noise is drawn from the raw
+ * mt19937 output, so it does not depend on the standard library; math libraries and floating-point contraction can
+ * still differ in the last bits between compilers, which a tolerance of a few ULPs absorbs. Each case is also timed,
+ * so an optimization is measured and checked for numerical drift in the same run.
+ *
+ * With "record" set, the current outputs are written as the new reference instead. The reference also stores the
+ * model sections it was recorded with, and each case is run from its stored section, so editing the model sections
+ * of parameters.json does not affect the check.
+ * @return 0 if every case matches (or the reference was recorded), 1 on a mismatch or a configuration error.
+ */
+int runRegressionCheck(const json& params)
+{
+    std::string referenceFile;
+    std::uint32_t seed = 0;
+    std::size_t replicates = 0;
+    std::uint64_t maxUlps = 0;
+    bool record = false;
+    std::size_t benchmarkRepetitions = 0;
+
+    try
+    {
+        auto checkParams = params.at("regressionCheck");
+        referenceFile = checkParams.at("referenceFile").get<std::string>();
+        seed = checkParams.at("seed").get<std::uint32_t>();
+        replicates = checkParams.at("replicates").get<std::size_t>();
+        maxUlps = checkParams.at("maxUlps").get<std::uint64_t>();
+        record = checkParams.at("record").get<bool>();
+        benchmarkRepetitions = checkParams.at("benchmarkRepetitions").get<std::size_t>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing regression check parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    if (replicates == 0)
+    {
+        std::cout << "Error: The regression check needs at least one replicate." << std::endl;
+        return 1;
+    }
+
+    std::vector<RegressionCase> cases = {
+        { "simpleModel/float64", "simpleModel", false, false, "" },
+        { "simpleModel/float32", "simpleModel", true, false, "" },
+        { "delayModel/float64", "delayModel", false, false, "" },
+        { "delayModel/float32", "delayModel", true, false, "" },
+        { "ageStructuredModel/float64", "ageStructuredModel", false, false, "" },
+        { "ageStructuredModel/float32", "ageStructuredModel", true, false, "" },
+        { "ageStructuredModel/float64/dynamic", "ageStructuredModel", false, true, "ageStructuredModel/float64" }
+    };
+
+    std::vector<GoldenCase> references;
+    if (!record)
+    {
+        std::uint32_t referenceSeed = 0;
+        if (!loadGoldenOutputs(referenceFile, referenceSeed, references)) return 1;
+        //the reference seed wins, so the check does not depend on the current setting
+        seed = referenceSeed;
+    }
+
+    std::cout << "--- Regression Check (Golden Outputs) ---" << std::endl;
+    std::cout << (record ? "Recording" : "Checking") << " " << referenceFile << ", seed " << seed << ", " << replicates << " replicates per case";
+    if (!record) std::cout << ", tolerance " << maxUlps << " ULPs";
+    std::cout << std::endl;
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "regression_check_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Regression check against " + referenceFile + " (seed " + std::to_string(seed) + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("regressionCheck").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logger.writeHeader("Case,Values,Mismatches,MaxUlps,Passed,MicrosecondsPerTrajectory");
+
+    printf("\n%-36s | %8s | %10s | %12s | %8s | %12s\n", "Case", "Values", "Mismatches", "Max ULPs", "Result", "us/Trajectory");
+    printf("--------------------------------------------------------------------------------------------------------\n");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<GoldenCase> recorded;
+    bool allPassed = true;
+    for (const RegressionCase& regressionCase : cases)
+    {
+        std::string referenceName = regressionCase.referenceName.empty() ? regressionCase.name : regressionCase.referenceName;
+        auto reference = std::find_if(references.begin(), references.end(), [&](const GoldenCase& golden) { return golden.name == referenceName; });
+
+        //a checked case runs from the model section stored with its reference, over the current section, so keys
+        //added to the model since recording keep their current values
+        json caseParams = params;
+        if (!record && reference != references.end())
+        {
+            try
+            {
+                caseParams[regressionCase.modelName].update(json::parse(reference->parameters));
+            }
+            catch (json::exception& e)
+            {
+                std::cout << "Error: Invalid parameters of case " << referenceName << " in " << referenceFile << ":\n" << e.what() << std::endl;
+                return 1;
+            }
+        }
+
+        GoldenCase current;
+        current.name = regressionCase.name;
+        current.parameters = caseParams.at(regressionCase.modelName).dump();
+        current.replicates = replicates;
+        if (!runRegressionCase(caseParams, regressionCase, seed, replicates, current.variables, current.values))
+        {
+            std::cout << "Error loading " << regressionCase.modelName << " parameters. Exiting." << std::endl;
+            return 1;
+        }
+
+        //the benchmark repeats the same seeded runs
+        auto benchmarkStart = std::chrono::high_resolution_clock::now();
+        std::size_t variables = 0;
+        std::vector<double> values;
+        for (std::size_t repetition = 0; repetition < benchmarkRepetitions; ++repetition)
+        {
+            runRegressionCase(caseParams, regressionCase, seed, replicates, variables, values);
+        }
+        std::chrono::duration<double, std::micro> benchmarkDuration = std::chrono::high_resolution_clock::now() - benchmarkStart;
+        double microsecondsPerTrajectory = (benchmarkRepetitions > 0) ? benchmarkDuration.count() / (benchmarkRepetitions * replicates) : 0.0;
+
+        std::size_t mismatches = 0;
+        std::uint64_t largestUlps = 0;
+        std::string result = "recorded";
+        if (record)
+        {
+            if (regressionCase.referenceName.empty()) recorded.push_back(current);
+        }
+        else
+        {
+            if (reference == references.end())
+            {
+                result = "missing";
+            }
+            else if (reference->replicates != replicates || reference->values.size() != current.values.size())
+            {
+                result = "shape";
+            }
+            else
+            {
+                for (std::size_t i = 0; i < current.values.size(); ++i)
+                {
+                    std::uint64_t ulps = regressionCase.singlePrecision ?
+                        getUlpDistance(static_cast<float>(current.values[i]), static_cast<float>(reference->values[i])) :
+                        getUlpDistance(current.values[i], reference->values[i]);
+                    largestUlps = std::max(largestUlps, ulps);
+                    if (ulps > maxUlps) ++mismatches;
+                }
+                result = (mismatches == 0) ? "pass" : "FAIL";
+            }
+            allPassed = allPassed && result == "pass";
+        }
+
+        printf("%-36s | %8zu | %10zu | %12llu | %8s | %12.3f\n", regressionCase.name.c_str(), current.values.size(), mismatches,
+            static_cast<unsigned long long>(largestUlps), result.c_str(), microsecondsPerTrajectory);
+        logger.writeRow(regressionCase.name, { static_cast<double>(current.values.size()), static_cast<double>(mismatches),
+            static_cast<double>(largestUlps), (result == "pass" || result == "recorded") ? 1.0 : 0.0, microsecondsPerTrajectory });
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    if (record)
+    {
+        if (!saveGoldenOutputs(referenceFile, seed, recorded)) return 1;
+        std::cout << "\nReference outputs recorded to:\n" << getCurrentWorkingDirectory() << "/" << referenceFile << std::endl;
+    }
+    else if (!allPassed)
+    {
+        //"missing" or "shape" means a different case layout
+        std::cout << "\nThe outputs differ from the reference. If the change is intended, record a new reference with \"record\": true." << std::endl;
+    }
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return (record || allPassed) ? 0 : 1;
+}
+
+/**
+ * @brief The state of a batched environment (see FisheryEnvironment.h).
+ */
+struct FisheryEnvironment
+{
+    int modelChoice = 0;
+    std::size_t batchSize = 0;
+    int episodeYears = 0;
+    int stepsPerYear = 1;
+
+    //the model state of an instance: the stock (simple), n, E and S (delay), or the numbers at age
+    std::size_t stateSize = 0;
+    std::size_t observationSize = 0;
+
+    //the loaded model, and the state every episode starts from
+    Fishery initialFishery;
+    FishingIndustry initialIndustry;
+    std::vector<double> initialState;
+
+    //one fishery per instance for its noise stream (and recruitment deviation), and the instance-major states
+    std::vector<Fishery> fisheries;
+    std::vector<double> states;
+    std::vector<int> years;
+
+    //the age model tables, and per instance the survival and catch factors of the fishing mortality they were computed for
+    int maxAge = 0;
+    std::vector<double> weightAtAge;
+    std::vector<double> maturityAtAge;
+    std::vector<double> selectivityAtAge;
+    std::vector<double> survival;
+    std::vector<double> catchFactor;
+    std::vector<double> tabulatedAction;
+};
+
+/**
+ * @brief The last error of the C interface, per thread.
+ */
+std::string& getFisheryEnvironmentError()
+{
+    static thread_local std::string error;
+    return error;
+}
+
+/**
+ * @brief Writes the observations of an environment instance.
+ */
+void writeEnvironmentObservation(const FisheryEnvironment& env, std::size_t instance, double* observation)
+{
+    const double* state = &env.states[instance * env.stateSize];
+    if (env.modelChoice == 3)
+    {
+        double totalBiomass = 0.0;
+        double ssb = 0.0;
+        for (int age = 0; age <= env.maxAge; ++age)
+        {
+            totalBiomass += state[age] * env.weightAtAge[age];
+            ssb += state[age] * env.weightAtAge[age] * env.maturityAtAge[age];
+        }
+        observation[0] = totalBiomass;
+        observation[1] = ssb;
+        std::copy(state, state + env.stateSize, observation + 2);
+    }
+    else
+    {
+        std::copy(state, state + env.stateSize, observation);
+    }
+}
+
+/**
+ * @brief Starts a new episode in an environment instance. The noise stream continues, but the recruitment
+ * deviation starts afresh, so episodes are not correlated with each other.
+ */
+void resetEnvironmentInstance(FisheryEnvironment& env, std::size_t instance)
+{
+    std::copy(env.initialState.begin(), env.initialState.end(), env.states.begin() + instance * env.stateSize);
+    env.years[instance] = 0;
+    env.fisheries[instance].resetRecruitmentDeviation();
+}
+
+/**
+ * @brief Checks the pointers passed to the C interface, setting the last error if one is NULL.
+ * @return True if every pointer is set.
+ */
+bool checkEnvironmentPointers(const char* function, std::initializer_list<const void*> pointers)
+{
+    for (const void* pointer : pointers)
+    {
+        if (pointer == nullptr)
+        {
+            getFisheryEnvironmentError() = std::string(function) + ": the environment and the buffers must not be NULL.";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Steps an environment instance by one year with the existing model steps, in place in its state.
+ * @param outExhausted (Output) True if the stock is exhausted.
+ * @return The catch of the year.
+ */
+double stepEnvironmentInstance(FisheryEnvironment& env, std::size_t instance, double action, bool& outExhausted)
+{
+    Fishery& fishery = env.fisheries[instance];
+    double* state = &env.states[instance * env.stateSize];
+    action = std::max(0.0, action);
+    double totalCatch = 0.0;
+
+    if (env.modelChoice == 1)
+    {
+        double noise = fishery.getNoisyMultiplier(fishery.getReproductionStdDev());
+        double stock = state[0] + SimpleModelGrowthAmount(state[0], fishery.getSimpleReproductionRate(), fishery.getSimpleCarryingCapacity(), action, noise);
+
+        //the harvest is limited by the fish that are there
+        totalCatch = action + std::min(0.0, stock);
+        state[0] = std::max(0.0, stock);
+        outExhausted = state[0] <= 0.0;
+    }
+    else if (env.modelChoice == 2)
+    {
+        double timeStep = 1.0 / env.stepsPerYear;
+        for (int i = 0; i < env.stepsPerYear; ++i)
+        {
+            //the effort is set by the action instead of following dE/dt
+            state[1] = action;
+            double noise = fishery.getNoisyMultiplier(fishery.getCatchabilityStdDev());
+            totalCatch += DelayEquationModelStep(state[0], state[1], state[2], fishery, env.initialIndustry, noise, timeStep) * timeStep;
+        }
+        state[1] = action;
+        outExhausted = state[0] <= 0.0;
+    }
+    else
+    {
+        double ssb = 0.0;
+        for (int age = 0; age <= env.maxAge; ++age) ssb += state[age] * env.weightAtAge[age] * env.maturityAtAge[age];
+        double recruitment = fishery.getRecruitment(ssb);
+
+        //like FixedAgeModel::setMortality, the tables are only recomputed when the action changes
+        double* survival = &env.survival[instance * env.stateSize];
+        double* catchFactor = &env.catchFactor[instance * env.stateSize];
+        if (action != env.tabulatedAction[instance])
+        {
+            double naturalMortality = fishery.getNaturalMortality();
+            for (int age = 0; age <= env.maxAge; ++age)
+            {
+                double F = action * env.selectivityAtAge[age];
+                double Z = naturalMortality + F;
+                survival[age] = std::exp(-Z);
+                catchFactor[age] = (F / Z) * (1.0 - std::exp(-Z));
+            }
+            env.tabulatedAction[instance] = action;
+        }
+        totalCatch = stepTabulatedAgeModel(state, env.maxAge, survival, catchFactor, env.weightAtAge.data(), recruitment);
+        outExhausted = std::all_of(state, state + env.stateSize, [](double numbers) { return numbers <= 0.0; });
+    }
+    return totalCatch;
+}
+
+extern "C" FisheryEnvironment* fishery_env_create(const char* parametersJson, const char* modelName, int batchSize, int episodeYears, unsigned int seed)
+{
+    getFisheryEnvironmentError().clear();
+    if (parametersJson == nullptr || modelName == nullptr)
+    {
+        getFisheryEnvironmentError() = "The parameters and the model name must not be NULL.";
+        return nullptr;
+    }
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice == 0)
+    {
+        getFisheryEnvironmentError() = std::string("Unknown model '") + modelName + "'. Use simpleModel, delayModel or ageStructuredModel.";
+        return nullptr;
+    }
+    if (batchSize < 1 || episodeYears < 0)
+    {
+        getFisheryEnvironmentError() = "The batch size must be at least 1 and the episode length must not be negative.";
+        return nullptr;
+    }
+
+    try
+    {
+        std::unique_ptr<FisheryEnvironment> env(new FisheryEnvironment());
+        env->modelChoice = modelChoice;
+        env->batchSize = static_cast<std::size_t>(batchSize);
+        int simulationYears = 0;
+        if (!loadParametersFromJSON(json::parse(parametersJson), env->initialFishery, env->initialIndustry, modelChoice, simulationYears, env->stepsPerYear))
+        {
+            getFisheryEnvironmentError() = std::string("Invalid ") + modelName + " parameters.";
+            return nullptr;
+        }
+        env->episodeYears = (episodeYears > 0) ? episodeYears : simulationYears;
+        if (env->episodeYears < 1 || (modelChoice == 2 && env->stepsPerYear < 1))
+        {
+            getFisheryEnvironmentError() = "The episode length and the steps per year must be at least 1.";
+            return nullptr;
+        }
+
+        if (modelChoice == 1)
+        {
+            env->initialState = { env->initialFishery.getFishStock() };
+            env->observationSize = 1;
+        }
+        else if (modelChoice == 2)
+        {
+            env->initialState = { env->initialFishery.getFishStock(), env->initialIndustry.getHarvestingEffort(), env->initialIndustry.getFishMarketStock() };
+            env->observationSize = 3;
+        }
+        else
+        {
+            AgeModelParameters<double> ageParams = getAgeModelParameters(env->initialFishery, env->initialIndustry);
+            env->maxAge = ageParams.maxAge;
+            for (int age = 0; age <= env->maxAge; ++age)
+            {
+                env->weightAtAge.push_back(getWeightAtAge(age, ageParams));
+                env->maturityAtAge.push_back(getMaturityAtAge(age, ageParams));
+                env->selectivityAtAge.push_back(getSelectivityAtAge(age, ageParams));
+            }
+            env->initialState = env->initialFishery.getNumbersAtAge();
+            env->observationSize = env->initialState.size() + 2;
+        }
+        env->stateSize = env->initialState.size();
+
+        //all storage is allocated here, stepping only works in place
+        env->fisheries.assign(env->batchSize, env->initialFishery);
+        for (std::size_t instance = 0; instance < env->batchSize; ++instance)
+        {
+            env->fisheries[instance].setSeed(seed, static_cast<std::uint32_t>(instance));
+        }
+        env->states.resize(env->batchSize * env->stateSize);
+        env->years.resize(env->batchSize);
+        if (modelChoice == 3)
+        {
+            env->survival.resize(env->batchSize * env->stateSize);
+            env->catchFactor.resize(env->batchSize * env->stateSize);
+            env->tabulatedAction.assign(env->batchSize, std::numeric_limits<double>::quiet_NaN());
+        }
+        for (std::size_t instance = 0; instance < env->batchSize; ++instance) resetEnvironmentInstance(*env, instance);
+        return env.release();
+    }
+    catch (json::exception& e)
+    {
+        getFisheryEnvironmentError() = std::string("Invalid parameters JSON: ") + e.what();
+    }
+    catch (std::exception& e)
+    {
+        getFisheryEnvironmentError() = std::string("Could not create the environment: ") + e.what();
+    }
+    return nullptr;
+}
+
+extern "C" void fishery_env_destroy(FisheryEnvironment* env)
+{
+    delete env;
+}
+
+extern "C" int fishery_env_batch_size(const FisheryEnvironment* env)
+{
+    if (!checkEnvironmentPointers("fishery_env_batch_size", { env })) return 0;
+    return static_cast<int>(env->batchSize);
+}
+
+extern "C" int fishery_env_observation_size(const FisheryEnvironment* env)
+{
+    if (!checkEnvironmentPointers("fishery_env_observation_size", { env })) return 0;
+    return static_cast<int>(env->observationSize);
+}
+
+extern "C" void fishery_env_reset(FisheryEnvironment* env, double* observations)
+{
+    if (!checkEnvironmentPointers("fishery_env_reset", { env, observations })) return;
+    for (std::size_t instance = 0; instance < env->batchSize; ++instance)
+    {
+        resetEnvironmentInstance(*env, instance);
+        writeEnvironmentObservation(*env, instance, observations + instance * env->observationSize);
+    }
+}
+
+extern "C" void fishery_env_step(FisheryEnvironment* env, const double* actions, double* observations, double* rewards, unsigned char* dones)
+{
+    if (!checkEnvironmentPointers("fishery_env_step", { env, actions, observations, rewards, dones })) return;
+    TraceScope trace("EnvironmentStep", "simulation", "batch", static_cast<long long>(env->batchSize));
+
+    //the body captures a single reference, small enough for the std::function of parallelFor not to allocate
+    struct StepBuffers
+    {
+        FisheryEnvironment* env;
+        const double* actions;
+        double* observations;
+        double* rewards;
+        unsigned char* dones;
+    } buffers = { env, actions, observations, rewards, dones };
+    auto stepInstance = [&buffers](std::size_t instance)
+    {
+        FisheryEnvironment& env = *buffers.env;
+        bool exhausted = false;
+        buffers.rewards[instance] = stepEnvironmentInstance(env, instance, buffers.actions[instance], exhausted);
+        bool done = exhausted || ++env.years[instance] >= env.episodeYears;
+        if (done) resetEnvironmentInstance(env, instance);
+        buffers.dones[instance] = done ? 1 : 0;
+        writeEnvironmentObservation(env, instance, buffers.observations + instance * env.observationSize);
+    };
+
+    //small batches are not worth waking the workers for
+    const std::size_t parallelBatchSize = 256;
+    if (env->batchSize >= parallelBatchSize && ThreadPool::shared().size() > 1)
+    {
+        ThreadPool::shared().parallelFor(env->batchSize, stepInstance, 64);
+    }
+    else
+    {
+        for (std::size_t instance = 0; instance < env->batchSize; ++instance) stepInstance(instance);
+    }
+}
+
+extern "C" const char* fishery_env_last_error(void)
+{
+    return getFisheryEnvironmentError().c_str();
+}
+
+/**
+ * @brief Benchmarks the batched environment of FisheryEnvironment.h through its C interface.
+ * The same number of instance steps is run once as a single batch of batchSize instances, and once as batchSize
+ * environments of one instance stepped one call at a time, as a trainer without the batch interface would.
+ * Every instance takes the constant action, and the mean reward and episode count of both runs are reported.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runBatchedEnvironment(const json& params)
+{
+    std::string modelName;
+    int batchSize = 0;
+    std::size_t steps = 0;
+    double action = 0.0;
+    std::uint32_t seed = 0;
+
+    try
+    {
+        auto environmentParams = params.at("batchedEnvironment");
+        modelName = environmentParams.at("model").get<std::string>();
+        batchSize = environmentParams.at("batchSize").get<int>();
+        steps = environmentParams.at("steps").get<std::size_t>();
+        action = environmentParams.at("action").get<double>();
+        seed = environmentParams.at("seed").get<std::uint32_t>();
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing batched environment parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    if (batchSize < 1 || steps == 0)
+    {
+        std::cout << "Error: The batched environment needs at least one instance and one step." << std::endl;
+        return 1;
+    }
+
+    std::string parametersJson = params.dump();
+    FisheryEnvironment* batched = fishery_env_create(parametersJson.c_str(), modelName.c_str(), batchSize, 0, seed);
+    if (batched == nullptr)
+    {
+        std::cout << "Error: " << fishery_env_last_error() << std::endl;
+        return 1;
+    }
+    std::size_t instances = static_cast<std::size_t>(batchSize);
+    std::size_t observationSize = static_cast<std::size_t>(fishery_env_observation_size(batched));
+
+    std::cout << "--- Batched Environment (" << modelName << ") ---" << std::endl;
+    std::cout << instances << " instances, " << steps << " steps, action " << action << ", "
+        << observationSize << " observations per instance, " << ThreadPool::shared().size() << " threads" << std::endl;
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "batched_environment_" + modelName + "_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Batched environment benchmark (" + modelName + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("batchedEnvironment").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logger.writeHeader("Run,Instances,Calls,InstanceStepsPerSecond,MeanReward,Episodes");
+
+    printf("\n%-14s | %10s | %10s | %18s | %14s | %10s\n", "Run", "Instances", "Calls", "Instance Steps/s", "Mean Reward", "Episodes");
+    printf("---------------------------------------------------------------------------------------------\n");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<double> actions(instances, action);
+    std::vector<double> observations(instances * observationSize);
+    std::vector<double> rewards(instances);
+    std::vector<unsigned char> dones(instances);
+    auto report = [&](const std::string& run, std::size_t calls, double seconds, double totalReward, std::size_t episodes)
+    {
+        double instanceSteps = static_cast<double>(instances * steps);
+        double stepsPerSecond = (seconds > 0.0) ? instanceSteps / seconds : 0.0;
+        printf("%-14s | %10zu | %10zu | %18.0f | %14.4f | %10zu\n", run.c_str(), instances, calls, stepsPerSecond, totalReward / instanceSteps, episodes);
+        logger.writeRow(run, { static_cast<double>(instances), static_cast<double>(calls), stepsPerSecond, totalReward / instanceSteps, static_cast<double>(episodes) });
+    };
+
+    //one batch, one call per step
+    {
+        double totalReward = 0.0;
+        std::size_t episodes = 0;
+        fishery_env_reset(batched, observations.data());
+        auto runStart = std::chrono::high_resolution_clock::now();
+        for (std::size_t step = 0; step < steps; ++step)
+        {
+            fishery_env_step(batched, actions.data(), observations.data(), rewards.data(), dones.data());
+            for (std::size_t instance = 0; instance < instances; ++instance)
+            {
+                totalReward += rewards[instance];
+                episodes += dones[instance];
+            }
+        }
+        std::chrono::duration<double> runDuration = std::chrono::high_resolution_clock::now() - runStart;
+        report("batched", steps, runDuration.count(), totalReward, episodes);
+    }
+    fishery_env_destroy(batched);
+
+    //one environment per instance, one call per instance step
+    {
+        std::vector<FisheryEnvironment*> singles(instances);
+        for (std::size_t instance = 0; instance < instances; ++instance)
+        {
+            singles[instance] = fishery_env_create(parametersJson.c_str(), modelName.c_str(), 1, 0, seed + static_cast<std::uint32_t>(instance));
+            fishery_env_reset(singles[instance], &observations[instance * observationSize]);
+        }
+        double totalReward = 0.0;
+        std::size_t episodes = 0;
+        auto runStart = std::chrono::high_resolution_clock::now();
+        for (std::size_t step = 0; step < steps; ++step)
+        {
+            for (std::size_t instance = 0; instance < instances; ++instance)
+            {
+                fishery_env_step(singles[instance], &actions[instance], &observations[instance * observationSize], &rewards[instance], &dones[instance]);
+                totalReward += rewards[instance];
+                episodes += dones[instance];
+            }
+        }
+        std::chrono::duration<double> runDuration = std::chrono::high_resolution_clock::now() - runStart;
+        report("one at a time", steps * instances, runDuration.count(), totalReward, episodes);
+        for (FisheryEnvironment* single : singles) fishery_env_destroy(single);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Loads the harvest policy of a model from the optional "policyFile" key of its section (see runHarvestPolicy).
+ * @param outEnabled (Output) True if the model section names a policy file.
+ * @return True if there is no policy file, or if it was loaded and belongs to the model.
+ */
+bool loadHarvestPolicy(const json& modelParams, const std::string& modelName, PolicyTable& outPolicy, bool& outEnabled)
+{
+    outEnabled = modelParams.contains("policyFile");
+    if (!outEnabled) return true;
+
+    std::string policyFile = modelParams.at("policyFile").get<std::string>();
+    if (!outPolicy.load(policyFile)) return false;
+    if (outPolicy.modelName != modelName)
+    {
+        std::cout << "Error: The policy file " << policyFile << " was computed for the " << outPolicy.modelName << ", not the " << modelName << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the profit-maximizing harvest policy of the simple or delay model by stochastic dynamic programming
+ * (see HarvestPolicy.h), and writes it as a policy table the single-run models follow through their "policyFile" key.
+ *
+ * - Simple model: the state is the fish stock and the action the harvest rate. A ton sells at fishPrice and costs
+ *   fishingCost at the carrying capacity, rising inversely with the stock as the fish get scarcer to find.
+ * - Delay model: the state is the population n and the market stock S, and the action the harvesting effort E,
+ *   held over the stepsPerYear steps of the year. The yearly profit is the industry's income p((1 - eta)qnE + delta S) - cE
+ *   of the delay equations, integrated over the steps with the model's fishPrice and fishingCost.
+ *
+ * The noise of a year is integrated by Gauss-Hermite quadrature. The delay model draws its catchability noise every
+ * step, which cannot be integrated node by node, so a year uses one multiplier with the standard deviation of the
+ * mean of the stepsPerYear draws.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runHarvestPolicy(const json& params)
+{
+    std::string modelName;
+    std::string policyFile;
+    double discountRate = 0.0;
+    DynamicProgramSettings settings;
+    json gridParams;
+
+    try
+    {
+        auto policyParams = params.at("harvestPolicy");
+        modelName = policyParams.at("model").get<std::string>();
+        policyFile = policyParams.at("policyFile").get<std::string>();
+        discountRate = policyParams.at("discountRate").get<double>();
+        settings.actionPoints = policyParams.at("actionPoints").get<std::size_t>();
+        settings.quadraturePoints = policyParams.at("quadraturePoints").get<std::size_t>();
+        settings.tolerance = policyParams.at("tolerance").get<double>();
+        settings.maxIterations = policyParams.at("maxIterations").get<std::size_t>();
+        gridParams = policyParams.at(modelName);
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing harvest policy parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice != 1 && modelChoice != 2)
+    {
+        std::cout << "Error: Harvest policies can be computed for the simpleModel or the delayModel." << std::endl;
+        return 1;
+    }
+    if (!(discountRate > 0.0) || settings.actionPoints < 2 || settings.quadraturePoints < 1)
+    {
+        std::cout << "Error: The harvest policy needs a positive discountRate, at least 2 actionPoints and 1 quadraturePoint." << std::endl;
+        return 1;
+    }
+    settings.discountFactor = 1.0 / (1.0 + discountRate);
+
+    Fishery fishery;
+    FishingIndustry industry;
+    int simulationYears = 0;
+    int stepsPerYear = 1;
+    if (!loadParametersFromJSON(params, fishery, industry, modelChoice, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading " << modelName << " parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    PolicyTable table;
+    table.modelName = modelName;
+    StochasticDynamicProgram::Transition transition;
+    double fishPrice = 0.0;
+    double fishingCost = 0.0;
+    std::vector<double> initialState;
+    try
+    {
+        PolicyAxis stockAxis;
+        stockAxis.lower = 0.0;
+        stockAxis.points = gridParams.at("stockPoints").get<std::size_t>();
+        stockAxis.upper = gridParams.at("maxStock").get<double>();
+        if (modelChoice == 1)
+        {
+            stockAxis.name = "FishStock_tons";
+            table.axes = { stockAxis };
+            table.actionName = "HarvestRate";
+            settings.actionUpper = gridParams.at("maxHarvestRate").get<double>();
+            fishPrice = gridParams.at("fishPrice").get<double>();
+            fishingCost = gridParams.at("fishingCost").get<double>();
+            initialState = { fishery.getFishStock() };
+        }
+        else
+        {
+            stockAxis.name = "Population_n";
+            PolicyAxis marketAxis;
+            marketAxis.name = "MarketStock_S";
+            marketAxis.lower = 0.0;
+            marketAxis.points = gridParams.at("marketStockPoints").get<std::size_t>();
+            marketAxis.upper = gridParams.at("maxMarketStock").get<double>();
+            table.axes = { stockAxis, marketAxis };
+            table.actionName = "Effort_E";
+            settings.actionUpper = gridParams.at("maxEffort").get<double>();
+            fishPrice = industry.getFishPrice();
+            fishingCost = industry.getFishingCost();
+            initialState = { fishery.getFishStock(), industry.getFishMarketStock() };
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing harvest policy grid parameter for the " << modelName << " in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    for (const PolicyAxis& axis : table.axes)
+    {
+        if (axis.points < 2 || !(axis.upper > axis.lower))
+        {
+            std::cout << "Error: The " << axis.name << " axis needs at least 2 points and a positive maximum." << std::endl;
+            return 1;
+        }
+    }
+    if (!(settings.actionUpper > 0.0))
+    {
+        std::cout << "Error: The maximum action of the harvest policy must be positive." << std::endl;
+        return 1;
+    }
+
+    if (modelChoice == 1)
+    {
+        double reproductionRate = fishery.getSimpleReproductionRate();
+        double carryingCapacity = fishery.getSimpleCarryingCapacity();
+        double reproductionStdDev = fishery.getReproductionStdDev();
+        transition = [=](const double* state, double harvestRate, double noise, double* outNextState)
+        {
+            double stock = state[0];
+            double multiplier = std::max(0.0, 1.0 + reproductionStdDev * noise);
+            double nextStock = stock + SimpleModelGrowthAmount(stock, reproductionRate, carryingCapacity, harvestRate, multiplier);
+
+            //the harvest is limited by the fish that are there
+            double harvest = harvestRate + std::min(0.0, nextStock);
+            outNextState[0] = std::max(0.0, nextStock);
+            if (stock <= 0.0 || harvest <= 0.0) return 0.0;
+            return harvest * (fishPrice - fishingCost * carryingCapacity / stock);
+        };
+    }
+    else
+    {
+        double timeStep = 1.0 / stepsPerYear;
+        double yearlyStdDev = fishery.getCatchabilityStdDev() / std::sqrt(static_cast<double>(stepsPerYear));
+        double catchStockingRate = industry.getCatchStockingRate();
+        double stockReturnRate = industry.getStockReturnRate();
+        transition = [&, timeStep, yearlyStdDev, catchStockingRate, stockReturnRate](const double* state, double effort, double noise, double* outNextState)
+        {
+            double multiplier = std::max(0.0, 1.0 + yearlyStdDev * noise);
+            double n = state[0];
+            double S = state[1];
+            double profit = 0.0;
+            for (int i = 0; i < stepsPerYear; ++i)
+            {
+                //the effort is set by the policy instead of following dE/dt
+                double E = effort;
+                double marketSales = stockReturnRate * S;
+                double catchRate = DelayEquationModelStep(n, E, S, fishery, industry, multiplier, timeStep);
+                profit += (fishPrice * ((1.0 - catchStockingRate) * catchRate + marketSales) - fishingCost * effort) * timeStep;
+            }
+            outNextState[0] = n;
+            outNextState[1] = S;
+            return profit;
+        };
+    }
+
+    std::cout << "--- Harvest Policy (Stochastic Dynamic Programming, " << modelName << ") ---" << std::endl;
+    std::cout << table.getStateCount() << " states, " << settings.actionPoints << " actions, " << settings.quadraturePoints
+        << " quadrature points, discount factor " << settings.discountFactor << ", " << ThreadPool::shared().size() << " threads" << std::endl;
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "harvest_policy_" + modelName + "_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Harvest policy by stochastic dynamic programming (" + modelName + ")");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("harvestPolicy").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    StochasticDynamicProgram program(settings);
+    DynamicProgramResult result = program.solve(table, transition, ThreadPool::shared());
+
+    std::cout << "Value iteration " << (result.converged ? "converged" : "did not converge") << " after " << result.iterations
+        << " iterations (last change " << (result.residuals.empty() ? 0.0 : result.residuals.back()) << ")" << std::endl;
+    logger.writeComment("Iterations: " + std::to_string(result.iterations) + (result.converged ? " (converged)" : " (not converged)"));
+
+    //the policy along the stock axis, with the other state variables at their initial values
+    const PolicyAxis& stockAxis = table.axes[0];
+    std::string header = stockAxis.name + "," + table.actionName + ",Value";
+    logger.writeHeader(header);
+    printf("\n%16s | %16s | %16s\n", stockAxis.name.c_str(), table.actionName.c_str(), "Value");
+    printf("----------------------------------------------------------\n");
+    const std::size_t rows = 11;
+    std::vector<double> state = initialState;
+    for (std::size_t row = 0; row < rows; ++row)
+    {
+        state[0] = stockAxis.lower + (stockAxis.upper - stockAxis.lower) * row / (rows - 1);
+        double action = table.getAction(state.data());
+        double value = table.getValue(state.data());
+        printf("%16.4f | %16.4f | %16.4f\n", state[0], action, value);
+        logger.writeRow(std::to_string(state[0]), { action, value });
+    }
+    std::cout << "\nAt the initial state: " << table.actionName << " " << table.getAction(initialState.data())
+        << ", expected discounted profit " << table.getValue(initialState.data()) << std::endl;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    if (!table.save(policyFile)) return 1;
+    std::cout << "\nPolicy table saved to:\n" << getCurrentWorkingDirectory() << "/" << policyFile << std::endl;
+    std::cout << "Set \"policyFile\" in the " << modelName << " section to run the model with it." << std::endl;
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Loads the community of the "multiSpeciesModel" section: the "species" and their "interactions", or a
+ * generated cascade food web when "cascadeCommunity" has a positive species count.
+ * Interactions are {"type": "predation", "predator", "prey", "rate", "efficiency"}, where the prey loses rate * B_prey * B_predator
+ * per year and the predator gains efficiency times that, or {"type": "competition", "species": [a, b], "rate"}, where each
+ * loses rate * B_a * B_b.
+ * @param outDense (Output) The interaction matrix, row-major.
+ * @return True on success, false (after printing the error) on a missing or invalid value.
+ */
+bool loadMultiSpeciesCommunity(const json& modelParams, std::vector<SpeciesParameters>& outSpecies, std::vector<double>& outDense)
+{
+    try
+    {
+        auto cascadeParams = modelParams.at("cascadeCommunity");
+        CascadeCommunitySettings cascade;
+        cascade.species = cascadeParams.at("species").get<std::size_t>();
+        if (cascade.species > 0)
+        {
+            cascade.connectance = cascadeParams.at("connectance").get<double>();
+            cascade.attackRate = cascadeParams.at("attackRate").get<double>();
+            cascade.efficiency = cascadeParams.at("efficiency").get<double>();
+            cascade.fishingMortality = cascadeParams.at("fishingMortality").get<double>();
+            cascade.growthStdDev = cascadeParams.at("growthStdDev").get<double>();
+            cascade.seed = cascadeParams.at("seed").get<std::uint32_t>();
+            generateCascadeCommunity(cascade, outSpecies, outDense);
+            return true;
+        }
+
+        outSpecies.clear();
+        std::map<std::string, std::size_t> speciesIndex;
+        for (const json& entry : modelParams.at("species"))
+        {
+            SpeciesParameters s;
+            s.name = entry.at("name").get<std::string>();
+            s.growthRate = entry.at("growthRate").get<double>();
+            s.carryingCapacity = entry.at("carryingCapacity").get<double>();
+            s.initialBiomass = entry.at("initialBiomass").get<double>();
+            s.growthStdDev = entry.at("growthStdDev").get<double>();
+            s.fishingMortality = entry.at("fishingMortality").get<double>();
+            if (!(s.carryingCapacity > 0.0) || s.initialBiomass < 0.0 || s.fishingMortality < 0.0)
+            {
+                std::cout << "Error: Species '" << s.name << "' needs a positive carryingCapacity and a non-negative initialBiomass and fishingMortality." << std::endl;
+                return false;
+            }
+            if (!speciesIndex.emplace(s.name, outSpecies.size()).second)
+            {
+                std::cout << "Error: Species '" << s.name << "' is listed twice." << std::endl;
+                return false;
+            }
+            outSpecies.push_back(s);
+        }
+        if (outSpecies.empty())
+        {
+            std::cout << "Error: At least one species is required." << std::endl;
+            return false;
+        }
+
+        std::size_t n = outSpecies.size();
+        outDense.assign(n * n, 0.0);
+        auto findSpecies = [&](const std::string& name, std::size_t& outIndex)
+        {
+            auto found = speciesIndex.find(name);
+            if (found == speciesIndex.end())
+            {
+                std::cout << "Error: Unknown species '" << name << "' in the interactions." << std::endl;
+                return false;
+            }
+            outIndex = found->second;
+            return true;
+        };
+        for (const json& entry : modelParams.at("interactions"))
+        {
+            std::string type = entry.at("type").get<std::string>();
+            double rate = entry.at("rate").get<double>();
+            if (type == "predation")
+            {
+                std::size_t predator = 0;
+                std::size_t prey = 0;
+                if (!findSpecies(entry.at("predator").get<std::string>(), predator) || !findSpecies(entry.at("prey").get<std::string>(), prey)) return false;
+                outDense[prey * n + predator] -= rate;
+                outDense[predator * n + prey] += entry.at("efficiency").get<double>() * rate;
+            }
+            else if (type == "competition")
+            {
+                std::vector<std::string> pair = entry.at("species").get<std::vector<std::string>>();
+                std::size_t a = 0;
+                std::size_t b = 0;
+                if (pair.size() != 2 || !findSpecies(pair[0], a) || !findSpecies(pair[1], b))
+                {
+                    if (pair.size() != 2) std::cout << "Error: A competition interaction needs two species." << std::endl;
+                    return false;
+                }
+                outDense[a * n + b] -= rate;
+                outDense[b * n + a] -= rate;
+            }
+            else
+            {
+                std::cout << "Error: Unknown interaction type '" << type << "'. Use predation or competition." << std::endl;
+                return false;
+            }
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing multi-species model parameter in JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs an ensemble of the multi-species model configured in the "multiSpeciesModel" section of parameters.json
+ * (see MultiSpeciesModel.h). Every replicate draws the yearly growth noise of each species from its own stream, and
+ * the replicates are simulated in parallel. Logs the mean biomass of every species and the mean total catch per year.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runMultiSpeciesModel(const json& params)
+{
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    std::size_t replicates = 0;
+    std::uint32_t seed = 0;
+    double sparseDensity = 0.0;
+    std::vector<SpeciesParameters> species;
+    std::vector<double> dense;
+
+    try
+    {
+        auto modelParams = params.at("multiSpeciesModel");
+        simulationYears = modelParams.at("simulationYears").get<int>();
+        stepsPerYear = modelParams.at("stepsPerYear").get<int>();
+        replicates = modelParams.at("replicates").get<std::size_t>();
+        seed = modelParams.at("seed").get<std::uint32_t>();
+        sparseDensity = modelParams.at("sparseDensity").get<double>();
+        if (!loadMultiSpeciesCommunity(modelParams, species, dense)) return 1;
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing multi-species model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    if (simulationYears < 1 || stepsPerYear < 1 || replicates == 0)
+    {
+        std::cout << "Error: The multi-species model needs at least one year, one step per year and one replicate." << std::endl;
+        return 1;
+    }
+
+    std::size_t speciesCount = species.size();
+    MultiSpeciesModel model(species, InteractionMatrix(speciesCount, dense, sparseDensity));
+    const InteractionMatrix& interactions = model.getInteractions();
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "multi_species_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Multi-Species Model (" + std::to_string(speciesCount) + " species, " + std::to_string(replicates) + " replicates)");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("multiSpeciesModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+
+    std::string header = "Year";
+    for (const SpeciesParameters& s : species) header += "," + s.name + "_MeanBiomass";
+    header += ",MeanTotalCatch";
+    logger.writeHeader(header);
+
+    std::cout << "--- Multi-Species Model (" << speciesCount << " species, " << interactions.getNonZeroCount() << " interactions, "
+        << (interactions.isSparse() ? "sparse" : "dense") << " matrix) ---" << std::endl;
+    ThreadPool& pool = ThreadPool::shared();
+    std::cout << replicates << " replicates, " << simulationYears << " years of " << stepsPerYear << " steps, " << pool.size() << " threads" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    //per chunk statistics of the biomass of every species and the total catch, cell [year * (species + 1) + variable]
+    std::size_t variables = speciesCount + 1;
+    std::size_t cells = (simulationYears + 1) * variables;
+    std::size_t chunkCount = std::min(replicates, pool.size() * 4);
+    std::vector<std::vector<RunningMoments>> chunkMoments(chunkCount, std::vector<RunningMoments>(cells));
+    double timeStep = 1.0 / stepsPerYear;
+    pool.parallelFor(chunkCount, [&](std::size_t chunk)
+    {
+        std::vector<double> biomass(speciesCount);
+        std::vector<double> multipliers(speciesCount);
+        std::vector<double> interactionRates(speciesCount);
+        std::vector<double> catches(speciesCount);
+        std::vector<RunningMoments>& moments = chunkMoments[chunk];
+        for (std::size_t replicate = chunk; replicate < replicates; replicate += chunkCount)
+        {
+            TraceScope trace("Replicate", "ensemble", "replicate", static_cast<long long>(replicate));
+
+            //the fishery provides the noise stream of the replicate
+            Fishery noise;
+            noise.setSeed(seed, static_cast<std::uint32_t>(replicate));
+            for (std::size_t i = 0; i < speciesCount; ++i)
+            {
+                biomass[i] = species[i].initialBiomass;
+                moments[i].add(biomass[i]);
+            }
+            moments[speciesCount].add(0.0);
+
+            for (int year = 1; year <= simulationYears; ++year)
+            {
+                for (std::size_t i = 0; i < speciesCount; ++i) multipliers[i] = noise.getNoisyMultiplier(species[i].growthStdDev);
+                std::fill(catches.begin(), catches.end(), 0.0);
+                double totalCatch = 0.0;
+                for (int step = 0; step < stepsPerYear; ++step)
+                {
+                    totalCatch += model.step(SimpleModelGrowthAmount<double>, biomass.data(), multipliers.data(), timeStep, interactionRates.data(), catches.data());
+                }
+                for (std::size_t i = 0; i < speciesCount; ++i) moments[year * variables + i].add(biomass[i]);
+                moments[year * variables + speciesCount].add(totalCatch);
+            }
+        }
+    });
+
+    std::vector<RunningMoments> moments(cells);
+    for (const std::vector<RunningMoments>& chunk : chunkMoments)
+    {
+        for (std::size_t c = 0; c < cells; ++c) moments[c].merge(chunk[c]);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+
+    for (int year = 0; year <= simulationYears; ++year)
+    {
+        std::vector<double> row(variables);
+        for (std::size_t v = 0; v < variables; ++v) row[v] = moments[year * variables + v].getMean();
+        logger.writeRow(std::to_string(year), row);
+    }
+
+    printf("\n%-20s | %14s | %16s | %14s | %14s\n", "Species", "Initial", "Mean Final", "StdDev Final", "Min Final");
+    printf("------------------------------------------------------------------------------------------\n");
+    for (std::size_t i = 0; i < speciesCount; ++i)
+    {
+        const RunningMoments& finalBiomass = moments[simulationYears * variables + i];
+        printf("%-20s | %14.2f | %16.2f | %14.2f | %14.2f\n", species[i].name.c_str(), species[i].initialBiomass,
+            finalBiomass.getMean(), finalBiomass.getStdDev(), finalBiomass.getMin());
+    }
+    printf("Mean total catch in the final year: %.2f\n", moments[simulationYears * variables + speciesCount].getMean());
+
+    double speciesSteps = static_cast<double>(replicates) * simulationYears * stepsPerYear * speciesCount;
+    printf("Species steps per second: %.0f\n", speciesSteps / (duration.count() / 1000.0));
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Reads a harvest map: one line per grid row with one relative fishing weight per cell, comma separated.
+ * Lines starting with '#' are comments.
+ * @return True if the file was read and has height rows of width values.
+ */
+bool loadHarvestMap(const std::string& filename, std::size_t width, std::size_t height, std::vector<double>& outWeights)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cout << "Error: Could not open harvest map: " << filename << std::endl;
+        return false;
+    }
+
+    outWeights.clear();
+    outWeights.reserve(width * height);
+    std::string line;
+    std::size_t rows = 0;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::stringstream ss(line);
+        std::string cell;
+        std::size_t columns = 0;
+        while (std::getline(ss, cell, ','))
+        {
+            outWeights.push_back(std::strtod(cell.c_str(), nullptr));
+            ++columns;
+        }
+        if (columns != width)
+        {
+            std::cout << "Error: Row " << rows + 1 << " of the harvest map " << filename << " has " << columns << " values, the grid is " << width << " wide." << std::endl;
+            return false;
+        }
+        ++rows;
+    }
+    if (rows != height)
+    {
+        std::cout << "Error: The harvest map " << filename << " has " << rows << " rows, the grid is " << height << " high." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the spatial simple model configured in the "spatialModel" section of parameters.json (see SpatialModel.h).
+ * The biology comes from "simpleModel": its carrying capacity and initial stock are spread evenly over the cells, and
+ * its harvestRate over the fished cells in proportion to the harvest map (a CSV of relative weights), or evenly
+ * outside the protectedAreas when no map is given. The growth noise is one regional multiplier per year.
+ * Logs the total biomass, catch and the biomass inside and outside the unfished cells per year.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runSpatialModel(const json& params)
+{
+    Fishery myFishery = Fishery();
+    FishingIndustry myFishingIndustry = FishingIndustry();
+    int simpleYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, myFishery, myFishingIndustry, 1, simpleYears, stepsPerYear))
+    {
+        std::cout << "Error loading simple model parameters. Exiting." << std::endl;
+        return 1;
+    }
+
+    std::size_t width = 0;
+    std::size_t height = 0;
+    int simulationYears = 0;
+    double adultDiffusion = 0.0;
+    double larvalDiffusion = 0.0;
+    std::string harvestMapFile;
+    std::string finalMapFile;
+    std::size_t tileRows = 0;
+    std::size_t tileColumns = 0;
+    std::vector<double> weights;
+
+    try
+    {
+        auto spatialParams = params.at("spatialModel");
+        width = spatialParams.at("width").get<std::size_t>();
+        height = spatialParams.at("height").get<std::size_t>();
+        simulationYears = spatialParams.at("simulationYears").get<int>();
+        adultDiffusion = spatialParams.at("adultDiffusion").get<double>();
+        larvalDiffusion = spatialParams.at("larvalDiffusion").get<double>();
+        harvestMapFile = spatialParams.at("harvestMap").get<std::string>();
+        finalMapFile = spatialParams.at("finalMapFile").get<std::string>();
+        tileRows = spatialParams.at("tileRows").get<std::size_t>();
+        tileColumns = spatialParams.at("tileColumns").get<std::size_t>();
+
+        if (width == 0 || height == 0 || simulationYears < 1)
+        {
+            std::cout << "Error: The spatial model needs a grid of at least one cell and one simulation year." << std::endl;
+            return 1;
+        }
+        if (!harvestMapFile.empty())
+        {
+            if (!loadHarvestMap(harvestMapFile, width, height, weights)) return 1;
+        }
+        else
+        {
+            weights.assign(width * height, 1.0);
+            for (const json& area : spatialParams.at("protectedAreas"))
+            {
+                std::size_t column = area.at("column").get<std::size_t>();
+                std::size_t row = area.at("row").get<std::size_t>();
+                std::size_t rowEnd = std::min(height, row + area.at("height").get<std::size_t>());
+                std::size_t columnEnd = std::min(width, column + area.at("width").get<std::size_t>());
+                for (std::size_t y = row; y < rowEnd; ++y)
+                {
+                    for (std::size_t x = column; x < columnEnd; ++x) weights[y * width + x] = 0.0;
+                }
+            }
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing spatial model parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+    if (adultDiffusion < 0.0 || adultDiffusion > 0.25 || larvalDiffusion < 0.0 || larvalDiffusion > 0.25)
+    {
+        std::cout << "Error: 'adultDiffusion' and 'larvalDiffusion' must lie in [0, 0.25] for a stable dispersal step." << std::endl;
+        return 1;
+    }
+
+    double totalWeight = 0.0;
+    for (double weight : weights)
+    {
+        if (weight < 0.0)
+        {
+            std::cout << "Error: The harvest map has negative weights." << std::endl;
+            return 1;
+        }
+        totalWeight += weight;
+    }
+    double cells = static_cast<double>(width * height);
+    std::vector<double> harvestMap(width * height, 0.0);
+    if (totalWeight > 0.0)
+    {
+        for (std::size_t cell = 0; cell < harvestMap.size(); ++cell) harvestMap[cell] = myFishingIndustry.getSimpleHarvestRate() * weights[cell] / totalWeight;
+    }
+
+    SpatialLogisticModel model(width, height, harvestMap, adultDiffusion, larvalDiffusion, tileRows, tileColumns);
+    std::fill(model.getBiomass().begin(), model.getBiomass().end(), myFishery.getFishStock() / cells);
+    double reproductionRate = myFishery.getSimpleReproductionRate();
+    double cellCapacity = myFishery.getSimpleCarryingCapacity() / cells;
+
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "spatial_model_simulation_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
+
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Spatial Simple Logistic Model (" + std::to_string(width) + " x " + std::to_string(height) + " cells)");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("spatialModel").dump(4) << "\n" << params.at("simpleModel").dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    logger.writeHeader("Year,TotalBiomass,TotalCatch,UnfishedCellsBiomass,FishedCellsBiomass");
+
+    std::size_t unfishedCells = std::count(harvestMap.begin(), harvestMap.end(), 0.0);
+    std::cout << "--- Spatial Simple Logistic Model (" << width << " x " << height << " cells, " << unfishedCells << " unfished) ---" << std::endl;
+    printf("Year | Total Biomass | Total Catch | Unfished Cells | Fished Cells\n");
+    printf("-----------------------------------------------------------------------\n");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    SpatialStepTotals totals = model.getTotals();
+    auto report = [&](int year)
+    {
+        double fished = totals.biomass - totals.unfishedBiomass;
+        printf("%4d | %13.2f | %11.2f | %14.2f | %12.2f\n", year, totals.biomass, totals.catchBiomass, totals.unfishedBiomass, fished);
+        logger.writeRow(std::to_string(year), { totals.biomass, totals.catchBiomass, totals.unfishedBiomass, fished });
+    };
+    report(0);
+
+    ThreadPool& pool = ThreadPool::shared();
+    for (int year = 1; year <= simulationYears; ++year)
+    {
+        TraceScope trace("SpatialStep", "simulation", "year", year);
+
+        //one regional noise multiplier on the reproduction rate per year
+        double noise = myFishery.getNoisyMultiplier(myFishery.getReproductionStdDev());
+        totals = model.step([&](double stock) { return SimpleModelGrowthAmount(stock, reproductionRate, cellCapacity, 0.0, noise); }, pool);
+        report(year);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    printf("Cell updates per second: %.0f\n", cells * simulationYears / (duration.count() / 1000.0));
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", durationString.c_str());
+
+    logger.writeComment("");
+    logger.writeComment(durationString);
+    logger.close();
+
+    if (!finalMapFile.empty())
+    {
+        std::ofstream mapFile(finalMapFile, std::ios::out | std::ios::trunc);
+        if (!mapFile.is_open())
+        {
+            std::cout << "Error: Could not open map file for writing: " << finalMapFile << std::endl;
+            return 1;
+        }
+        const std::vector<double>& biomass = model.getBiomass();
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x) mapFile << (x > 0 ? "," : "") << biomass[y * width + x];
+            mapFile << "\n";
+        }
+        std::cout << "\nFinal biomass map saved to:\n" << getCurrentWorkingDirectory() << "/" << finalMapFile << std::endl;
+    }
+
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
+}
+
+/**
+ * @brief The log-likelihood of a log-normal observation, observed ~ LogNormal(ln(catchability * predicted), sigma).
+ * @return -infinity when the prediction is not positive.
+ */
+double getLogNormalObservationLikelihood(double observed, double predicted, double catchability, double sigma)
+{
+    if (!(predicted > 0.0)) return -std::numeric_limits<double>::infinity();
+    double z = (std::log(observed) - std::log(catchability * predicted)) / sigma;
+    return -0.5 * z * z - std::log(sigma * observed * std::sqrt(2.0 * 3.14159265358979323846));
+}
+
+/**
+ * @brief Tracks the stock of the delay or age-structured model with a particle filter, configured in the
+ * "particleFilter" section. The rows of the observations file are assimilated one year at a time, as they
+ * would arrive from a monitoring programme: every particle is advanced by a year with the model's stochastic
+ * step, weighted by the new observations and resampled, and the updated stock estimate is reported with the
+ * time the update took.
+ * @return 0 on success, 1 on a configuration error.
+ */
+int runParticleFilter(const json& params)
+{
+    std::string modelName;
+    std::string observationsFile;
+    ParticleFilterSettings settings;
+    std::vector<ObservedSeries> series;
+    std::vector<double> catchabilities;
+
+    try
+    {
+        auto filterParams = params.at("particleFilter");
+        modelName = filterParams.at("model").get<std::string>();
+        observationsFile = filterParams.at("observationsFile").get<std::string>();
+        settings.particles = filterParams.at("particles").get<std::size_t>();
+        settings.resampleThreshold = filterParams.at("resampleThreshold").get<double>();
+        settings.seed = filterParams.at("seed").get<std::uint32_t>();
+
+        for (auto& item : filterParams.at("series").items())
+        {
+            ObservedSeries observed;
+            observed.name = item.key();
+            observed.prediction = item.value().at("prediction").get<std::string>();
+            observed.sigma = item.value().at("sigma").get<double>();
+            series.push_back(observed);
+            catchabilities.push_back(item.value().at("catchability").get<double>());
+        }
+    }
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Missing particle filter parameter in JSON file:\n" << e.what() << std::endl;
+        return 1;
+    }
+
+    int modelChoice = getModelChoiceFromName(modelName);
+    if (modelChoice != 2 && modelChoice != 3)
+    {
+        std::cout << "Error: The particle filter supports 'delayModel' and 'ageStructuredModel', not '" << modelName << "'." << std::endl;
+        return 1;
+    }
+    if (settings.particles < 1 || series.empty())
+    {
+        std::cout << "Error: The particle filter needs at least one particle and one observed series." << std::endl;
+        return 1;
+    }
+    for (std::size_t i = 0; i < series.size(); ++i)
+    {
+        const ObservedSeries& observed = series[i];
+        bool known = (observed.prediction == "catch" || observed.prediction == "biomass")
+            || (modelChoice == 3 && observed.prediction == "ssb") || (modelChoice == 2 && observed.prediction == "effort");
+        if (!known)
+        {
+            std::cout << "Error: Series '" << observed.name << "' predicts unknown output '" << observed.prediction << "'." << std::endl;
+            return 1;
+        }
+        if (observed.sigma <= 0.0 || catchabilities[i] <= 0.0)
+        {
+            std::cout << "Error: Series '" << observed.name << "' needs a positive sigma and catchability." << std::endl;
+            return 1;
+        }
+    }
+
+    Fishery baseFishery = Fishery();
+    FishingIndustry baseIndustry = FishingIndustry();
+    int simulationYears = 0;
+    int stepsPerYear = 0;
+    if (!loadParametersFromJSON(params, baseFishery, baseIndustry, modelChoice, simulationYears, stepsPerYear))
+    {
+        std::cout << "Error loading " << modelName << " parameters. Exiting." << std::endl;
+        return 1;
+    }
+    if (!loadObservedSeries(observationsFile, series)) return 1;
+
+    //the observations of each year, as (series, value) pairs
+    std::map<int, std::vector<std::pair<std::size_t, double>>> observationsByYear;
+    for (std::size_t i = 0; i < series.size(); ++i)
+    {
+        for (std::size_t j = 0; j < series[i].years.size(); ++j)
+        {
+            if (series[i].years[j] < 1)
+            {
+                std::cout << "Error: Series '" << series[i].name << "' has an observation in year " << series[i].years[j]
+                    << ", before the first simulated year." << std::endl;
+                return 1;
+            }
+            observationsByYear[series[i].years[j]].emplace_back(i, series[i].values[j]);
         }
-        return true;
     }
-    catch (json::parse_error& e) 
+    if (observationsByYear.empty())
     {
-        std::cout << "Error: Failed to parse JSON file:\n" << e.what() << std::endl;
-        return false;
+        std::cout << "Error: The observations file has no observations." << std::endl;
+        return 1;
     }
-    catch (json::exception& e) 
+    int lastYear = observationsByYear.rbegin()->first;
+
+    //the particle variables: the model state, then the outputs of the last year
+    //delay model: n, E, S, catch
+    //age model: the numbers at age 0..maxAge, the recruitment deviation, biomass, ssb, catch
+    std::vector<double> initialState;
+    std::size_t biomassVariable = 0;
+    std::size_t ssbVariable = 0;
+    std::size_t catchVariable = 0;
+    std::size_t effortVariable = 1;
+    AgeModelParameters<double> ageParams;
+    std::vector<double> weightAtAge, maturityAtAge, survival, catchFactor;
+    if (modelChoice == 2)
     {
-        std::cout << "Error: Missing parameter in JSON file:\n" << e.what() << std::endl;
-        return false;
+        initialState = { baseFishery.getFishStock(), baseIndustry.getHarvestingEffort(), baseIndustry.getFishMarketStock(), 0.0 };
+        catchVariable = 3;
     }
-    catch (std::exception& e) 
+    else
     {
-        std::cout << "An unexpected error occurred: " << e.what() << std::endl;
-        return false;
-    }
-}
+        ageParams = getAgeModelParameters(baseFishery, baseIndustry);
+        initialState = baseFishery.getNumbersAtAge();
+        for (int age = 0; age <= ageParams.maxAge; ++age)
+        {
+            //the fishing mortality is fixed, so the rates are tabulated once for all the particles
+            double F = ageParams.fishingMortality * getSelectivityAtAge(age, ageParams);
+            double Z = ageParams.naturalMortality + F;
+            weightAtAge.push_back(getWeightAtAge(age, ageParams));
+            maturityAtAge.push_back(getMaturityAtAge(age, ageParams));
+            survival.push_back(std::exp(-Z));
+            catchFactor.push_back((F / Z) * (1.0 - std::exp(-Z)));
+        }
+        biomassVariable = ageParams.maxAge + 2;
+        ssbVariable = ageParams.maxAge + 3;
+        catchVariable = ageParams.maxAge + 4;
 
-/**
- * @brief Gets the current working directory.
- * @return A string with the path to the current working directory.
- */
-std::string getCurrentWorkingDirectory() 
-{
-    char buff[FILENAME_MAX];
-    if (GetCurrentDir(buff, FILENAME_MAX)) 
-    {
-        std::string current_working_dir(buff);
-        return current_working_dir;
+        //no deviation drawn yet: each particle's first one comes from the stationary distribution
+        initialState.push_back(std::numeric_limits<double>::quiet_NaN());
+        initialState.push_back(baseFishery.getTotalBiomass());
+        initialState.push_back(baseFishery.getSpawningStockBiomass());
+        initialState.push_back(0.0);
     }
-    //return a fallback message if CWD can't be found
-    return "[current application directory]";
-}
-
-/**
- * @brief Gets the current date and time as a string for filenames.
- * @return A string formatted as YYYYMMDD_HHMMSS.
- */
-std::string getCurrentTimestamp() 
-{
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
 
-    std::stringstream ss;
-    std::tm buf;
-
-#ifdef _WIN32
-    localtime_s(&buf, &in_time_t); //windows
-#else
-    localtime_r(&in_time_t, &buf); //POSIX
-#endif
+    ParticleFilter filter(settings, initialState);
+    std::size_t particles = filter.getParticleCount();
+    int maxAge = ageParams.maxAge;
 
-    ss << std::put_time(&buf, "%Y%m%d_%H%M%S");
-    return ss.str();
-}
+    //advances the particles [begin, end) by one year
+    ParticleFilter::Propagator propagate = [&](ParticleFilter& set, std::size_t begin, std::size_t end, std::uint32_t stream)
+    {
+        Fishery fishery = baseFishery;
+        fishery.setSeed(settings.seed, stream);
 
-/**
- * @brief Gets the current date and time as a human-readable string for logging.
- * @return A string formatted as YYYY-MM-DD HH:MM:SS
- */
-std::string getReadableTimestamp() 
-{
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    std::tm buf;
+        if (modelChoice == 2)
+        {
+            double* n = set.getVariable(0);
+            double* E = set.getVariable(1);
+            double* S = set.getVariable(2);
+            double* catches = set.getVariable(3);
+            double timeStep = 1.0 / stepsPerYear;
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                double yearCatch = 0.0;
+                for (int i = 0; i < stepsPerYear; ++i)
+                {
+                    double noise = fishery.getNoisyMultiplier(fishery.getCatchabilityStdDev());
+                    yearCatch += DelayEquationModelStep(n[p], E[p], S[p], fishery, baseIndustry, noise, timeStep) * timeStep;
+                }
+                catches[p] = yearCatch;
+            }
+            return;
+        }
 
-#ifdef _WIN32
-    localtime_s(&buf, &in_time_t); //windows
-#else
-    localtime_r(&in_time_t, &buf); //posix
-#endif
+        //the numbers at age of a particle are strided by the particle count
+        double* numbers = set.getVariable(0);
+        double* deviation = set.getVariable(maxAge + 1);
+        double* biomass = set.getVariable(biomassVariable);
+        double* ssb = set.getVariable(ssbVariable);
+        double* catches = set.getVariable(catchVariable);
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            double recruitment = fishery.getExpectedRecruitment(ssb[p]) * fishery.getRecruitmentMultiplier(deviation[p]);
+            catches[p] = stepTabulatedAgeModel(numbers + p, maxAge, survival.data(), catchFactor.data(), weightAtAge.data(), recruitment, particles);
+        }
 
-    ss << std::put_time(&buf, "%Y-%m-%d %H:%M:%S");
-    return ss.str();
-}
+        //the outputs, age by age over the contiguous particles of the chunk
+        std::fill(biomass + begin, biomass + end, 0.0);
+        std::fill(ssb + begin, ssb + end, 0.0);
+        for (int age = 0; age <= maxAge; ++age)
+        {
+            const double* cohort = set.getVariable(age);
+            double weight = weightAtAge[age];
+            double spawningWeight = weightAtAge[age] * maturityAtAge[age];
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                biomass[p] += cohort[p] * weight;
+                ssb[p] += cohort[p] * spawningWeight;
+            }
+        }
+    };
 
-/*  @brief Simulates a growth and harvesting step in the fishery
-*   This function utilizes a basic model with a logistic growth simulation
-*   Calculates the natural growth of the fish population for a step, then
-*   subtracts the harvested fish stock.
-*   @param fishery The fishery being simulated
-*   @param fishingindustry The fishing industry harvesting from the fishery
-*/
-double SimpleModelGrowthAmount(Fishery& fishery, FishingIndustry& fishingindustry)
-{
-    double noise = fishery.getNoisyMultiplier(fishery.getReproductionStdDev());
+    std::vector<std::size_t> predictionVariables;
+    for (const ObservedSeries& observed : series)
+    {
+        if (observed.prediction == "catch") predictionVariables.push_back(catchVariable);
+        else if (observed.prediction == "ssb") predictionVariables.push_back(ssbVariable);
+        else if (observed.prediction == "effort") predictionVariables.push_back(effortVariable);
+        else predictionVariables.push_back(biomassVariable);
+    }
 
-    //apply noise to reproduction rate
-    double noisyRate = fishery.getSimpleReproductionRate() * noise;
+    std::string timestamp = getCurrentTimestamp();
+    std::string filename = "particle_filter_" + timestamp + ".csv";
+    CSVManager logger;
+    logger.open(filename);
 
-    //calculate the natural growth of the fish stock
-    double naturalGrowth = noisyRate * fishery.getFishStock() * (1 - fishery.getFishStock() / fishery.getSimpleCarryingCapacity());
+    logger.writeComment("Simulation Log");
+    logger.writeComment("Model: Particle Filter (" + modelName + ", " + std::to_string(particles) + " particles)");
+    logger.writeComment("Timestamp: " + getReadableTimestamp());
+    logger.writeComment("Parameters: ");
+    std::stringstream ss;
+    ss << params.at("particleFilter").dump(4) << "\n" << params.at(modelName).dump(4);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        logger.writeComment("  " + line);
+    }
+    logger.writeComment("");
+    std::string stockName = (modelChoice == 2) ? "Population_n" : "TotalBiomass";
+    logger.writeHeader("Year,Observations," + stockName + "_Mean," + stockName + "_Q05," + stockName + "_Q95,"
+        + (modelChoice == 2 ? "Effort_E_Mean" : "SpawningStockBiomass_Mean") + ",EffectiveSampleSize,Resampled,LogLikelihood,UpdateTime_ms");
 
-    //calculate the impact of harvesting on the fish stock
-    //this number CAN be negative
-    double finalGrowth = naturalGrowth - fishingindustry.getSimpleHarvestRate();
+    std::cout << "--- Particle Filter (" << modelName << ", " << particles << " particles) ---" << std::endl;
+    printf("Year | Obs | Stock Mean |   Stock 5%% |  Stock 95%% |   ESS | Resampled | Update (ms)\n");
+    printf("---------------------------------------------------------------------------------------\n");
 
-    return finalGrowth;
-}
+    std::size_t secondVariable = (modelChoice == 2) ? effortVariable : ssbVariable;
+    ThreadPool& pool = ThreadPool::shared();
+    std::vector<double> logLikelihoods(particles);
+    double totalLogLikelihood = 0.0;
+    double slowestUpdate = 0.0;
 
-/*  @brief Simulates a growth and harvesting step in the fishery
-*   This function implements a system of delay equations
-*   @param fishery The fishery being simulated
-*   @param fishingindustry The fishing industry harvesting from the fishery
-*/
-void DelayEquationModelStep(Fishery& fishery, FishingIndustry& fishingindustry, double timeStep)
-{
-    double noise = fishery.getNoisyMultiplier(fishery.getCatchabilityStdDev());
+    auto start = std::chrono::high_resolution_clock::now();
 
-    double n = fishery.getFishStock();
-    double E = fishingindustry.getHarvestingEffort();
-    double S = fishingindustry.getFishMarketStock();
+    for (int year = 1; year <= lastYear; ++year)
+    {
+        TraceScope trace("FilterUpdate", "simulation", "year", year);
+        auto updateStart = std::chrono::high_resolution_clock::now();
+        filter.predict(propagate, pool);
 
-    //step catch - equation 1
-    double currentCatch = (fishery.getCatchability() * noise) * n * E;
+        ParticleFilterUpdate update;
+        update.effectiveSampleSize = static_cast<double>(particles);
+        auto observations = observationsByYear.find(year);
+        std::size_t observationCount = 0;
+        if (observations != observationsByYear.end())
+        {
+            const std::vector<std::pair<std::size_t, double>>& observed = observations->second;
+            observationCount = observed.size();
+            std::size_t chunks = (particles + settings.chunkSize - 1) / settings.chunkSize;
+            pool.parallelFor(chunks, [&](std::size_t chunk)
+            {
+                std::size_t end = std::min(particles, (chunk + 1) * settings.chunkSize);
+                for (std::size_t p = chunk * settings.chunkSize; p < end; ++p)
+                {
+                    double logLikelihood = 0.0;
+                    for (const std::pair<std::size_t, double>& observation : observed)
+                    {
+                        std::size_t i = observation.first;
+                        logLikelihood += getLogNormalObservationLikelihood(observation.second, filter.getVariable(predictionVariables[i])[p],
+                            catchabilities[i], series[i].sigma);
+                    }
+                    logLikelihoods[p] = logLikelihood;
+                }
+            });
+            update = filter.correct(logLikelihoods);
+            totalLogLikelihood += update.logLikelihood;
+        }
 
-    //calculate the rate of change for each variable
-    //dn/dt = rn(1-n) - qnE
-    double dn_dt = fishery.getSimpleReproductionRate() * n * (1 - n) - currentCatch;
+        //the estimate reported once the update is done
+        double mean = filter.getMean(biomassVariable);
+        double lower = filter.getQuantile(biomassVariable, 0.05);
+        double upper = filter.getQuantile(biomassVariable, 0.95);
+        double secondMean = filter.getMean(secondVariable);
+        std::chrono::duration<double, std::milli> updateTime = std::chrono::high_resolution_clock::now() - updateStart;
+        slowestUpdate = std::max(slowestUpdate, updateTime.count());
 
-    //dE/dt = p((1-η)qnE + δS) - cE
-    double dE_dt = fishingindustry.getFishPrice() * ((1 - fishingindustry.getCatchStockingRate()) * currentCatch + fishingindustry.getStockReturnRate() * S) - fishingindustry.getFishingCost() * E;
+        printf("%4d | %3zu | %10.2f | %10.2f | %10.2f | %5.0f | %9s | %11.3f\n", year, observationCount, mean, lower, upper,
+            update.effectiveSampleSize, update.resampled ? "yes" : "no", updateTime.count());
+        logger.writeRow(std::to_string(year), { static_cast<double>(observationCount), mean, lower, upper, secondMean,
+            update.effectiveSampleSize, update.resampled ? 1.0 : 0.0, update.logLikelihood, updateTime.count() });
+    }
 
-    //dS/dt = ηqnE - δS
-    double dS_dt = fishingindustry.getCatchStockingRate() * currentCatch - fishingindustry.getStockReturnRate() * S;
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+    std::string likelihoodString = "Marginal log-likelihood of the observations: " + std::to_string(totalLogLikelihood);
+    std::string slowestString = "Slowest update (ms): " + std::to_string(slowestUpdate);
+    std::string durationString = "Simulation duration (ms): " + std::to_string(duration.count());
+    printf("%s\n", likelihoodString.c_str());
+    printf("%s\n", slowestString.c_str());
+    printf("%s\n", durationString.c_str());
 
-    //update the state variables using a simple forward Euler step (assuming Δt = 1).
-    fishery.setFishStock(std::max(0.0, n + dn_dt * timeStep));
-    fishingindustry.setHarvestingEffort(std::max(0.0, E + dE_dt * timeStep));
-    fishingindustry.setFishMarketStock(std::max(0.0, S + dS_dt * timeStep));
+    logger.writeComment("");
+    logger.writeComment(likelihoodString);
+    logger.writeComment(slowestString);
+    logger.writeComment(durationString);
+    logger.close();
 
-    return;
+    std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
+    return 0;
 }
 
 /**
- * @brief Simulates one year step of the Age-Structured Model.
- * @param fishery The fishery object (contains state and bio params).
- * @param industry The industry object (contains fishing params).
- * @return The total catch in biomass for the year.
+ * @brief Enables the timeline trace from the optional "tracing" section (see Tracing.h).
+ * @return True if tracing is off or was enabled, false if the section is invalid.
  */
-double AgeStructuredModelStep(Fishery& fishery, const FishingIndustry& industry) 
+bool loadTracing(const json& params)
 {
-    int maxAge = fishery.getMaxAge();
-    std::vector<double> N_start = fishery.getNumbersAtAge(); //numbers at start of year
-    std::vector<double> N_end(maxAge + 1); //numbers at end of year
-    double totalCatchBiomass = 0.0;
-    double M = fishery.getNaturalMortality();
-    double F_max = industry.getFishingMortality();
+    if (!params.contains("tracing")) return true;
 
-    // Loop from age 1 to maxAge - 1
-    for (int age = 1; age < maxAge; ++age) 
+    try
     {
-        double sel = industry.getSelectivityAtAge(age - 1); //selectivity of the cohort from the previous age
-        double F = F_max * sel;
-        double Z = M + F; //total mortality
-        N_end[age] = N_start[age - 1] * std::exp(-Z);
-
-        //baranov catch equation (biomass)
-        totalCatchBiomass += (F / Z) * (1.0 - std::exp(-Z)) * N_start[age - 1] * fishery.getWeightAtAge(age - 1);
+        auto tracingParams = params.at("tracing");
+        if (!tracingParams.at("enabled").get<bool>()) return true;
+        TraceRecorder::shared().enable(tracingParams.at("traceFile").get<std::string>(), tracingParams.at("maxEventsPerThread").get<std::size_t>());
     }
-
-    //handle the plus group (age maxAge)
-    double sel_recruit = industry.getSelectivityAtAge(maxAge - 1);
-    double F_recruit = F_max * sel_recruit;
-    double Z_recruit = M + F_recruit;
-    double recruits_to_plus_group = N_start[maxAge - 1] * std::exp(-Z_recruit);
-
-    double sel_plus = industry.getSelectivityAtAge(maxAge);
-    double F_plus = F_max * sel_plus;
-    double Z_plus = M + F_plus;
-    double survivors_from_plus_group = N_start[maxAge] * std::exp(-Z_plus);
-
-    //total fish in maxAge
-    N_end[maxAge] = recruits_to_plus_group + survivors_from_plus_group;
-
-    totalCatchBiomass += (F_recruit / Z_recruit) * (1.0 - std::exp(-Z_recruit)) * N_start[maxAge - 1] * fishery.getWeightAtAge(maxAge - 1);
-    totalCatchBiomass += (F_plus / Z_plus) * (1.0 - std::exp(-Z_plus)) * N_start[maxAge] * fishery.getWeightAtAge(maxAge);
-
-    //fish reproduction (new log-normal noisy recruitment)
-    N_end[0] = fishery.getNoisyRecruitment();
-    fishery.setNumbersAtAge(N_end);
-
-    return totalCatchBiomass;
+    catch (json::exception& e)
+    {
+        std::cout << "Error: Invalid tracing parameter in JSON file:\n" << e.what() << std::endl;
+        return false;
+    }
+    return true;
 }
 
+#ifndef FISHERY_ENV_LIBRARY
 int main()
 {
     int choice = 0;
     const std::string paramFilename = "parameters.json";
     json params;
 
+    //the trace times start here
+    TraceRecorder& recorder = TraceRecorder::shared();
+    TraceRecorder::Clock::time_point loadBegin = TraceRecorder::Clock::now();
+
     std::ifstream f(paramFilename);
     if (!f.is_open()) 
     {
@@ -311,19 +5315,43 @@ int main()
         return 1;
     }
 
-    while (choice != 1 && choice != 2 && choice != 3)
+    //the parameters are only known to enable tracing once they are loaded, so their load is recorded afterwards
+    if (!loadTracing(params)) return 1;
+    TraceOutput traceOutput;
+    recorder.setThreadName("Main");
+    recorder.record("LoadParameters", "io", loadBegin);
+
+    const int menuOptionCount = 20;
+    while (choice < 1 || choice > menuOptionCount)
     {
         //ask the user which model to use
         std::cout << "Select a fishery simulation model:" << std::endl;
         std::cout << "1. Simple Logistic Model" << std::endl;
         std::cout << "2. Delay Equation Model" << std::endl;
         std::cout << "3. Age-Structured Model" << std::endl;
-        std::cout << "Enter your choice (1, 2, or 3): ";
+        std::cout << "4. Global Sensitivity Analysis (Sobol)" << std::endl;
+        std::cout << "5. Age-Structured Model Gradients (Automatic Differentiation)" << std::endl;
+        std::cout << "6. Model Fitting (Maximum Likelihood)" << std::endl;
+        std::cout << "7. Ensemble Simulation (Streaming Statistics)" << std::endl;
+        std::cout << "8. Equilibrium Analysis (Leslie Matrix)" << std::endl;
+        std::cout << "9. Seasonal Age-Structured Model" << std::endl;
+        std::cout << "10. Length-Structured Model" << std::endl;
+        std::cout << "11. Individual-Based Model" << std::endl;
+        std::cout << "12. Multi-Fleet Age-Structured Model" << std::endl;
+        std::cout << "13. Adaptive Ensemble (Target Precision)" << std::endl;
+        std::cout << "14. Rare-Event Collapse Probability (Multilevel Splitting)" << std::endl;
+        std::cout << "15. Regression Check (Golden Outputs)" << std::endl;
+        std::cout << "16. Batched Environment (C Interface Benchmark)" << std::endl;
+        std::cout << "17. Harvest Policy (Stochastic Dynamic Programming)" << std::endl;
+        std::cout << "18. Multi-Species Predator-Prey Model" << std::endl;
+        std::cout << "19. Spatial Model (Diffusion Grid)" << std::endl;
+        std::cout << "20. Particle Filter (Streaming Stock Assessment)" << std::endl;
+        std::cout << "Enter your choice (1-" << menuOptionCount << "): ";
         std::cin >> choice;
 
-        if (std::cin.fail() || (choice != 1 && choice != 2 && choice != 3))
+        if (std::cin.fail() || choice < 1 || choice > menuOptionCount)
         {
-            std::cout << "\nInvalid choice. Please enter 1, 2, or 3.\n" << std::endl;
+            std::cout << "\nInvalid choice. Please enter a number from 1 to " << menuOptionCount << ".\n" << std::endl;
             std::cin.clear(); //clear the error flag on cin.
             //discard the rest of the line to handle invalid input.
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -332,6 +5360,7 @@ int main()
     }
 
     std::cout << "\n";
+    TraceRecorder::Clock::time_point simulationBegin = TraceRecorder::Clock::now();
 
     if (choice == 1)
     {
@@ -347,6 +5376,22 @@ int main()
             return 1;
         }
 
+        EnvironmentalForcing forcing;
+        if (!loadEnvironmentalForcing(params, 1, forcing)) 
+        {
+            std::cout << "Error loading environmental forcing. Exiting." << std::endl;
+            return 1;
+        }
+        forcing = forcing.bind(myFishery);
+
+        PolicyTable policy;
+        bool usePolicy = false;
+        if (!loadHarvestPolicy(params.at("simpleModel"), "simpleModel", policy, usePolicy))
+        {
+            std::cout << "Error loading the harvest policy. Exiting." << std::endl;
+            return 1;
+        }
+
         //data logging
         std::string timestamp = getCurrentTimestamp();
         std::string filename = "simple_model_simulation_" + timestamp + ".csv";
@@ -365,12 +5410,14 @@ int main()
             logger.writeComment("  " + line);
         }
         logger.writeComment(""); 
+        logEnvironmentalForcing(logger, params, forcing);
 
         logger.writeHeader("Year,FishStock_tons");
 
         auto start = std::chrono::high_resolution_clock::now();
 
         std::cout << "--- Simple Logistic Model Simulation ---" << std::endl;
+        if (usePolicy) std::cout << "Harvest rate set each year by the policy in " << params.at("simpleModel").at("policyFile").get<std::string>() << std::endl;
         printf("Year | Fish Stock (tons)\n");
         printf("--------------------------------------\n");
         printf("%4d | %f\n", 0, myFishery.getFishStock());
@@ -379,6 +5426,12 @@ int main()
         //run the simulation loop
         for (int year = 1; year <= simulationYears; ++year) 
         {
+            forcing.apply(myFishery, year - 1);
+            if (usePolicy)
+            {
+                double stock = myFishery.getFishStock();
+                myFishingIndustry.setSimpleHarvestRate(policy.getAction(&stock));
+            }
             double growth = SimpleModelGrowthAmount(myFishery, myFishingIndustry);
             myFishery.setFishStock(std::max(0.0, myFishery.getFishStock() + growth));
             printf("%4d | %f\n", year, myFishery.getFishStock());
@@ -416,6 +5469,22 @@ int main()
             return 1;
         }
 
+        EnvironmentalForcing forcing;
+        if (!loadEnvironmentalForcing(params, 2, forcing)) 
+        {
+            std::cout << "Error loading environmental forcing. Exiting." << std::endl;
+            return 1;
+        }
+        forcing = forcing.bind(myFishery);
+
+        PolicyTable policy;
+        bool usePolicy = false;
+        if (!loadHarvestPolicy(params.at("delayModel"), "delayModel", policy, usePolicy))
+        {
+            std::cout << "Error loading the harvest policy. Exiting." << std::endl;
+            return 1;
+        }
+
         //data logging
         std::string timestamp = getCurrentTimestamp();
         std::string filename = "delay_model_simulation" + timestamp + ".csv"; // Store filename
@@ -434,11 +5503,13 @@ int main()
             logger.writeComment("  " + line);
         }
         logger.writeComment("");
+        logEnvironmentalForcing(logger, params, forcing);
         logger.writeHeader("Time_Year,Population_n,Effort_E,MarketStock_S");
 
         auto start = std::chrono::high_resolution_clock::now();
 
         std::cout << "--- Delay Equation Model Simulation ---" << std::endl;
+        if (usePolicy) std::cout << "Effort set each year by the policy in " << params.at("delayModel").at("policyFile").get<std::string>() << std::endl;
         printf("Year | Population (n) | Effort (E) | Market Stock (S)\n");
         printf("----------------------------------------------------------\n");
         printf("%4d | %14.4f | %10.4f | %16.4f\n", 0, myFishery.getFishStock(), myFishingIndustry.getHarvestingEffort(), myFishingIndustry.getFishMarketStock());
@@ -447,9 +5518,19 @@ int main()
         //run the simulation loop
         for (int year = 1; year <= simulationYears; ++year) 
         {
+            //the policy holds the effort of the year, as in the dynamic program
+            double policyEffort = 0.0;
+            if (usePolicy)
+            {
+                double state[2] = { myFishery.getFishStock(), myFishingIndustry.getFishMarketStock() };
+                policyEffort = policy.getAction(state);
+                myFishingIndustry.setHarvestingEffort(policyEffort);
+            }
             for (int i = 0; i < stepsPerYear; ++i) 
             {
+                forcing.apply(myFishery, currentTime); //interpolated between the forcing steps
                 DelayEquationModelStep(myFishery, myFishingIndustry, timeStep);
+                if (usePolicy) myFishingIndustry.setHarvestingEffort(policyEffort);
                 currentTime += timeStep;
                 logger.writeRow(currentTime, myFishery.getFishStock(), myFishingIndustry.getHarvestingEffort(), myFishingIndustry.getFishMarketStock());
             }
@@ -489,6 +5570,14 @@ int main()
             return 1;
         }
 
+        EnvironmentalForcing forcing;
+        if (!loadEnvironmentalForcing(params, 3, forcing)) 
+        {
+            std::cout << "Error loading environmental forcing. Exiting." << std::endl;
+            return 1;
+        }
+        forcing = forcing.bind(myFishery);
+
         std::string timestamp = getCurrentTimestamp();
         std::string filename = "age_structured_simulation" + timestamp + ".csv";
         CSVManager logger;
@@ -506,6 +5595,7 @@ int main()
             logger.writeComment("  " + line);
         }
         logger.writeComment("");
+        logEnvironmentalForcing(logger, params, forcing);
 
         logger.writeHeader("Year,TotalBiomass,SpawningStockBiomass,TotalCatch");
 
@@ -520,15 +5610,17 @@ int main()
         printf("%4d | %15.2f | %18.2f | %20.2f\n", 0, initialTotalBiomass, initialSSB, 0.0);
         logger.writeRow(0, initialTotalBiomass, initialSSB, 0.0);
 
+        //the step and the biomass, SSB and catch reductions in one sweep over ages, from tabulated rates
+        AgeModelTables<double> tables(getAgeModelParameters(myFishery, myFishingIndustry));
+        double ssb = initialSSB;
         for (int year = 1; year <= simulationYears; ++year) 
         {
-            double totalCatch = AgeStructuredModelStep(myFishery, myFishingIndustry);
+            forcing.apply(myFishery, year - 1);
+            AgeStepTotals<double> totals = AgeStructuredModelStep(myFishery, myFishingIndustry, tables, ssb);
+            ssb = totals.spawningStockBiomass;
 
-            double totalBiomass = myFishery.getTotalBiomass();
-            double ssb = myFishery.getSpawningStockBiomass();
-
-            printf("%4d | %15.2f | %18.2f | %20.2f\n", year, totalBiomass, ssb, totalCatch);
-            logger.writeRow(year, totalBiomass, ssb, totalCatch);
+            printf("%4d | %15.2f | %18.2f | %20.2f\n", year, totals.totalBiomass, ssb, totals.catchBiomass);
+            logger.writeRow(year, totals.totalBiomass, ssb, totals.catchBiomass);
         }
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double, std::milli> duration = end - start;
@@ -543,6 +5635,161 @@ int main()
 
         std::cout << "\nSimulation results saved to:\n" << getCurrentWorkingDirectory() << "/" << filename << std::endl;
     }
+    else if (choice == 4)
+    {
+        // --- Global Sensitivity Analysis ---
+        if (runSensitivityAnalysis(params) != 0)
+        {
+            std::cout << "Error running the sensitivity analysis. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 5)
+    {
+        // --- Age-Structured Model Gradients ---
+        if (runAgeModelGradients(params) != 0)
+        {
+            return 1;
+        }
+    }
+    else if (choice == 6)
+    {
+        // --- Model Fitting ---
+        if (runModelFitting(params) != 0)
+        {
+            std::cout << "Error running the model fit. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 7)
+    {
+        // --- Ensemble Simulation ---
+        if (runEnsemble(params) != 0)
+        {
+            std::cout << "Error running the ensemble. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 8)
+    {
+        // --- Equilibrium Analysis ---
+        if (runEquilibriumAnalysis(params) != 0)
+        {
+            std::cout << "Error running the equilibrium analysis. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 9)
+    {
+        // --- Seasonal Age-Structured Model ---
+        if (runSeasonalAgeModel(params) != 0)
+        {
+            std::cout << "Error running the seasonal age-structured model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 10)
+    {
+        // --- Length-Structured Model ---
+        if (runLengthStructuredModel(params) != 0)
+        {
+            std::cout << "Error running the length-structured model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 11)
+    {
+        // --- Individual-Based Model ---
+        if (runIndividualBasedModel(params) != 0)
+        {
+            std::cout << "Error running the individual-based model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 12)
+    {
+        // --- Multi-Fleet Age-Structured Model ---
+        if (runMultiFleetModel(params) != 0)
+        {
+            std::cout << "Error running the multi-fleet model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 13)
+    {
+        // --- Adaptive Ensemble ---
+        if (runAdaptiveEnsemble(params) != 0)
+        {
+            std::cout << "Error running the adaptive ensemble. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 14)
+    {
+        // --- Rare-Event Collapse Probability ---
+        if (runCollapseProbability(params) != 0)
+        {
+            std::cout << "Error running the collapse probability estimate. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 15)
+    {
+        // --- Regression Check ---
+        if (runRegressionCheck(params) != 0)
+        {
+            std::cout << "Regression check failed. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 16)
+    {
+        // --- Batched Environment ---
+        if (runBatchedEnvironment(params) != 0)
+        {
+            std::cout << "Error running the batched environment. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 17)
+    {
+        // --- Harvest Policy ---
+        if (runHarvestPolicy(params) != 0)
+        {
+            std::cout << "Error computing the harvest policy. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 18)
+    {
+        // --- Multi-Species Model ---
+        if (runMultiSpeciesModel(params) != 0)
+        {
+            std::cout << "Error running the multi-species model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 19)
+    {
+        // --- Spatial Model ---
+        if (runSpatialModel(params) != 0)
+        {
+            std::cout << "Error running the spatial model. Exiting." << std::endl;
+            return 1;
+        }
+    }
+    else if (choice == 20)
+    {
+        // --- Particle Filter ---
+        if (runParticleFilter(params) != 0)
+        {
+            std::cout << "Error running the particle filter. Exiting." << std::endl;
+            return 1;
+        }
+    }
+
+    recorder.record("Simulation", "simulation", simulationBegin, "choice", choice);
+    traceOutput.write();
 
     std::cout << "\nSimulation finished. Press Enter to exit." << std::endl;
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -550,4 +5797,5 @@ int main()
 
     //exit the program
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,4 +1,32 @@
 #pragma once
+
+#include <string>
+#include <vector>
+#include "AgeStructuredModel.h"
+
+/**
+ * @brief One fleet of the multi-fleet age-structured model, with its own gear and economics.
+ */
+struct FishingFleet
+{
+	std::string name;
+
+	//fishing effort of the fleet; its fishing mortality is catchability * effort
+	double effort = 1.0;
+	double catchability = 0.0;
+
+	//logistic selectivity of the fleet's gear
+	double selectivity_A50 = 0.0;
+	double selectivity_k = 0.0;
+
+	//price per unit of catch biomass and cost per unit of effort
+	double price = 0.0;
+	double costPerEffort = 0.0;
+
+	double getFishingMortality() const { return catchability * effort; }
+	double getSelectivityAtAge(int age) const { return getLogisticAtAge(age, selectivity_A50, selectivity_k); }
+};
+
 class FishingIndustry
 {
 public:
@@ -60,10 +88,16 @@ public:
 	 */
 	double getSelectivityAtAge(int age) const
 	{
-		return 1.0 / (1.0 + std::exp(-selectivity_k * (age - selectivity_A50)));
+		return getLogisticAtAge(age, selectivity_A50, selectivity_k);
 	}
 
 	double getFishingMortality() const { return fishingMortality; }
+	double getSelectivityA50() const { return selectivity_A50; }
+	double getSelectivityK() const { return selectivity_k; }
+
+	//fleets of the multi-fleet age-structured model
+	const std::vector<FishingFleet>& getFleets() const { return fleets; }
+	void setFleets(const std::vector<FishingFleet>& newFleets) { fleets = newFleets; }
 
 private:
 
@@ -106,5 +140,10 @@ private:
 	//specificially, a high k means the fishing gear sharply goes from catching no fish at lower ages to catching
 	//all fish at the A_50 age
 	double selectivity_k;
+
+	//Multi-Fleet Model Variables
+
+	//the fleets sharing the fishery, each with its own selectivity, effort, price and cost
+	std::vector<FishingFleet> fleets;
 };
 
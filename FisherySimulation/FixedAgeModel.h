@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include "AgeStructuredModel.h"
+
+/**
+ * @class FixedAgeModel
+ * @brief The age-structured model specialized for a maximum age known at compile time.
+ * The numbers at age live in a std::array, and every loop over ages has a constexpr trip count, so for the
+ * small age ranges of short-lived stocks (maxAge 5, 10, 20) the compiler unrolls the step and the biomass
+ * reductions completely, with no heap storage, copies or bounds checks.
+ *
+ * The weight, maturity and selectivity at age are tabulated once. The survival e^-Z and the catch factor
+ * (F / Z)(1 - e^-Z) are cached for the current natural and fishing mortality and only recomputed when one of
+ * them changes (e.g. by environmental forcing). With T = double the step gives the same results as
+ * AgeStructuredModelStep, and the reductions the same as Fishery::getTotalBiomass and getSpawningStockBiomass.
+ * @tparam MaxAge The plus group age.
+ * @tparam T The scalar type of the state (double or float).
+ */
+template <int MaxAge, typename T = double>
+class FixedAgeModel
+{
+public:
+    static constexpr int ages = MaxAge + 1;
+    using AgeArray = std::array<T, MaxAge + 1>;
+
+    /**
+     * @param params The age-structured model parameters; params.maxAge must equal MaxAge.
+     */
+    explicit FixedAgeModel(const AgeModelParameters<T>& params)
+    {
+        for (int age = 0; age < ages; ++age)
+        {
+            weightAtAge[age] = getWeightAtAge(age, params);
+            maturityAtAge[age] = getMaturityAtAge(age, params);
+            selectivityAtAge[age] = getSelectivityAtAge(age, params);
+        }
+        updateMortality(params.naturalMortality, params.fishingMortality);
+    }
+
+    /**
+     * @brief Sets the natural and fishing mortality of the next steps, recomputing the cached tables if they changed.
+     */
+    void setMortality(const T& naturalMortality, const T& fishingMortality)
+    {
+        if (naturalMortality != currentNaturalMortality || fishingMortality != currentFishingMortality)
+        {
+            updateMortality(naturalMortality, fishingMortality);
+        }
+    }
+
+    /**
+     * @brief Simulates one year step in place: cohorts age with the Baranov survival, the plus group accumulates,
+     * and the recruits enter at age 0. The biomass, SSB and catch are reduced in the same sweep over ages
+     * (see stepFusedAgeModel); inlined with the constant MaxAge, the loops are unrolled.
+     */
+    AgeStepTotals<T> stepFused(AgeArray& numbersAtAge, const T& recruitment) const
+    {
+        return stepFusedAgeModel(numbersAtAge.data(), MaxAge, survival.data(), catchFactor.data(), weightAtAge.data(), maturityAtAge.data(), recruitment);
+    }
+
+    /**
+     * @brief Calculates the total biomass (sum of N[age] * W[age]).
+     */
+    T getTotalBiomass(const AgeArray& numbersAtAge) const
+    {
+        T totalBiomass = T(0.0);
+        for (int age = 0; age < ages; ++age)
+        {
+            totalBiomass += numbersAtAge[age] * weightAtAge[age];
+        }
+        return totalBiomass;
+    }
+
+    /**
+     * @brief Calculates the spawning stock biomass (sum of N[age] * W[age] * M[age]).
+     */
+    T getSpawningStockBiomass(const AgeArray& numbersAtAge) const
+    {
+        T ssb = T(0.0);
+        for (int age = 0; age < ages; ++age)
+        {
+            ssb += numbersAtAge[age] * weightAtAge[age] * maturityAtAge[age];
+        }
+        return ssb;
+    }
+
+private:
+    void updateMortality(const T& naturalMortality, const T& fishingMortality)
+    {
+        using std::exp;
+        currentNaturalMortality = naturalMortality;
+        currentFishingMortality = fishingMortality;
+        for (int age = 0; age < ages; ++age)
+        {
+            T F = fishingMortality * selectivityAtAge[age];
+            T Z = naturalMortality + F;
+            survival[age] = exp(-Z);
+            catchFactor[age] = (F / Z) * (1.0 - exp(-Z));
+        }
+    }
+
+    AgeArray weightAtAge;
+    AgeArray maturityAtAge;
+    AgeArray selectivityAtAge;
+    AgeArray survival;
+    AgeArray catchFactor;
+    T currentNaturalMortality;
+    T currentFishingMortality;
+};
@@ -0,0 +1,484 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief Computes the Gauss-Hermite rule for the expectation over a standard normal variable,
+ * E[f(Z)] ~ sum weights[i] * f(nodes[i]), exact for polynomials up to degree 2 * points - 1.
+ * The roots of the Hermite polynomials are found by Newton's method from the usual asymptotic guesses.
+ */
+inline void getGaussHermiteRule(std::size_t points, std::vector<double>& outNodes, std::vector<double>& outWeights)
+{
+    const double pi = 3.14159265358979323846;
+    outNodes.assign(points, 0.0);
+    outWeights.assign(points, 0.0);
+    int n = static_cast<int>(points);
+    double z = 0.0;
+    for (int i = 0; i < (n + 1) / 2; ++i)
+    {
+        //initial guesses for the roots of H_n, from the largest down
+        if (i == 0) z = std::sqrt(2.0 * n + 1.0) - 1.85575 * std::pow(2.0 * n + 1.0, -0.16667);
+        else if (i == 1) z -= 1.14 * std::pow(static_cast<double>(n), 0.426) / z;
+        else if (i == 2) z = 1.86 * z - 0.86 * outNodes[0];
+        else if (i == 3) z = 1.91 * z - 0.91 * outNodes[1];
+        else z = 2.0 * z - outNodes[i - 2];
+
+        //Newton iterations on the orthonormal Hermite recurrence
+        double derivative = 0.0;
+        for (int iteration = 0; iteration < 100; ++iteration)
+        {
+            double p1 = 1.0 / std::pow(pi, 0.25);
+            double p2 = 0.0;
+            for (int j = 1; j <= n; ++j)
+            {
+                double p3 = p2;
+                p2 = p1;
+                p1 = z * std::sqrt(2.0 / j) * p2 - std::sqrt((j - 1.0) / j) * p3;
+            }
+            derivative = std::sqrt(2.0 * n) * p2;
+            double previous = z;
+            z = previous - p1 / derivative;
+            if (std::fabs(z - previous) <= 1e-14) break;
+        }
+        outNodes[i] = z;
+        outNodes[n - 1 - i] = -z;
+        outWeights[i] = 2.0 / (derivative * derivative);
+        outWeights[n - 1 - i] = outWeights[i];
+    }
+
+    //from the weight e^-x^2 to the standard normal density
+    for (int i = 0; i < n; ++i)
+    {
+        outNodes[i] *= std::sqrt(2.0);
+        outWeights[i] /= std::sqrt(pi);
+    }
+}
+
+/**
+ * @brief A uniformly spaced axis of a state grid.
+ */
+struct PolicyAxis
+{
+    std::string name;
+    double lower = 0.0;
+    double upper = 1.0;
+    std::size_t points = 2;
+
+    double getValue(std::size_t index) const
+    {
+        return lower + (upper - lower) * index / (points - 1);
+    }
+
+    /**
+     * @brief Finds the grid cell of a value, clamped to the axis, and its linear interpolation weight.
+     * @param outIndex (Output) The lower grid point of the cell.
+     * @param outWeight (Output) The weight of the upper grid point.
+     */
+    void locate(double value, std::size_t& outIndex, double& outWeight) const
+    {
+        double position = (value - lower) / (upper - lower) * (points - 1);
+        position = std::min(std::max(position, 0.0), static_cast<double>(points - 1));
+        outIndex = std::min(static_cast<std::size_t>(position), points - 2);
+        outWeight = position - outIndex;
+    }
+};
+
+/**
+ * @class PolicyTable
+ * @brief A harvest policy on a grid of model states: the action (harvest rate or effort) and the value of every
+ * grid point, with the actions in between interpolated multilinearly. States outside the grid use its edge.
+ * Grid points are stored row-major, the last axis varying fastest.
+ */
+class PolicyTable
+{
+public:
+    std::string modelName;
+    std::string actionName;
+    std::vector<PolicyAxis> axes;
+    std::vector<double> actions;
+    std::vector<double> values;
+
+    std::size_t getStateCount() const
+    {
+        std::size_t count = 1;
+        for (const PolicyAxis& axis : axes) count *= axis.points;
+        return count;
+    }
+
+    /**
+     * @brief The coordinates of a grid point.
+     */
+    void getState(std::size_t index, double* outState) const
+    {
+        for (std::size_t d = axes.size(); d-- > 0;)
+        {
+            outState[d] = axes[d].getValue(index % axes[d].points);
+            index /= axes[d].points;
+        }
+    }
+
+    /**
+     * @brief Finds the grid points around a state and their multilinear weights (2^axes of them).
+     * @return The number of corners written.
+     */
+    std::size_t getStencil(const double* state, std::size_t* outIndices, double* outWeights) const
+    {
+        std::size_t corners = std::size_t(1) << axes.size();
+        for (std::size_t corner = 0; corner < corners; ++corner)
+        {
+            outIndices[corner] = 0;
+            outWeights[corner] = 1.0;
+        }
+        for (std::size_t d = 0; d < axes.size(); ++d)
+        {
+            std::size_t index = 0;
+            double weight = 0.0;
+            axes[d].locate(state[d], index, weight);
+            for (std::size_t corner = 0; corner < corners; ++corner)
+            {
+                bool upper = ((corner >> d) & 1) != 0;
+                outIndices[corner] = outIndices[corner] * axes[d].points + index + (upper ? 1 : 0);
+                outWeights[corner] *= upper ? weight : 1.0 - weight;
+            }
+        }
+        return corners;
+    }
+
+    /**
+     * @brief The policy action at a state, interpolated between the grid points.
+     */
+    double getAction(const double* state) const
+    {
+        return interpolate(actions, state);
+    }
+
+    /**
+     * @brief The expected discounted profit of following the policy from a state, interpolated between the grid points.
+     */
+    double getValue(const double* state) const
+    {
+        return interpolate(values, state);
+    }
+
+    /**
+     * @brief Writes the policy as a CSV table: "Model", "Axis" and "Action" lines, then one row per grid point
+     * with its state, action and value. Values are printed with 17 significant digits to round-trip exactly.
+     * @return True if the file was written.
+     */
+    bool save(const std::string& filename) const
+    {
+        std::ofstream file(filename, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Error: Could not open policy file for writing: " << filename << std::endl;
+            return false;
+        }
+
+        file << "# Harvest policy table (harvestPolicy in parameters.json), read by the " << modelName << " through its \"policyFile\"\n";
+        file << std::setprecision(17);
+        file << "Model," << modelName << "\n";
+        for (const PolicyAxis& axis : axes)
+        {
+            file << "Axis," << axis.name << "," << axis.lower << "," << axis.upper << "," << axis.points << "\n";
+        }
+        file << "Action," << actionName << "\n";
+        for (const PolicyAxis& axis : axes) file << axis.name << ",";
+        file << actionName << ",Value\n";
+
+        std::vector<double> state(axes.size());
+        for (std::size_t index = 0; index < actions.size(); ++index)
+        {
+            getState(index, state.data());
+            for (double coordinate : state) file << coordinate << ",";
+            file << actions[index] << "," << values[index] << "\n";
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads a policy written by save. Lines starting with '#' are comments.
+     * @return True if the file was read and its rows match its grid.
+     */
+    bool load(const std::string& filename)
+    {
+        std::ifstream file(filename);
+        if (!file.is_open())
+        {
+            std::cout << "Error: Could not open policy file: " << filename << std::endl;
+            return false;
+        }
+
+        axes.clear();
+        actions.clear();
+        values.clear();
+        std::string line;
+        bool headerRead = false;
+        try
+        {
+            while (std::getline(file, line))
+            {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.empty() || line[0] == '#') continue;
+
+                std::stringstream ss(line);
+                std::string cell;
+                std::getline(ss, cell, ',');
+                if (cell == "Model")
+                {
+                    std::getline(ss, modelName);
+                }
+                else if (cell == "Axis")
+                {
+                    PolicyAxis axis;
+                    std::getline(ss, axis.name, ',');
+                    std::getline(ss, cell, ',');
+                    axis.lower = std::stod(cell);
+                    std::getline(ss, cell, ',');
+                    axis.upper = std::stod(cell);
+                    std::getline(ss, cell, ',');
+                    axis.points = std::stoul(cell);
+                    if (axis.points < 2 || !(axis.upper > axis.lower)) throw std::invalid_argument("invalid axis " + axis.name);
+                    axes.push_back(axis);
+                }
+                else if (cell == "Action")
+                {
+                    std::getline(ss, actionName);
+                }
+                else if (!headerRead)
+                {
+                    //the column names
+                    headerRead = true;
+                }
+                else
+                {
+                    std::vector<double> row;
+                    row.push_back(std::strtod(cell.c_str(), nullptr));
+                    while (std::getline(ss, cell, ',')) row.push_back(std::strtod(cell.c_str(), nullptr));
+                    if (row.size() != axes.size() + 2) throw std::invalid_argument("row with " + std::to_string(row.size()) + " columns");
+                    actions.push_back(row[axes.size()]);
+                    values.push_back(row[axes.size() + 1]);
+                }
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cout << "Error: Invalid policy file " << filename << " (" << e.what() << ")." << std::endl;
+            return false;
+        }
+
+        if (axes.empty() || (std::size_t(1) << axes.size()) > maxCorners || actions.size() != getStateCount())
+        {
+            std::cout << "Error: The policy file " << filename << " does not hold one row per grid point." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //the interpolation supports grids of up to 4 dimensions
+    static constexpr std::size_t maxCorners = 16;
+
+private:
+    double interpolate(const std::vector<double>& gridValues, const double* state) const
+    {
+        std::size_t indices[maxCorners];
+        double weights[maxCorners];
+        std::size_t corners = getStencil(state, indices, weights);
+        double value = 0.0;
+        for (std::size_t corner = 0; corner < corners; ++corner) value += weights[corner] * gridValues[indices[corner]];
+        return value;
+    }
+};
+
+/**
+ * @brief Settings of a stochastic dynamic programming solve.
+ */
+struct DynamicProgramSettings
+{
+    //the candidate actions, uniformly spaced in [actionLower, actionUpper]
+    double actionLower = 0.0;
+    double actionUpper = 1.0;
+    std::size_t actionPoints = 51;
+
+    //the yearly discount factor of future profits, 1 / (1 + discount rate)
+    double discountFactor = 0.95;
+
+    //the Gauss-Hermite nodes of the expectation over the noise
+    std::size_t quadraturePoints = 7;
+
+    //value iteration stops when the largest change is below tolerance * max(1, largest value)
+    double tolerance = 1e-8;
+    std::size_t maxIterations = 2000;
+
+    //the number of grid points in a tile processed by one task
+    std::size_t tileSize = 64;
+};
+
+/**
+ * @brief The convergence of a stochastic dynamic programming solve.
+ */
+struct DynamicProgramResult
+{
+    std::size_t iterations = 0;
+
+    //the largest change of the values in each iteration
+    std::vector<double> residuals;
+
+    bool converged = false;
+};
+
+/**
+ * @class StochasticDynamicProgram
+ * @brief Finds the policy maximizing the expected discounted profit of a model on a grid of states, by value
+ * iteration: V(s) = max over actions a of E[profit(s, a, Z) + discount * V(next(s, a, Z))], with Z a standard
+ * normal noise integrated by Gauss-Hermite quadrature and V interpolated multilinearly between grid points.
+ *
+ * The model is only stepped once per state, action and quadrature node: the expected profit of every state and
+ * action, and the interpolation stencils of their next states (merged with the quadrature weights), are
+ * tabulated first, so each iteration is a gather over the tabulated stencils. Both the tabulation and the
+ * iterations are processed in parallel tiles of grid points; every tile writes only its own values, and an
+ * iteration reads the values of the previous one, so the result does not depend on the thread count.
+ */
+class StochasticDynamicProgram
+{
+public:
+    /**
+     * @brief Steps the model by one period from a state with an action and a standard normal noise draw.
+     * Must be safe to call concurrently.
+     * @param outNextState (Output) The state after the period.
+     * @return The profit of the period.
+     */
+    using Transition = std::function<double(const double* state, double action, double noise, double* outNextState)>;
+
+    explicit StochasticDynamicProgram(const DynamicProgramSettings& settings)
+        : settings(settings)
+    {
+    }
+
+    /**
+     * @brief Solves for the optimal policy on the grid of the table, filling its actions and values.
+     */
+    DynamicProgramResult solve(PolicyTable& table, const Transition& transition, ThreadPool& pool) const
+    {
+        DynamicProgramResult result;
+        std::size_t states = table.getStateCount();
+        std::size_t actionCount = settings.actionPoints;
+        std::size_t dimensions = table.axes.size();
+        std::size_t corners = std::size_t(1) << dimensions;
+
+        std::vector<double> nodes;
+        std::vector<double> weights;
+        getGaussHermiteRule(settings.quadraturePoints, nodes, weights);
+        std::size_t entries = nodes.size() * corners;
+
+        PolicyAxis actionAxis;
+        actionAxis.lower = settings.actionLower;
+        actionAxis.upper = settings.actionUpper;
+        actionAxis.points = actionCount;
+
+        //tabulate the expected profits and the next state stencils of every state and action
+        std::vector<double> expectedProfits(states * actionCount, 0.0);
+        std::vector<std::uint32_t> stencilIndices(states * actionCount * entries);
+        std::vector<double> stencilWeights(states * actionCount * entries);
+        std::size_t tiles = (states + settings.tileSize - 1) / settings.tileSize;
+        pool.parallelFor(tiles, [&](std::size_t tile)
+        {
+            std::vector<double> state(dimensions);
+            std::vector<double> nextState(dimensions);
+            std::size_t cornerIndices[PolicyTable::maxCorners];
+            double cornerWeights[PolicyTable::maxCorners];
+            std::size_t end = std::min(states, (tile + 1) * settings.tileSize);
+            for (std::size_t s = tile * settings.tileSize; s < end; ++s)
+            {
+                table.getState(s, state.data());
+                for (std::size_t a = 0; a < actionCount; ++a)
+                {
+                    std::size_t row = s * actionCount + a;
+                    double action = actionAxis.getValue(a);
+                    double profit = 0.0;
+                    for (std::size_t k = 0; k < nodes.size(); ++k)
+                    {
+                        profit += weights[k] * transition(state.data(), action, nodes[k], nextState.data());
+                        table.getStencil(nextState.data(), cornerIndices, cornerWeights);
+                        for (std::size_t corner = 0; corner < corners; ++corner)
+                        {
+                            stencilIndices[row * entries + k * corners + corner] = static_cast<std::uint32_t>(cornerIndices[corner]);
+                            stencilWeights[row * entries + k * corners + corner] = weights[k] * cornerWeights[corner];
+                        }
+                    }
+                    expectedProfits[row] = profit;
+                }
+            }
+        });
+
+        //value iteration
+        std::vector<double> values(states, 0.0);
+        std::vector<double> nextValues(states, 0.0);
+        std::vector<std::size_t> bestActions(states, 0);
+        std::vector<double> tileChanges(tiles, 0.0);
+        for (std::size_t iteration = 0; iteration < settings.maxIterations; ++iteration)
+        {
+            pool.parallelFor(tiles, [&](std::size_t tile)
+            {
+                double largestChange = 0.0;
+                std::size_t end = std::min(states, (tile + 1) * settings.tileSize);
+                for (std::size_t s = tile * settings.tileSize; s < end; ++s)
+                {
+                    double best = -std::numeric_limits<double>::infinity();
+                    std::size_t bestAction = 0;
+                    for (std::size_t a = 0; a < actionCount; ++a)
+                    {
+                        std::size_t row = s * actionCount + a;
+                        const std::uint32_t* indices = &stencilIndices[row * entries];
+                        const double* stencil = &stencilWeights[row * entries];
+                        double continuation = 0.0;
+                        for (std::size_t e = 0; e < entries; ++e) continuation += stencil[e] * values[indices[e]];
+                        double value = expectedProfits[row] + settings.discountFactor * continuation;
+                        if (value > best)
+                        {
+                            best = value;
+                            bestAction = a;
+                        }
+                    }
+                    nextValues[s] = best;
+                    bestActions[s] = bestAction;
+                    largestChange = std::max(largestChange, std::fabs(best - values[s]));
+                }
+                tileChanges[tile] = largestChange;
+            });
+            values.swap(nextValues);
+
+            double residual = *std::max_element(tileChanges.begin(), tileChanges.end());
+            double scale = 1.0;
+            for (double value : values) scale = std::max(scale, std::fabs(value));
+            result.residuals.push_back(residual);
+            result.iterations = iteration + 1;
+            if (residual <= settings.tolerance * scale)
+            {
+                result.converged = true;
+                break;
+            }
+        }
+
+        table.values = values;
+        table.actions.resize(states);
+        for (std::size_t s = 0; s < states; ++s) table.actions[s] = actionAxis.getValue(bestActions[s]);
+        return result;
+    }
+
+private:
+    DynamicProgramSettings settings;
+};
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "AgeStructuredModel.h"
+#include "ThreadPool.h"
+
+/**
+ * @class FishArena
+ * @brief Structure-of-arrays storage for the individual fish of the individual-based model.
+ * Every field is a separate contiguous array indexed by fish, so each pass only streams the fields it uses.
+ * Births are appended in bulk, and deaths are removed in bulk by compact(), which keeps the order of the
+ * survivors and never reallocates.
+ */
+class FishArena
+{
+public:
+    std::vector<std::uint16_t> age;
+    std::vector<std::uint8_t> mature;
+    std::vector<float> length;
+    std::vector<float> asymptoticLength;
+    std::vector<float> weight;
+
+    std::size_t size() const { return age.size(); }
+
+    void reserve(std::size_t capacity)
+    {
+        age.reserve(capacity);
+        mature.reserve(capacity);
+        length.reserve(capacity);
+        asymptoticLength.reserve(capacity);
+        weight.reserve(capacity);
+    }
+
+    /**
+     * @brief Adds count fish with unset fields at the end of the arena.
+     * @return The index of the first new fish.
+     */
+    std::size_t append(std::size_t count)
+    {
+        std::size_t first = size();
+        resize(first + count);
+        return first;
+    }
+
+    /**
+     * @brief Removes every fish whose alive flag is 0.
+     * Each chunk of chunkSize fish is compacted in place in parallel, then the surviving blocks are moved
+     * down next to each other in order.
+     */
+    void compact(const std::vector<std::uint8_t>& alive, std::size_t chunkSize, ThreadPool& pool)
+    {
+        std::size_t chunkCount = (size() + chunkSize - 1) / chunkSize;
+        std::vector<std::size_t> survivors(chunkCount, 0);
+
+        pool.parallelFor(chunkCount, [&](std::size_t chunk)
+        {
+            std::size_t begin = chunk * chunkSize;
+            std::size_t end = std::min(size(), begin + chunkSize);
+            std::size_t next = begin;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if (!alive[i]) continue;
+                if (next != i) moveFish(i, next);
+                ++next;
+            }
+            survivors[chunk] = next - begin;
+        });
+
+        std::size_t total = 0;
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            std::size_t begin = chunk * chunkSize;
+            if (total != begin)
+            {
+                //the destination always lies below the source, so a forward copy is safe
+                moveRange(begin, begin + survivors[chunk], total);
+            }
+            total += survivors[chunk];
+        }
+        resize(total);
+    }
+
+private:
+    void resize(std::size_t count)
+    {
+        age.resize(count);
+        mature.resize(count);
+        length.resize(count);
+        asymptoticLength.resize(count);
+        weight.resize(count);
+    }
+
+    void moveFish(std::size_t from, std::size_t to)
+    {
+        age[to] = age[from];
+        mature[to] = mature[from];
+        length[to] = length[from];
+        asymptoticLength[to] = asymptoticLength[from];
+        weight[to] = weight[from];
+    }
+
+    void moveRange(std::size_t begin, std::size_t end, std::size_t to)
+    {
+        std::copy(age.begin() + begin, age.begin() + end, age.begin() + to);
+        std::copy(mature.begin() + begin, mature.begin() + end, mature.begin() + to);
+        std::copy(length.begin() + begin, length.begin() + end, length.begin() + to);
+        std::copy(asymptoticLength.begin() + begin, asymptoticLength.begin() + end, asymptoticLength.begin() + to);
+        std::copy(weight.begin() + begin, weight.begin() + end, weight.begin() + to);
+    }
+};
+
+/**
+ * @brief Settings of the individual-based model that are not shared with the age-structured model.
+ */
+struct IndividualModelSettings
+{
+    //simulated individuals per fish of the age-structured model (outputs are divided by this scale)
+    double individualsPerFish = 1.0;
+
+    //coefficient of variation of the individual asymptotic length (0 gives every fish the mean growth curve)
+    double linfCV = 0.0;
+
+    //fish per parallel work item; every chunk draws from its own random stream
+    std::size_t chunkSize = 65536;
+
+    std::uint32_t seed = 1;
+};
+
+/**
+ * @brief The outcome of one simulated year, in the units of the age-structured model.
+ */
+struct IndividualYearSummary
+{
+    double totalCatch = 0.0;
+    std::size_t deaths = 0;
+    std::size_t captures = 0;
+    std::size_t births = 0;
+};
+
+/**
+ * @class IndividualBasedModel
+ * @brief Individual-based version of the age-structured model.
+ * Each fish carries its age, length, weight and maturity state. Every year each fish dies with probability
+ * 1 - e^-Z at its age and is caught with probability (F / Z)(1 - e^-Z), so the expected yearly outputs equal
+ * those of AgeStructuredModelStep. Survivors age, grow along their own von Bertalanffy curve and mature with
+ * the probability that keeps the mature fraction at age on the maturity ogive. The plus group does not grow,
+ * as in the age model. Random numbers come from one stream per (year, chunk), so results do not depend on
+ * the number of threads.
+ */
+class IndividualBasedModel
+{
+public:
+    IndividualBasedModel(const AgeModelParameters<double>& params, const IndividualModelSettings& settings)
+        : params(params), settings(settings)
+    {
+        if (!(settings.individualsPerFish > 0.0) || settings.linfCV < 0.0 || settings.chunkSize == 0)
+        {
+            throw std::invalid_argument("IndividualBasedModel needs a positive individualsPerFish and chunkSize and a non-negative linfCV.");
+        }
+
+        for (int age = 0; age <= params.maxAge; ++age)
+        {
+            double F = params.fishingMortality * getSelectivityAtAge(age, params);
+            double Z = params.naturalMortality + F;
+            double deathProbability = 1.0 - std::exp(-Z);
+            deathProbabilityAtAge.push_back(deathProbability);
+            captureProbabilityAtAge.push_back((Z > 0.0) ? (F / Z) * deathProbability : 0.0);
+            maturityAtAge.push_back(getMaturityAtAge(age, params));
+            lengthFractionAtAge.push_back(std::max(0.0, 1.0 - std::exp(-params.vb_k * (age - params.vb_t0))));
+            meanWeightAtAge.push_back(params.lw_a * std::pow(params.vb_Linf * lengthFractionAtAge.back(), params.lw_b));
+        }
+
+        //every fish stays on its own von Bertalanffy curve, so growth by one year scales length and weight by fixed ratios
+        lengthRatioAtAge.assign(params.maxAge + 1, 1.0);
+        weightRatioAtAge.assign(params.maxAge + 1, 1.0);
+        for (int age = 1; age <= params.maxAge; ++age)
+        {
+            if (lengthFractionAtAge[age - 1] > 0.0) lengthRatioAtAge[age] = lengthFractionAtAge[age] / lengthFractionAtAge[age - 1];
+            if (meanWeightAtAge[age - 1] > 0.0) weightRatioAtAge[age] = meanWeightAtAge[age] / meanWeightAtAge[age - 1];
+        }
+
+        //probability that an immature fish matures when it reaches each age
+        maturationProbabilityAtAge.assign(params.maxAge + 1, 0.0);
+        for (int age = 1; age <= params.maxAge; ++age)
+        {
+            double immature = 1.0 - maturityAtAge[age - 1];
+            double p = (immature > 0.0) ? (maturityAtAge[age] - maturityAtAge[age - 1]) / immature : 1.0;
+            maturationProbabilityAtAge[age] = std::min(1.0, std::max(0.0, p));
+        }
+    }
+
+    const FishArena& getArena() const { return fish; }
+
+    /**
+     * @brief Replaces the population with individuals drawn for the given numbers at age.
+     */
+    void initialize(const std::vector<double>& numbersAtAge, ThreadPool& pool)
+    {
+        fish = FishArena();
+        std::mt19937 rng = makeStream(0xFFFFFFFFu, 0, 0);
+        std::vector<std::size_t> counts;
+        std::size_t total = 0;
+        for (double numbers : numbersAtAge)
+        {
+            counts.push_back(stochasticRound(numbers * settings.individualsPerFish, rng));
+            total += counts.back();
+        }
+        fish.reserve(total + total / 2);
+
+        for (std::size_t age = 0; age < counts.size(); ++age)
+        {
+            std::size_t first = fish.append(counts[age]);
+            addIndividuals(first, counts[age], static_cast<int>(age), 0xFFFFFFFFu, static_cast<std::uint32_t>(age + 1), pool);
+        }
+    }
+
+    /**
+     * @brief Simulates one year: mortality and capture, ageing, growth and maturation, compaction, then recruitment.
+     * @param recruitment The recruits in numbers of fish of the age model, added at age 0 at the end of the year.
+     * @param year The year index, used to select the random streams.
+     */
+    IndividualYearSummary stepYear(double recruitment, std::uint32_t year, ThreadPool& pool)
+    {
+        std::size_t count = fish.size();
+        std::size_t chunkCount = (count + settings.chunkSize - 1) / settings.chunkSize;
+        std::vector<std::uint8_t> alive(count);
+        std::vector<double> chunkCatch(chunkCount, 0.0);
+        std::vector<std::size_t> chunkDeaths(chunkCount, 0), chunkCaptures(chunkCount, 0);
+        int maxAge = params.maxAge;
+
+        pool.parallelFor(chunkCount, [&](std::size_t chunk)
+        {
+            std::mt19937 rng = makeStream(year, static_cast<std::uint32_t>(chunk), 1);
+            std::size_t begin = chunk * settings.chunkSize;
+            std::size_t end = std::min(count, begin + settings.chunkSize);
+
+            double catchWeight = 0.0;
+            std::size_t deaths = 0, captures = 0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                int age = fish.age[i];
+                double u = uniform(rng);
+                if (u < deathProbabilityAtAge[age])
+                {
+                    alive[i] = 0;
+                    ++deaths;
+                    if (u < captureProbabilityAtAge[age])
+                    {
+                        ++captures;
+                        catchWeight += fish.weight[i];
+                    }
+                    continue;
+                }
+                alive[i] = 1;
+
+                //the plus group keeps its age, length and maturity
+                if (age == maxAge) continue;
+                ++age;
+                fish.age[i] = static_cast<std::uint16_t>(age);
+                fish.length[i] = static_cast<float>(fish.length[i] * lengthRatioAtAge[age]);
+                fish.weight[i] = static_cast<float>(fish.weight[i] * weightRatioAtAge[age]);
+                if (!fish.mature[i] && uniform(rng) < maturationProbabilityAtAge[age]) fish.mature[i] = 1;
+            }
+            chunkCatch[chunk] = catchWeight;
+            chunkDeaths[chunk] = deaths;
+            chunkCaptures[chunk] = captures;
+        });
+
+        fish.compact(alive, settings.chunkSize, pool);
+
+        IndividualYearSummary summary;
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            summary.totalCatch += chunkCatch[chunk];
+            summary.deaths += chunkDeaths[chunk];
+            summary.captures += chunkCaptures[chunk];
+        }
+        summary.totalCatch /= settings.individualsPerFish;
+
+        std::mt19937 rng = makeStream(year, 0xFFFFFFFFu, 2);
+        summary.births = stochasticRound(recruitment * settings.individualsPerFish, rng);
+        std::size_t first = fish.append(summary.births);
+        addIndividuals(first, summary.births, 0, year, 0, pool);
+        return summary;
+    }
+
+    /**
+     * @brief Total biomass in the units of the age-structured model.
+     */
+    double getTotalBiomass(ThreadPool& pool) const
+    {
+        return sumWeights(false, pool) / settings.individualsPerFish;
+    }
+
+    /**
+     * @brief Spawning stock biomass (weight of the mature fish) in the units of the age-structured model.
+     */
+    double getSpawningStockBiomass(ThreadPool& pool) const
+    {
+        return sumWeights(true, pool) / settings.individualsPerFish;
+    }
+
+    /**
+     * @brief Numbers at age in the units of the age-structured model.
+     */
+    std::vector<double> getNumbersAtAge() const
+    {
+        std::vector<double> numbers(params.maxAge + 1, 0.0);
+        for (std::uint16_t age : fish.age) numbers[age] += 1.0;
+        for (double& value : numbers) value /= settings.individualsPerFish;
+        return numbers;
+    }
+
+private:
+    std::mt19937 makeStream(std::uint32_t year, std::uint32_t chunk, std::uint32_t purpose) const
+    {
+        std::seed_seq sequence{ settings.seed, year, chunk, purpose };
+        return std::mt19937(sequence);
+    }
+
+    //uniform draw on [0, 1) from a single 32-bit output, enough resolution for the probabilities used here
+    static double uniform(std::mt19937& rng)
+    {
+        return rng() * (1.0 / 4294967296.0);
+    }
+
+    static std::size_t stochasticRound(double value, std::mt19937& rng)
+    {
+        if (!(value > 0.0)) return 0;
+        double whole = std::floor(value);
+        return static_cast<std::size_t>(whole) + ((uniform(rng) < value - whole) ? 1 : 0);
+    }
+
+    //fills the fish [first, first + count) with new individuals of the given age
+    void addIndividuals(std::size_t first, std::size_t count, int age, std::uint32_t year, std::uint32_t stream, ThreadPool& pool)
+    {
+        std::size_t chunkCount = (count + settings.chunkSize - 1) / settings.chunkSize;
+        double meanLinf = params.vb_Linf;
+        double linfSigma = std::sqrt(std::log(1.0 + settings.linfCV * settings.linfCV));
+
+        pool.parallelFor(chunkCount, [&](std::size_t chunk)
+        {
+            std::mt19937 rng = makeStream(year, static_cast<std::uint32_t>(chunk), 3 + stream);
+            std::normal_distribution<double> normal(0.0, 1.0);
+            std::size_t begin = first + chunk * settings.chunkSize;
+            std::size_t end = std::min(first + count, begin + settings.chunkSize);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                //log-normal asymptotic length with mean vb_Linf
+                double linf = meanLinf;
+                double weight = meanWeightAtAge[age];
+                if (linfSigma > 0.0)
+                {
+                    linf = meanLinf * std::exp(linfSigma * normal(rng) - 0.5 * linfSigma * linfSigma);
+                    weight *= std::pow(linf / meanLinf, params.lw_b);
+                }
+                fish.age[i] = static_cast<std::uint16_t>(age);
+                fish.asymptoticLength[i] = static_cast<float>(linf);
+                fish.length[i] = static_cast<float>(linf * lengthFractionAtAge[age]);
+                fish.weight[i] = static_cast<float>(weight);
+                fish.mature[i] = (uniform(rng) < maturityAtAge[age]) ? 1 : 0;
+            }
+        });
+    }
+
+    double sumWeights(bool matureOnly, ThreadPool& pool) const
+    {
+        std::size_t count = fish.size();
+        std::size_t chunkCount = (count + settings.chunkSize - 1) / settings.chunkSize;
+        std::vector<double> partial(chunkCount, 0.0);
+        pool.parallelFor(chunkCount, [&](std::size_t chunk)
+        {
+            std::size_t begin = chunk * settings.chunkSize;
+            std::size_t end = std::min(count, begin + settings.chunkSize);
+            double sum = 0.0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if (!matureOnly || fish.mature[i]) sum += fish.weight[i];
+            }
+            partial[chunk] = sum;
+        });
+
+        double total = 0.0;
+        for (double value : partial) total += value;
+        return total;
+    }
+
+    AgeModelParameters<double> params;
+    IndividualModelSettings settings;
+    std::vector<double> deathProbabilityAtAge;
+    std::vector<double> captureProbabilityAtAge;
+    std::vector<double> maturityAtAge;
+    std::vector<double> maturationProbabilityAtAge;
+    std::vector<double> lengthFractionAtAge;
+    std::vector<double> meanWeightAtAge;
+    std::vector<double> lengthRatioAtAge;
+    std::vector<double> weightRatioAtAge;
+
+    FishArena fish;
+};
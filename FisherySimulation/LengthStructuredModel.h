@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "AgeStructuredModel.h"
+
+/**
+ * @brief One non-zero entry of a sparse matrix, used to assemble a SparseMatrixCSR.
+ */
+struct SparseEntry
+{
+    std::size_t row;
+    std::size_t column;
+    double value;
+};
+
+/**
+ * @class SparseMatrixCSR
+ * @brief Sparse matrix in compressed sparse row format.
+ * Besides the plain matrix-vector product, it multiplies many vectors at once: the vectors are stored
+ * interleaved (x[column * vectorCount + v]) and processed in blocks, so each matrix entry is loaded once
+ * per block and the block's slice of x stays in cache while a band of rows is swept.
+ */
+class SparseMatrixCSR
+{
+public:
+    SparseMatrixCSR() : rows(0), columns(0), rowStart(1, 0) {}
+
+    /**
+     * @brief Assembles the matrix from unordered entries. Duplicate (row, column) entries are summed.
+     */
+    SparseMatrixCSR(std::size_t rows, std::size_t columns, std::vector<SparseEntry> entries)
+        : rows(rows), columns(columns), rowStart(rows + 1, 0)
+    {
+        std::sort(entries.begin(), entries.end(), [](const SparseEntry& a, const SparseEntry& b)
+        {
+            return (a.row != b.row) ? a.row < b.row : a.column < b.column;
+        });
+
+        for (std::size_t k = 0; k < entries.size(); ++k)
+        {
+            const SparseEntry& entry = entries[k];
+            if (entry.row >= rows || entry.column >= columns)
+            {
+                throw std::out_of_range("SparseMatrixCSR: entry outside of the matrix.");
+            }
+            if (k > 0 && entries[k - 1].row == entry.row && entries[k - 1].column == entry.column)
+            {
+                values.back() += entry.value;
+                continue;
+            }
+            columnIndex.push_back(entry.column);
+            values.push_back(entry.value);
+            ++rowStart[entry.row + 1];
+        }
+
+        //entry counts per row to row offsets
+        for (std::size_t row = 1; row <= rows; ++row)
+        {
+            rowStart[row] += rowStart[row - 1];
+        }
+    }
+
+    std::size_t getRows() const { return rows; }
+    std::size_t getColumns() const { return columns; }
+    std::size_t getNonZeroCount() const { return values.size(); }
+
+    /**
+     * @brief y = A x for a single vector.
+     */
+    void multiply(const double* x, double* y) const
+    {
+        for (std::size_t row = 0; row < rows; ++row)
+        {
+            double sum = 0.0;
+            for (std::size_t k = rowStart[row]; k < rowStart[row + 1]; ++k)
+            {
+                sum += values[k] * x[columnIndex[k]];
+            }
+            y[row] = sum;
+        }
+    }
+
+    /**
+     * @brief Y = A X for vectorCount vectors stored interleaved (x[column * vectorCount + v]).
+     * Vectors are processed blockSize at a time with a fixed-width accumulator, so the inner loop over the
+     * vectors of a block has a compile-time trip count and vectorizes.
+     */
+    void multiplyBlock(const double* x, double* y, std::size_t vectorCount) const
+    {
+        std::size_t first = 0;
+        for (; first + blockSize <= vectorCount; first += blockSize)
+        {
+            multiplyColumns<blockSize>(x, y, vectorCount, first);
+        }
+        //remaining vectors one at a time
+        for (; first < vectorCount; ++first)
+        {
+            multiplyColumns<1>(x, y, vectorCount, first);
+        }
+    }
+
+    //the number of vectors processed together per sweep over the matrix
+    static const std::size_t blockSize = 8;
+
+private:
+    template <std::size_t Width>
+    void multiplyColumns(const double* x, double* y, std::size_t vectorCount, std::size_t first) const
+    {
+        for (std::size_t row = 0; row < rows; ++row)
+        {
+            double accumulator[Width] = {};
+            for (std::size_t k = rowStart[row]; k < rowStart[row + 1]; ++k)
+            {
+                double a = values[k];
+                const double* xRow = x + columnIndex[k] * vectorCount + first;
+                for (std::size_t v = 0; v < Width; ++v)
+                {
+                    accumulator[v] += a * xRow[v];
+                }
+            }
+            double* yRow = y + row * vectorCount + first;
+            for (std::size_t v = 0; v < Width; ++v) yRow[v] = accumulator[v];
+        }
+    }
+
+    std::size_t rows;
+    std::size_t columns;
+    std::vector<std::size_t> rowStart;
+    std::vector<std::size_t> columnIndex;
+    std::vector<double> values;
+};
+
+/**
+ * @brief Settings of the length-structured model that are not shared with the age-structured model.
+ */
+struct LengthModelSettings
+{
+    //equal-width length bins on [0, maxLength), the last bin also holds every larger fish
+    int lengthBins = 200;
+    double maxLength = 20.0;
+
+    //coefficient of variation of the yearly growth increment
+    double growthCV = 0.1;
+
+    //coefficient of variation of the length at age, used for recruits and the initial numbers at age
+    double lengthAtAgeCV = 0.1;
+
+    //logistic selectivity and maturity ogives in length
+    double selectivity_L50 = 0.0;
+    double selectivity_slope = 1.0;
+    double maturity_L50 = 0.0;
+    double maturity_slope = 1.0;
+};
+
+/**
+ * @class LengthStructuredModel
+ * @brief Length-based operating model sharing the biology of the age-structured model.
+ * The population is a vector of numbers per length bin. Every year each bin suffers natural mortality and
+ * length-selective fishing mortality (Baranov catch), the survivors grow with a growth-transition matrix
+ * built from the von Bertalanffy increment, and the recruits are added around the length at age 0.
+ * The transition matrix only links a bin to the bins within a few standard deviations of its expected
+ * length, so it is stored as a banded SparseMatrixCSR.
+ */
+class LengthStructuredModel
+{
+public:
+    LengthStructuredModel(const AgeModelParameters<double>& params, const LengthModelSettings& settings)
+        : params(params), settings(settings), bins(static_cast<std::size_t>(settings.lengthBins))
+    {
+        if (settings.lengthBins < 2 || !(settings.maxLength > 0.0) || settings.growthCV < 0.0 || settings.lengthAtAgeCV < 0.0)
+        {
+            throw std::invalid_argument("LengthStructuredModel needs at least 2 bins, a positive maximum length and non-negative CVs.");
+        }
+
+        binWidth = settings.maxLength / bins;
+        survival.resize(bins);
+        catchFactor.resize(bins);
+        weight.resize(bins);
+        ssbWeight.resize(bins);
+
+        std::vector<SparseEntry> entries;
+        std::vector<double> distribution;
+        double growthFactor = std::exp(-params.vb_k);
+        for (std::size_t bin = 0; bin < bins; ++bin)
+        {
+            double length = getMidpoint(bin);
+            double selectivity = logistic(length, settings.selectivity_L50, settings.selectivity_slope);
+            double F = params.fishingMortality * selectivity;
+            double Z = params.naturalMortality + F;
+
+            weight[bin] = params.lw_a * std::pow(length, params.lw_b);
+            ssbWeight[bin] = weight[bin] * logistic(length, settings.maturity_L50, settings.maturity_slope);
+            survival[bin] = std::exp(-Z);
+            catchFactor[bin] = (Z > 0.0) ? (F / Z) * (1.0 - survival[bin]) * weight[bin] : 0.0;
+
+            //von Bertalanffy expected length after one year; fish never shrink
+            double expected = std::max(length, params.vb_Linf + (length - params.vb_Linf) * growthFactor);
+            std::size_t firstBin = getDistribution(expected, settings.growthCV * (expected - length), bin, distribution);
+            for (std::size_t j = 0; j < distribution.size(); ++j)
+            {
+                if (distribution[j] > 0.0) entries.push_back({ firstBin + j, bin, distribution[j] });
+            }
+        }
+        growth = SparseMatrixCSR(bins, bins, entries);
+
+        //recruits enter at the length at age 0
+        recruitDistribution.assign(bins, 0.0);
+        addLengthAtAge(0, 1.0, recruitDistribution);
+    }
+
+    std::size_t getBinCount() const { return bins; }
+    double getMidpoint(std::size_t bin) const { return (bin + 0.5) * binWidth; }
+    const SparseMatrixCSR& getGrowthMatrix() const { return growth; }
+
+    /**
+     * @brief Converts numbers at age into numbers per length bin, around the von Bertalanffy length at each age.
+     */
+    std::vector<double> getNumbersAtLength(const std::vector<double>& numbersAtAge) const
+    {
+        std::vector<double> numbers(bins, 0.0);
+        for (std::size_t age = 0; age < numbersAtAge.size(); ++age)
+        {
+            addLengthAtAge(static_cast<int>(age), numbersAtAge[age], numbers);
+        }
+        return numbers;
+    }
+
+    /**
+     * @brief Simulates one year for a single population.
+     * @param numbers The numbers per length bin, updated in place.
+     * @param recruitment The number of recruits added at the end of the year.
+     * @param scratch Work array, resized as needed.
+     * @return The total catch in biomass for the year.
+     */
+    double step(std::vector<double>& numbers, double recruitment, std::vector<double>& scratch) const
+    {
+        return stepBlock(numbers, 1, &recruitment, scratch, nullptr);
+    }
+
+    /**
+     * @brief Simulates one year for vectorCount populations stored interleaved (numbers[bin * vectorCount + v]).
+     * @param recruitment The recruits of each population.
+     * @param outCatch (Optional output) The catch in biomass of each population.
+     * @return The catch of the first population.
+     */
+    double stepBlock(std::vector<double>& numbers, std::size_t vectorCount, const double* recruitment,
+        std::vector<double>& scratch, double* outCatch) const
+    {
+        scratch.resize(bins * vectorCount);
+        std::vector<double> totalCatch(vectorCount, 0.0);
+
+        //mortality and catch, elementwise over the populations of a bin
+        for (std::size_t bin = 0; bin < bins; ++bin)
+        {
+            double s = survival[bin];
+            double c = catchFactor[bin];
+            const double* N = &numbers[bin * vectorCount];
+            double* survivors = &scratch[bin * vectorCount];
+            for (std::size_t v = 0; v < vectorCount; ++v)
+            {
+                totalCatch[v] += c * N[v];
+                survivors[v] = s * N[v];
+            }
+        }
+
+        //growth of the survivors
+        growth.multiplyBlock(scratch.data(), numbers.data(), vectorCount);
+
+        //recruitment
+        for (std::size_t bin = 0; bin < bins; ++bin)
+        {
+            double share = recruitDistribution[bin];
+            if (share == 0.0) continue;
+            double* N = &numbers[bin * vectorCount];
+            for (std::size_t v = 0; v < vectorCount; ++v)
+            {
+                N[v] += share * recruitment[v];
+            }
+        }
+
+        if (outCatch) std::copy(totalCatch.begin(), totalCatch.end(), outCatch);
+        return totalCatch[0];
+    }
+
+    double getTotalBiomass(const std::vector<double>& numbers, std::size_t vectorCount = 1, std::size_t vector = 0) const
+    {
+        return weightedSum(weight, numbers, vectorCount, vector);
+    }
+
+    double getSpawningStockBiomass(const std::vector<double>& numbers, std::size_t vectorCount = 1, std::size_t vector = 0) const
+    {
+        return weightedSum(ssbWeight, numbers, vectorCount, vector);
+    }
+
+    /**
+     * @brief The unfished spawning stock biomass SSB0 of this model, the SSB of its equilibrium without fishing
+     * under a constant recruitment of R0 (constantRecruitment). It anchors the stock-recruitment relationships
+     * to the length model's own spawning stock, which differs from the age model's SSB0.
+     * The equilibrium numbers are the recruits of every past year, each cohort surviving natural mortality
+     * and growing once per year: sum over years a of (G S)^a r, summed until the cohorts have died out.
+     */
+    double getUnfishedSpawningStockBiomass() const
+    {
+        std::vector<double> unfishedSurvival(bins, std::exp(-params.naturalMortality));
+        std::vector<double> cohort(recruitDistribution);
+        std::vector<double> survivors(bins);
+        double ssb = 0.0;
+        for (int year = 0; year < 10000; ++year)
+        {
+            double cohortSSB = weightedSum(ssbWeight, cohort, 1, 0);
+            double cohortNumbers = 0.0;
+            for (std::size_t bin = 0; bin < bins; ++bin)
+            {
+                cohortNumbers += cohort[bin];
+                survivors[bin] = unfishedSurvival[bin] * cohort[bin];
+            }
+            ssb += cohortSSB;
+            if (cohortNumbers < 1e-12) break;
+            growth.multiply(survivors.data(), cohort.data());
+        }
+        return params.constantRecruitment * ssb;
+    }
+
+private:
+    static double logistic(double length, double l50, double slope)
+    {
+        return 1.0 / (1.0 + std::exp(-slope * (length - l50)));
+    }
+
+    static double normalCdf(double x)
+    {
+        return 0.5 * std::erfc(-x / std::sqrt(2.0));
+    }
+
+    std::size_t getBin(double length) const
+    {
+        if (length <= 0.0) return 0;
+        return std::min(bins - 1, static_cast<std::size_t>(length / binWidth));
+    }
+
+    /**
+     * @brief Spreads a normal distribution of lengths over the bins from minimumBin upwards.
+     * The band is cut at 4 standard deviations. The mass below the band goes to its first bin and the
+     * mass above to its last bin, so the shares always sum to 1.
+     * @return The first bin of the band; distribution receives the shares of the consecutive bins.
+     */
+    std::size_t getDistribution(double mean, double sd, std::size_t minimumBin, std::vector<double>& distribution) const
+    {
+        distribution.clear();
+        if (!(sd > 1e-6 * binWidth))
+        {
+            distribution.push_back(1.0);
+            return std::max(minimumBin, getBin(mean));
+        }
+
+        std::size_t first = std::max(minimumBin, getBin(mean - 4.0 * sd));
+        std::size_t last = std::max(first, getBin(mean + 4.0 * sd));
+        double previousCdf = 0.0;
+        for (std::size_t bin = first; bin <= last; ++bin)
+        {
+            double cdf = (bin == last) ? 1.0 : normalCdf(((bin + 1) * binWidth - mean) / sd);
+            distribution.push_back(cdf - previousCdf);
+            previousCdf = cdf;
+        }
+        return first;
+    }
+
+    void addLengthAtAge(int age, double count, std::vector<double>& numbers) const
+    {
+        double mean = params.vb_Linf * (1.0 - std::exp(-params.vb_k * (age - params.vb_t0)));
+        std::vector<double> distribution;
+        std::size_t first = getDistribution(mean, settings.lengthAtAgeCV * std::max(mean, 0.0), 0, distribution);
+        for (std::size_t j = 0; j < distribution.size(); ++j)
+        {
+            numbers[first + j] += count * distribution[j];
+        }
+    }
+
+    double weightedSum(const std::vector<double>& weights, const std::vector<double>& numbers, std::size_t vectorCount, std::size_t vector) const
+    {
+        double sum = 0.0;
+        for (std::size_t bin = 0; bin < bins; ++bin)
+        {
+            sum += weights[bin] * numbers[bin * vectorCount + vector];
+        }
+        return sum;
+    }
+
+    AgeModelParameters<double> params;
+    LengthModelSettings settings;
+    std::size_t bins;
+    double binWidth = 0.0;
+
+    std::vector<double> survival;
+    std::vector<double> catchFactor;
+    std::vector<double> weight;
+    std::vector<double> ssbWeight;
+    std::vector<double> recruitDistribution;
+    SparseMatrixCSR growth;
+};
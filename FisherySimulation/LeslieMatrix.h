@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "AgeStructuredModel.h"
+
+/**
+ * @class DenseMatrix
+ * @brief A small square row-major matrix with the operations needed by the Leslie formulation.
+ */
+class DenseMatrix
+{
+public:
+    explicit DenseMatrix(std::size_t size = 0) : size(size), values(size * size, 0.0) {}
+
+    static DenseMatrix identity(std::size_t size)
+    {
+        DenseMatrix result(size);
+        for (std::size_t i = 0; i < size; ++i) result(i, i) = 1.0;
+        return result;
+    }
+
+    std::size_t getSize() const { return size; }
+
+    double& operator()(std::size_t row, std::size_t column) { return values[row * size + column]; }
+    double operator()(std::size_t row, std::size_t column) const { return values[row * size + column]; }
+
+    DenseMatrix operator*(const DenseMatrix& other) const
+    {
+        DenseMatrix result(size);
+        //i-k-j order keeps the inner loop contiguous
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            for (std::size_t k = 0; k < size; ++k)
+            {
+                double a = (*this)(i, k);
+                if (a == 0.0) continue;
+                for (std::size_t j = 0; j < size; ++j)
+                {
+                    result(i, j) += a * other(k, j);
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<double> operator*(const std::vector<double>& vector) const
+    {
+        std::vector<double> result(size, 0.0);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                result[i] += (*this)(i, j) * vector[j];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Raises the matrix to a non-negative integer power by repeated squaring (O(n^3 log power)).
+     */
+    DenseMatrix power(unsigned long long exponent) const
+    {
+        DenseMatrix result = identity(size);
+        DenseMatrix base = *this;
+        while (exponent > 0)
+        {
+            if (exponent & 1ull) result = result * base;
+            exponent >>= 1;
+            if (exponent > 0) base = base * base;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Solves this * x = rhs by Gaussian elimination with partial pivoting.
+     */
+    std::vector<double> solve(std::vector<double> rhs) const
+    {
+        DenseMatrix a = *this;
+        for (std::size_t column = 0; column < size; ++column)
+        {
+            std::size_t pivot = column;
+            for (std::size_t row = column + 1; row < size; ++row)
+            {
+                if (std::fabs(a(row, column)) > std::fabs(a(pivot, column))) pivot = row;
+            }
+            if (a(pivot, column) == 0.0)
+            {
+                throw std::runtime_error("DenseMatrix::solve: matrix is singular.");
+            }
+            if (pivot != column)
+            {
+                for (std::size_t j = 0; j < size; ++j) std::swap(a(pivot, j), a(column, j));
+                std::swap(rhs[pivot], rhs[column]);
+            }
+            for (std::size_t row = column + 1; row < size; ++row)
+            {
+                double factor = a(row, column) / a(column, column);
+                if (factor == 0.0) continue;
+                for (std::size_t j = column; j < size; ++j) a(row, j) -= factor * a(column, j);
+                rhs[row] -= factor * rhs[column];
+            }
+        }
+
+        std::vector<double> x(size, 0.0);
+        for (std::size_t i = size; i-- > 0;)
+        {
+            double sum = rhs[i];
+            for (std::size_t j = i + 1; j < size; ++j) sum -= a(i, j) * x[j];
+            x[i] = sum / a(i, i);
+        }
+        return x;
+    }
+
+private:
+    std::size_t size;
+    std::vector<double> values;
+};
+
+/**
+ * @class LeslieModel
+ * @brief Matrix form of the deterministic age-structured step, N(t+1) = A N(t) + b.
+ * With constant recruitment and fishing mortality, AgeStructuredModelStep is an affine map: A holds the
+ * survival of every cohort into the next age (and of the plus group into itself) and b adds the recruits.
+ * The yearly catch, total biomass and SSB are linear functionals of the numbers at age.
+ */
+class LeslieModel
+{
+public:
+    /**
+     * @brief Builds the matrix form of AgeStructuredModelStep for the given parameters.
+     */
+    explicit LeslieModel(const AgeModelParameters<double>& params)
+        : ages(params.maxAge + 1), transition(params.maxAge + 1), recruitment(params.maxAge + 1, 0.0),
+        catchWeights(params.maxAge + 1, 0.0), biomassWeights(params.maxAge + 1, 0.0), ssbWeights(params.maxAge + 1, 0.0)
+    {
+        for (int age = 0; age <= params.maxAge; ++age)
+        {
+            double F = params.fishingMortality * getSelectivityAtAge(age, params);
+            double Z = params.naturalMortality + F;
+            double survival = std::exp(-Z);
+            double weight = getWeightAtAge(age, params);
+
+            //cohorts move to the next age; the plus group also keeps its own survivors
+            if (age < params.maxAge) transition(age + 1, age) = survival;
+            if (age == params.maxAge) transition(age, age) += survival;
+
+            //baranov catch of the cohort during the year
+            catchWeights[age] = (F / Z) * (1.0 - survival) * weight;
+            biomassWeights[age] = weight;
+            ssbWeights[age] = weight * getMaturityAtAge(age, params);
+        }
+        recruitment[0] = params.constantRecruitment;
+    }
+
+    std::size_t getAgeCount() const { return ages; }
+    const DenseMatrix& getTransitionMatrix() const { return transition; }
+
+    /**
+     * @brief The (n + 1) x (n + 1) augmented matrix [[A, b], [0, 1]] that applies the affine step as one product.
+     */
+    DenseMatrix getAugmentedMatrix() const
+    {
+        DenseMatrix augmented(ages + 1);
+        for (std::size_t i = 0; i < ages; ++i)
+        {
+            for (std::size_t j = 0; j < ages; ++j) augmented(i, j) = transition(i, j);
+            augmented(i, ages) = recruitment[i];
+        }
+        augmented(ages, ages) = 1.0;
+        return augmented;
+    }
+
+    /**
+     * @brief Projects the numbers at age forward by the given number of years with O(log years) matrix products.
+     */
+    std::vector<double> project(const std::vector<double>& numbersAtAge, unsigned long long years) const
+    {
+        std::vector<double> augmentedState(numbersAtAge.begin(), numbersAtAge.end());
+        augmentedState.push_back(1.0);
+        std::vector<double> result = getAugmentedMatrix().power(years) * augmentedState;
+        result.pop_back();
+        return result;
+    }
+
+    /**
+     * @brief Returns the equilibrium numbers at age, the solution of (I - A) N = b.
+     */
+    std::vector<double> equilibrium() const
+    {
+        DenseMatrix system = DenseMatrix::identity(ages);
+        for (std::size_t i = 0; i < ages; ++i)
+        {
+            for (std::size_t j = 0; j < ages; ++j) system(i, j) -= transition(i, j);
+        }
+        return system.solve(recruitment);
+    }
+
+    /**
+     * @brief Estimates the dominant eigenvalue of A by power iteration.
+     * It is the asymptotic rate at which deviations from the equilibrium decay each year.
+     */
+    double dominantEigenvalue(int maxIterations = 1000, double tolerance = 1e-12) const
+    {
+        std::vector<double> vector(ages, 1.0);
+        double eigenvalue = 0.0;
+        for (int iteration = 0; iteration < maxIterations; ++iteration)
+        {
+            std::vector<double> next = transition * vector;
+            double norm = 0.0;
+            for (double value : next) norm = std::max(norm, std::fabs(value));
+            if (norm == 0.0) return 0.0;
+
+            for (double& value : next) value /= norm;
+            bool converged = std::fabs(norm - eigenvalue) <= tolerance * norm;
+            eigenvalue = norm;
+            vector = next;
+            if (converged) break;
+        }
+        return eigenvalue;
+    }
+
+    double getCatch(const std::vector<double>& numbersAtAge) const { return dot(catchWeights, numbersAtAge); }
+    double getTotalBiomass(const std::vector<double>& numbersAtAge) const { return dot(biomassWeights, numbersAtAge); }
+    double getSpawningStockBiomass(const std::vector<double>& numbersAtAge) const { return dot(ssbWeights, numbersAtAge); }
+
+private:
+    static double dot(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < a.size(); ++i) sum += a[i] * b[i];
+        return sum;
+    }
+
+    std::size_t ages;
+    DenseMatrix transition;
+    std::vector<double> recruitment;
+    std::vector<double> catchWeights;
+    std::vector<double> biomassWeights;
+    std::vector<double> ssbWeights;
+};
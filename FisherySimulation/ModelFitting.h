@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief An observed time series (e.g. catch or a survey biomass index) compared against a model prediction.
+ */
+struct ObservedSeries
+{
+    //the column name in the observations file
+    std::string name;
+
+    //the model output the series is compared with (e.g. "catch", "biomass", "ssb")
+    std::string prediction;
+
+    //the standard deviation of the log-normal observation error
+    double sigma = 0.1;
+
+    //true for relative indices, which are compared after scaling by a catchability estimated in closed form
+    bool scaled = false;
+
+    //simulation years with an observation, and the observed values
+    std::vector<int> years;
+    std::vector<double> values;
+};
+
+/**
+ * @brief Reads observed series from a CSV file.
+ * The file has a header "Year,<name1>,<name2>,..." followed by one row per year. Lines starting with '#'
+ * are comments, and empty or non-positive cells are treated as missing observations.
+ * @param filename The CSV file to read.
+ * @param series The series to fill. Their names select the columns, the years and values are replaced.
+ * @return True if the file was read, every series has a matching column and every cell is numeric, false otherwise.
+ */
+inline bool loadObservedSeries(const std::string& filename, std::vector<ObservedSeries>& series)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cout << "Error: Could not open observations file: " << filename << std::endl;
+        return false;
+    }
+
+    auto splitLine = [](const std::string& line)
+    {
+        std::vector<std::string> cells;
+        std::stringstream ss(line);
+        std::string cell;
+        while (std::getline(ss, cell, ','))
+        {
+            cell.erase(0, cell.find_first_not_of(" \t\r"));
+            cell.erase(cell.find_last_not_of(" \t\r") + 1);
+            cells.push_back(cell);
+        }
+        return cells;
+    };
+
+    //the whole cell must be a number
+    auto parseCell = [](const std::string& cell, double& outValue)
+    {
+        char* end = nullptr;
+        outValue = std::strtod(cell.c_str(), &end);
+        return end == cell.c_str() + cell.size() && std::isfinite(outValue);
+    };
+
+    std::string line;
+    std::size_t lineNumber = 0;
+    std::vector<std::string> header;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') continue;
+        header = splitLine(line);
+        break;
+    }
+
+    std::vector<int> columns(series.size(), -1);
+    for (std::size_t s = 0; s < series.size(); ++s)
+    {
+        auto it = std::find(header.begin(), header.end(), series[s].name);
+        if (it == header.end())
+        {
+            std::cout << "Error: Observations file has no column named '" << series[s].name << "'." << std::endl;
+            return false;
+        }
+        columns[s] = static_cast<int>(it - header.begin());
+        series[s].years.clear();
+        series[s].values.clear();
+    }
+
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> cells = splitLine(line);
+        if (cells.empty() || cells[0].empty()) continue;
+
+        double yearValue = 0.0;
+        if (!parseCell(cells[0], yearValue) || yearValue != std::floor(yearValue) || std::fabs(yearValue) > 1e9)
+        {
+            std::cout << "Error: Invalid year '" << cells[0] << "' on line " << lineNumber << " of " << filename << "." << std::endl;
+            return false;
+        }
+        int year = static_cast<int>(yearValue);
+        for (std::size_t s = 0; s < series.size(); ++s)
+        {
+            std::size_t column = static_cast<std::size_t>(columns[s]);
+            if (column >= cells.size() || cells[column].empty()) continue;
+
+            double value = 0.0;
+            if (!parseCell(cells[column], value))
+            {
+                std::cout << "Error: Non-numeric value '" << cells[column] << "' in column '" << series[s].name
+                    << "' on line " << lineNumber << " of " << filename << "." << std::endl;
+                return false;
+            }
+            if (value <= 0.0) continue;
+            series[s].years.push_back(year);
+            series[s].values.push_back(value);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates the negative log-likelihood of log-normal observation errors for any scalar type.
+ * Each observation contributes 0.5 * ((log(obs) - log(q * pred)) / sigma)^2 + log(sigma), where q is 1 for
+ * absolute series and the closed-form maximum likelihood catchability for scaled series. The per-observation
+ * components are evaluated in parallel chunks across series and years and summed in a fixed order.
+ * @param series The observed series. Every observed year must index into the matching prediction.
+ * @param predictions One predicted trajectory (indexed by year) per series.
+ * @param pool The thread pool used for the components.
+ * @param outScales (Optional output) The catchability used for each series.
+ */
+template <typename T>
+T evaluateNegativeLogLikelihood(const std::vector<ObservedSeries>& series, const std::vector<const std::vector<T>*>& predictions,
+    ThreadPool& pool, std::vector<T>* outScales = nullptr)
+{
+    using std::log;
+    using std::exp;
+
+    //guards log(0) when a prediction collapses
+    const double floor = 1e-12;
+
+    //closed-form catchability of scaled series: log q = mean(log(obs) - log(pred))
+    std::vector<T> logScales(series.size(), T(0.0));
+    for (std::size_t s = 0; s < series.size(); ++s)
+    {
+        if (!series[s].scaled || series[s].years.empty()) continue;
+        T sum = T(0.0);
+        for (std::size_t i = 0; i < series[s].years.size(); ++i)
+        {
+            sum += std::log(series[s].values[i]) - log((*predictions[s])[series[s].years[i]] + floor);
+        }
+        logScales[s] = sum / static_cast<double>(series[s].years.size());
+    }
+    if (outScales)
+    {
+        outScales->clear();
+        for (const T& logScale : logScales) outScales->push_back(exp(logScale));
+    }
+
+    //flatten the (series, year) components and split them into chunks
+    std::vector<std::pair<std::size_t, std::size_t>> components;
+    for (std::size_t s = 0; s < series.size(); ++s)
+    {
+        for (std::size_t i = 0; i < series[s].years.size(); ++i)
+        {
+            components.push_back(std::make_pair(s, i));
+        }
+    }
+
+    const std::size_t chunkSize = 64;
+    std::size_t chunkCount = (components.size() + chunkSize - 1) / chunkSize;
+    std::vector<T> partialSums(chunkCount, T(0.0));
+
+    pool.parallelFor(chunkCount, [&](std::size_t chunk)
+    {
+        T sum = T(0.0);
+        std::size_t end = std::min(components.size(), (chunk + 1) * chunkSize);
+        for (std::size_t c = chunk * chunkSize; c < end; ++c)
+        {
+            const ObservedSeries& observed = series[components[c].first];
+            std::size_t i = components[c].second;
+            T residual = (std::log(observed.values[i]) - logScales[components[c].first]
+                - log((*predictions[components[c].first])[observed.years[i]] + floor)) / observed.sigma;
+            sum += 0.5 * residual * residual + std::log(observed.sigma);
+        }
+        partialSums[chunk] = sum;
+    });
+
+    T total = T(0.0);
+    for (const T& partial : partialSums)
+    {
+        total += partial;
+    }
+    return total;
+}
+
+/**
+ * @class BFGSOptimizer
+ * @brief Minimizes a smooth objective with the BFGS quasi-Newton method and a backtracking (Armijo) line search.
+ */
+class BFGSOptimizer
+{
+public:
+    //evaluates the objective at x and, unless gradient is null, writes its gradient into it (resized to x.size())
+    using Objective = std::function<double(const std::vector<double>& x, std::vector<double>* gradient)>;
+
+    //called after every iteration with the iteration number, the objective value and the gradient norm
+    using Progress = std::function<void(int iteration, double value, double gradientNorm)>;
+
+    struct Result
+    {
+        std::vector<double> x;
+        double value = 0.0;
+        double gradientNorm = 0.0;
+        int iterations = 0;
+        bool converged = false;
+    };
+
+    BFGSOptimizer(int maxIterations, double gradientTolerance)
+        : maxIterations(maxIterations), gradientTolerance(gradientTolerance) {}
+
+    Result minimize(const Objective& objective, const std::vector<double>& x0, const Progress& progress = Progress()) const
+    {
+        std::size_t n = x0.size();
+        Result result;
+        result.x = x0;
+
+        std::vector<double> gradient(n);
+        result.value = objective(result.x, &gradient);
+        result.gradientNorm = norm(gradient);
+
+        //inverse hessian approximation, starting from the identity
+        std::vector<double> H(n * n, 0.0);
+        for (std::size_t i = 0; i < n; ++i) H[i * n + i] = 1.0;
+
+        std::vector<double> direction(n), candidate(n), candidateGradient(n), s(n), y(n), Hy(n);
+        for (int iteration = 1; iteration <= maxIterations; ++iteration)
+        {
+            if (result.gradientNorm < gradientTolerance)
+            {
+                result.converged = true;
+                break;
+            }
+
+            //direction = -H g
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                direction[i] = 0.0;
+                for (std::size_t j = 0; j < n; ++j) direction[i] -= H[i * n + j] * gradient[j];
+            }
+            double slope = dot(direction, gradient);
+            if (slope >= 0.0)
+            {
+                //not a descent direction, restart from steepest descent
+                std::fill(H.begin(), H.end(), 0.0);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    H[i * n + i] = 1.0;
+                    direction[i] = -gradient[i];
+                }
+                slope = -dot(gradient, gradient);
+            }
+
+            //backtracking line search on the value alone; the gradient is only needed at the accepted point
+            double step = 1.0;
+            double candidateValue = 0.0;
+            bool accepted = false;
+            for (int trial = 0; trial < 40; ++trial)
+            {
+                for (std::size_t i = 0; i < n; ++i) candidate[i] = result.x[i] + step * direction[i];
+                candidateValue = objective(candidate, nullptr);
+                if (std::isfinite(candidateValue) && candidateValue <= result.value + 1e-4 * step * slope)
+                {
+                    accepted = true;
+                    break;
+                }
+                step *= 0.5;
+            }
+            if (!accepted)
+            {
+                //no further decrease possible along the search direction
+                result.iterations = iteration;
+                break;
+            }
+            objective(candidate, &candidateGradient);
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                s[i] = candidate[i] - result.x[i];
+                y[i] = candidateGradient[i] - gradient[i];
+            }
+            double sy = dot(s, y);
+
+            double previousValue = result.value;
+            result.x = candidate;
+            result.value = candidateValue;
+            gradient = candidateGradient;
+            result.gradientNorm = norm(gradient);
+            result.iterations = iteration;
+
+            if (progress) progress(iteration, result.value, result.gradientNorm);
+
+            //BFGS update of the inverse hessian, skipped when the curvature condition fails
+            if (sy > 1e-12)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    Hy[i] = 0.0;
+                    for (std::size_t j = 0; j < n; ++j) Hy[i] += H[i * n + j] * y[j];
+                }
+                double yHy = dot(y, Hy);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        H[i * n + j] += ((sy + yHy) * s[i] * s[j]) / (sy * sy) - (Hy[i] * s[j] + s[i] * Hy[j]) / sy;
+                    }
+                }
+            }
+
+            //the objective no longer changes, so the remaining gradient is numerical noise
+            if (std::fabs(previousValue - result.value) <= 1e-12 * std::max(1.0, std::fabs(result.value)))
+            {
+                result.converged = true;
+                break;
+            }
+        }
+
+        if (result.gradientNorm < gradientTolerance) result.converged = true;
+        return result;
+    }
+
+private:
+    static double dot(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < a.size(); ++i) sum += a[i] * b[i];
+        return sum;
+    }
+
+    static double norm(const std::vector<double>& v) { return std::sqrt(dot(v, v)); }
+
+    int maxIterations;
+    double gradientTolerance;
+};
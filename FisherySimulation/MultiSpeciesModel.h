@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The single-species parameters of a stock in a multi-species community.
+ */
+struct SpeciesParameters
+{
+    std::string name;
+
+    //logistic growth, as in the simple model
+    double growthRate = 1.0;
+    double carryingCapacity = 1.0;
+    double initialBiomass = 0.0;
+
+    //the standard deviation of the yearly noise multiplier on the growth rate
+    double growthStdDev = 0.0;
+
+    //the fishing mortality, the catch per year being fishingMortality * biomass
+    double fishingMortality = 0.0;
+};
+
+/**
+ * @class InteractionMatrix
+ * @brief The community interaction matrix A, where A[i][j] is the change of the per-capita growth rate of species i
+ * per unit biomass of species j (negative for prey eaten by j and for competitors, positive for predators of j).
+ * Dense food webs are stored row-major; when at most sparseDensity of the entries are non-zero, as in most
+ * food webs of many species, they are stored in compressed sparse row form instead, so a product costs one
+ * multiply-add per interaction.
+ */
+class InteractionMatrix
+{
+public:
+    InteractionMatrix() = default;
+
+    /**
+     * @param size The number of species.
+     * @param dense The matrix, row-major.
+     * @param sparseDensity The largest fraction of non-zero entries stored in sparse form.
+     */
+    InteractionMatrix(std::size_t size, const std::vector<double>& dense, double sparseDensity = 0.25)
+        : size(size)
+    {
+        std::size_t nonZeros = std::count_if(dense.begin(), dense.end(), [](double value) { return value != 0.0; });
+        sparse = nonZeros <= sparseDensity * size * size;
+        if (!sparse)
+        {
+            values = dense;
+            return;
+        }
+
+        rowStarts.reserve(size + 1);
+        rowStarts.push_back(0);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                if (dense[i * size + j] == 0.0) continue;
+                columns.push_back(static_cast<std::uint32_t>(j));
+                values.push_back(dense[i * size + j]);
+            }
+            rowStarts.push_back(static_cast<std::uint32_t>(values.size()));
+        }
+    }
+
+    std::size_t getSize() const { return size; }
+    bool isSparse() const { return sparse; }
+
+    std::size_t getNonZeroCount() const
+    {
+        return sparse ? values.size() : std::count_if(values.begin(), values.end(), [](double value) { return value != 0.0; });
+    }
+
+    /**
+     * @brief Computes y = A x.
+     */
+    void multiply(const double* x, double* y) const
+    {
+        if (sparse)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                double sum = 0.0;
+                for (std::uint32_t k = rowStarts[i]; k < rowStarts[i + 1]; ++k) sum += values[k] * x[columns[k]];
+                y[i] = sum;
+            }
+        }
+        else
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                const double* row = &values[i * size];
+                double sum = 0.0;
+                for (std::size_t j = 0; j < size; ++j) sum += row[j] * x[j];
+                y[i] = sum;
+            }
+        }
+    }
+
+private:
+    std::size_t size = 0;
+    bool sparse = false;
+    std::vector<double> values;
+    std::vector<std::uint32_t> rowStarts;
+    std::vector<std::uint32_t> columns;
+};
+
+/**
+ * @class MultiSpeciesModel
+ * @brief A community of logistic stocks coupled by predation and competition (generalized Lotka-Volterra):
+ * dB_i/dt = r_i e_i B_i (1 - B_i / K_i) + B_i (A B)_i - F_i B_i, with e_i the noise multiplier on the growth rate.
+ * Each step evaluates the interactions of the whole community with one matrix-vector product, then updates every
+ * species with the growth function it is given (the simple model's logistic growth and fishing), so a step costs
+ * O(interactions + species).
+ */
+class MultiSpeciesModel
+{
+public:
+    MultiSpeciesModel(const std::vector<SpeciesParameters>& species, const InteractionMatrix& interactions)
+        : species(species), interactions(interactions)
+    {
+    }
+
+    std::size_t getSpeciesCount() const { return species.size(); }
+    const SpeciesParameters& getSpecies(std::size_t i) const { return species[i]; }
+    const InteractionMatrix& getInteractions() const { return interactions; }
+
+    /**
+     * @brief Simulates one forward Euler step of the community.
+     * @param growth The single-species rate of change of a stock, growth(stock, growthRate, carryingCapacity,
+     *        harvestRate, noise), e.g. SimpleModelGrowthAmount.
+     * @param biomass The biomass of every species, updated in place.
+     * @param growthMultipliers The noise multiplier on the growth rate of every species.
+     * @param interactionRates Scratch space for the per-capita interaction rates, one value per species.
+     * @param catches The catch of every species, incremented by the catch of the step.
+     * @return The total catch of the step.
+     */
+    template <typename Growth>
+    double step(const Growth& growth, double* biomass, const double* growthMultipliers, double timeStep, double* interactionRates, double* catches) const
+    {
+        interactions.multiply(biomass, interactionRates);
+
+        double totalCatch = 0.0;
+        for (std::size_t i = 0; i < species.size(); ++i)
+        {
+            const SpeciesParameters& s = species[i];
+            double stock = biomass[i];
+            double harvest = s.fishingMortality * stock;
+            double singleSpeciesGrowth = growth(stock, s.growthRate, s.carryingCapacity, harvest, growthMultipliers[i]);
+            double next = stock + (singleSpeciesGrowth + stock * interactionRates[i]) * timeStep;
+
+            //a stock driven below zero only yields what was left of it, as in the simple model
+            double stepCatch = std::max(0.0, harvest * timeStep + std::min(0.0, next));
+            catches[i] += stepCatch;
+            totalCatch += stepCatch;
+            biomass[i] = std::max(0.0, next);
+        }
+        return totalCatch;
+    }
+
+private:
+    std::vector<SpeciesParameters> species;
+    InteractionMatrix interactions;
+};
+
+/**
+ * @brief Settings of a generated cascade-model food web.
+ */
+struct CascadeCommunitySettings
+{
+    std::size_t species = 40;
+
+    //the probability that a species eats a given species of lower trophic rank
+    double connectance = 0.1;
+
+    //a predator at its carrying capacity reduces the growth rate of a prey by up to attackRate times its maximum
+    double attackRate = 0.3;
+
+    //the fraction of the eaten biomass converted to predator biomass
+    double efficiency = 0.1;
+
+    double fishingMortality = 0.1;
+    double growthStdDev = 0.1;
+    std::uint32_t seed = 0;
+};
+
+/**
+ * @brief Generates a cascade-model food web (Cohen and Newman): species are ranked by trophic level, and every species
+ * eats each lower-ranked one with probability connectance. Growth rates and carrying capacities fall with the
+ * trophic rank, as in a biomass pyramid. Used to test communities of many species.
+ * @param outSpecies (Output) The species, from the lowest trophic rank.
+ * @param outDense (Output) The interaction matrix, row-major.
+ */
+inline void generateCascadeCommunity(const CascadeCommunitySettings& settings, std::vector<SpeciesParameters>& outSpecies, std::vector<double>& outDense)
+{
+    std::size_t n = settings.species;
+    std::seed_seq sequence{ settings.seed, 0xCA5Cu };
+    std::mt19937 rng(sequence);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    outSpecies.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        double rank = (n > 1) ? static_cast<double>(i) / (n - 1) : 0.0;
+        SpeciesParameters& s = outSpecies[i];
+        s.name = "Species" + std::to_string(i + 1);
+        s.growthRate = 2.0 * (1.0 - 0.8 * rank);
+        s.carryingCapacity = 100000.0 * std::pow(10.0, -2.0 * rank);
+        s.initialBiomass = 0.5 * s.carryingCapacity;
+        s.growthStdDev = settings.growthStdDev;
+        s.fishingMortality = settings.fishingMortality;
+    }
+
+    outDense.assign(n * n, 0.0);
+    for (std::size_t predator = 1; predator < n; ++predator)
+    {
+        for (std::size_t prey = 0; prey < predator; ++prey)
+        {
+            if (uniform(rng) >= settings.connectance) continue;
+            double rate = settings.attackRate * uniform(rng) * outSpecies[prey].growthRate / outSpecies[predator].carryingCapacity;
+            outDense[prey * n + predator] -= rate;
+            outDense[predator * n + prey] += settings.efficiency * rate;
+        }
+    }
+}
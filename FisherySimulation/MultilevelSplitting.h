@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief Settings of an adaptive multilevel splitting estimate.
+ */
+struct SplittingSettings
+{
+    //the number of particles simulated at every level
+    std::size_t particles = 1000;
+
+    //the fraction of particles that reaches each intermediate level (the next level is this quantile of their scores)
+    double levelProportion = 0.1;
+
+    //the maximum number of intermediate levels before giving up
+    std::size_t maxLevels = 100;
+
+    //the seed of the noise streams and of the resampling
+    std::uint32_t seed = 0;
+};
+
+/**
+ * @brief The result of an adaptive multilevel splitting estimate.
+ */
+struct SplittingResult
+{
+    //the estimated probability that the score reaches the threshold
+    double probability = 0.0;
+
+    //the intermediate levels and the fraction of particles that reached each of them
+    std::vector<double> levels;
+    std::vector<double> levelProbabilities;
+
+    //the total number of model steps simulated, including the replays that clone the particles
+    std::size_t simulatedSteps = 0;
+
+    //false if the levels stopped decreasing or maxLevels was reached before the threshold
+    bool converged = false;
+};
+
+/**
+ * @class MultilevelSplitting
+ * @brief Estimates the probability of a rare event "the score falls to the threshold before the horizon" by
+ * adaptive multilevel splitting. Lower scores are closer to the event (e.g. the stock biomass for a collapse).
+ *
+ * All particles are simulated to the horizon (or to the threshold) from their start states, and the next level
+ * is set to the levelProportion quantile of their minimum scores. The particles that reached it are replayed on
+ * their own noise stream up to the first step at or below the level, where the state is cloned, and the next
+ * stage restarts the same number of particles from these clones with fresh noise streams. The probability is the
+ * product of the fractions reaching each level and the fraction of the last stage reaching the threshold, so an
+ * event of probability P costs about log(P) / log(levelProportion) stages instead of 1 / P plain runs.
+ *
+ * The particles of a stage are simulated in parallel. Every particle has its own noise stream, and the stages
+ * are merged in particle order, so the estimate does not depend on the thread count.
+ *
+ * @tparam State A copyable model state (the cloned particle), including the current time step.
+ */
+template <typename State>
+class MultilevelSplitting
+{
+public:
+    /**
+     * @brief Simulates a particle from its state with the given noise stream until the horizon, or until its score
+     * is at or below stopLevel. Leaves the state at the stopping step and adds the simulated steps to outSteps.
+     * Must be deterministic for a given state and stream, and safe to call concurrently on different states.
+     * @return The minimum score along the path, including the start state.
+     */
+    using Simulator = std::function<double(State& state, std::uint32_t stream, double stopLevel, std::size_t& outSteps)>;
+
+    explicit MultilevelSplitting(const SplittingSettings& settings)
+        : settings(settings)
+    {
+    }
+
+    SplittingResult estimate(const State& initialState, double threshold, const Simulator& simulate, ThreadPool& pool) const
+    {
+        SplittingResult result;
+        std::size_t particles = settings.particles;
+        std::seed_seq resamplerSeed{ settings.seed, 0x5911u };
+        std::mt19937 resampler(resamplerSeed);
+
+        std::vector<State> startStates(particles, initialState);
+        std::vector<double> minimumScores(particles);
+        std::vector<std::size_t> steps(particles);
+        std::uint32_t nextStream = 0;
+        double previousLevel = std::numeric_limits<double>::infinity();
+        double probability = 1.0;
+
+        for (std::size_t stage = 0; ; ++stage)
+        {
+            //simulate every particle of the stage (stopping early once the event happens)
+            std::uint32_t firstStream = nextStream;
+            nextStream += static_cast<std::uint32_t>(particles);
+            pool.parallelFor(particles, [&](std::size_t particle)
+            {
+                State state = startStates[particle];
+                steps[particle] = 0;
+                minimumScores[particle] = simulate(state, firstStream + static_cast<std::uint32_t>(particle), threshold, steps[particle]);
+            });
+            for (std::size_t particle = 0; particle < particles; ++particle) result.simulatedSteps += steps[particle];
+
+            std::vector<double> sortedScores = minimumScores;
+            std::sort(sortedScores.begin(), sortedScores.end());
+            std::size_t quantileIndex = static_cast<std::size_t>(std::ceil(settings.levelProportion * particles)) - 1;
+            double level = sortedScores[std::min(quantileIndex, particles - 1)];
+            if (!(level < previousLevel))
+            {
+                //most clones never get below their start level: take the largest minimum that does
+                auto below = std::lower_bound(sortedScores.begin(), sortedScores.end(), previousLevel);
+                if (below != sortedScores.begin()) level = *(below - 1);
+            }
+
+            //enough particles reach the event: the last stage
+            if (level <= threshold)
+            {
+                std::size_t reached = std::count_if(minimumScores.begin(), minimumScores.end(), [&](double score) { return score <= threshold; });
+                result.probability = probability * reached / particles;
+                result.converged = true;
+                return result;
+            }
+            //no particle gets below the previous level, or too many levels
+            if (!(level < previousLevel) || stage >= settings.maxLevels)
+            {
+                result.probability = probability * std::count_if(minimumScores.begin(), minimumScores.end(),
+                    [&](double score) { return score <= threshold; }) / particles;
+                return result;
+            }
+
+            std::vector<std::size_t> survivors;
+            for (std::size_t particle = 0; particle < particles; ++particle)
+            {
+                if (minimumScores[particle] <= level) survivors.push_back(particle);
+            }
+            double levelProbability = static_cast<double>(survivors.size()) / particles;
+            probability *= levelProbability;
+            result.levels.push_back(level);
+            result.levelProbabilities.push_back(levelProbability);
+            previousLevel = level;
+
+            //replay the survivors on the same stream to clone them where they first reached the level
+            std::vector<State> clones(survivors.size(), initialState);
+            std::vector<std::size_t> replaySteps(survivors.size(), 0);
+            pool.parallelFor(survivors.size(), [&](std::size_t i)
+            {
+                clones[i] = startStates[survivors[i]];
+                simulate(clones[i], firstStream + static_cast<std::uint32_t>(survivors[i]), level, replaySteps[i]);
+            });
+            for (std::size_t i = 0; i < survivors.size(); ++i) result.simulatedSteps += replaySteps[i];
+
+            //every clone is used particles / survivors times, the remainder is drawn without replacement
+            std::vector<std::size_t> order(survivors.size());
+            for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::shuffle(order.begin(), order.end(), resampler);
+            for (std::size_t particle = 0; particle < particles; ++particle)
+            {
+                startStates[particle] = clones[order[particle % order.size()]];
+            }
+        }
+    }
+
+private:
+    SplittingSettings settings;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EnvironmentalForcing.h" //MappedFile
+#include "Fishery.h"
+#include "ThreadPool.h"
+
+/**
+ * @class NoiseTape
+ * @brief The pre-generated noise of an ensemble (common random numbers): the standard normal draws of every
+ * replicate, in a binary file that is memory-mapped read-only.
+ *
+ * Row r holds the first drawsPerReplicate draws of the Fishery noise stream (seed, r), so an ensemble reading
+ * its noise from the tape gives the same results as one drawing it, with no generator work (not even the
+ * reseeding) per replicate and scenario. Every scenario of a sweep, every thread and every process using the
+ * tape read the same mapped pages, so harvest rules are compared on identical realizations.
+ *
+ * The layout is a 32-byte header followed by the draws as native (little-endian) doubles, replicate-major:
+ *     char magic[8] = "FSNTAPE1", uint64 replicateCount, uint64 drawsPerReplicate, uint32 seed,
+ *     uint32 reserved (0), then draws[replicate * drawsPerReplicate + draw].
+ */
+class NoiseTape
+{
+public:
+    NoiseTape(const NoiseTape&) = delete;
+    NoiseTape& operator=(const NoiseTape&) = delete;
+
+    /**
+     * @brief Generates a tape file, in parallel blocks of replicates.
+     * @return True if the file was written, false (after printing an error) otherwise.
+     */
+    static bool generate(const std::string& filename, std::uint32_t seed, std::size_t replicates, std::size_t drawsPerReplicate, ThreadPool& pool)
+    {
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Error: Could not open noise tape file for writing: " << filename << std::endl;
+            return false;
+        }
+
+        char header[headerSize] = {};
+        std::uint64_t replicateCount = replicates;
+        std::uint64_t draws = drawsPerReplicate;
+        std::memcpy(header, "FSNTAPE1", 8);
+        std::memcpy(header + 8, &replicateCount, sizeof(replicateCount));
+        std::memcpy(header + 16, &draws, sizeof(draws));
+        std::memcpy(header + 24, &seed, sizeof(seed));
+        file.write(header, headerSize);
+
+        //the blocks are written in order, so the file does not depend on the thread count
+        const std::size_t blockReplicates = 1024;
+        std::vector<double> block(std::min(replicates, blockReplicates) * drawsPerReplicate);
+        for (std::size_t first = 0; first < replicates; first += blockReplicates)
+        {
+            std::size_t count = std::min(blockReplicates, replicates - first);
+            pool.parallelFor(count, [&](std::size_t i)
+            {
+                Fishery fishery;
+                fishery.setSeed(seed, static_cast<std::uint32_t>(first + i));
+                fishery.fillStandardNormals(&block[i * drawsPerReplicate], drawsPerReplicate);
+            });
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(count * drawsPerReplicate * sizeof(double)));
+        }
+
+        if (!file)
+        {
+            std::cout << "Error: Could not write noise tape file: " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Maps a tape file.
+     * @return The tape, or nullptr (after printing an error) if the file is missing or malformed.
+     */
+    static std::shared_ptr<const NoiseTape> load(const std::string& filename)
+    {
+        std::shared_ptr<NoiseTape> tape(new NoiseTape());
+        if (!tape->file.open(filename))
+        {
+            std::cout << "Error: Could not open noise tape file: " << filename << std::endl;
+            return nullptr;
+        }
+
+        std::uint64_t replicateCount = 0;
+        std::uint64_t draws = 0;
+        const char* header = tape->file.data();
+        if (tape->file.size() < headerSize || std::memcmp(header, "FSNTAPE1", 8) != 0)
+        {
+            std::cout << "Error: " << filename << " is not a noise tape file." << std::endl;
+            return nullptr;
+        }
+        std::memcpy(&replicateCount, header + 8, sizeof(replicateCount));
+        std::memcpy(&draws, header + 16, sizeof(draws));
+        std::memcpy(&tape->seed, header + 24, sizeof(tape->seed));
+        if (draws == 0 || (tape->file.size() - headerSize) / sizeof(double) / draws < replicateCount)
+        {
+            std::cout << "Error: Noise tape file " << filename << " is shorter than its header states." << std::endl;
+            return nullptr;
+        }
+
+        //the mapping is page aligned and the header keeps the draws 8-byte aligned
+        tape->replicateCount = static_cast<std::size_t>(replicateCount);
+        tape->drawsPerReplicate = static_cast<std::size_t>(draws);
+        tape->draws = reinterpret_cast<const double*>(header + headerSize);
+        return tape;
+    }
+
+    std::size_t getReplicateCount() const { return replicateCount; }
+    std::size_t getDrawsPerReplicate() const { return drawsPerReplicate; }
+    std::uint32_t getSeed() const { return seed; }
+
+    /**
+     * @brief The drawsPerReplicate draws of a replicate's noise stream.
+     */
+    const double* getDraws(std::size_t replicate) const
+    {
+        return draws + replicate * drawsPerReplicate;
+    }
+
+private:
+    static const std::size_t headerSize = 32;
+
+    NoiseTape() = default;
+
+    MappedFile file;
+    const double* draws = nullptr;
+    std::size_t replicateCount = 0;
+    std::size_t drawsPerReplicate = 0;
+    std::uint32_t seed = 0;
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+/*  Online (streaming) reducers for ensemble outputs.
+*   Every reducer consumes one value at a time in constant memory and can be merged with another
+*   reducer of the same kind, so each thread reduces its own replicates and the partial results are
+*   merged at the end without storing trajectories.
+*/
+
+/**
+ * @class RunningMoments
+ * @brief Count, mean, variance (Welford), minimum and maximum of a stream of values.
+ */
+class RunningMoments
+{
+public:
+    void add(double value)
+    {
+        ++count;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    /**
+     * @brief Combines the moments of another stream into this one (Chan et al. parallel update).
+     */
+    void merge(const RunningMoments& other)
+    {
+        if (other.count == 0) return;
+        if (count == 0)
+        {
+            *this = other;
+            return;
+        }
+
+        double total = static_cast<double>(count + other.count);
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+        count += other.count;
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    std::size_t getCount() const { return count; }
+    double getMean() const { return mean; }
+    double getVariance() const { return (count > 1) ? m2 / (count - 1) : 0.0; }
+    double getStdDev() const { return std::sqrt(getVariance()); }
+    double getMin() const { return count > 0 ? minimum : 0.0; }
+    double getMax() const { return count > 0 ? maximum : 0.0; }
+
+private:
+    std::size_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @class TDigest
+ * @brief Mergeable quantile sketch (merging t-digest, Dunning & Ertl).
+ * Values are clustered into centroids whose size is bounded by q(1 - q), so the tails are kept at a much
+ * finer resolution than the median. Memory is O(compression) regardless of the number of values.
+ */
+class TDigest
+{
+public:
+    explicit TDigest(double compression = 100.0) : compression(compression) {}
+
+    void add(double value)
+    {
+        buffer.push_back({ value, 1.0 });
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+        if (buffer.size() >= bufferLimit()) compress();
+    }
+
+    void merge(const TDigest& other)
+    {
+        buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+        buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+        compress();
+    }
+
+    /**
+     * @brief Returns the estimated q-quantile (0 <= q <= 1), or NaN if no values were added.
+     */
+    double quantile(double q)
+    {
+        compress();
+        if (centroids.empty()) return std::numeric_limits<double>::quiet_NaN();
+        if (centroids.size() == 1) return centroids[0].mean;
+
+        q = std::min(1.0, std::max(0.0, q));
+        double index = q * totalWeight;
+
+        //below the center of the first centroid, interpolate from the minimum
+        if (index < centroids.front().weight / 2.0)
+        {
+            return minimum + (centroids.front().mean - minimum) * index / (centroids.front().weight / 2.0);
+        }
+
+        double cumulative = 0.0;
+        for (std::size_t i = 0; i + 1 < centroids.size(); ++i)
+        {
+            double center = cumulative + centroids[i].weight / 2.0;
+            double nextCenter = cumulative + centroids[i].weight + centroids[i + 1].weight / 2.0;
+            if (index <= nextCenter)
+            {
+                double t = (index - center) / (nextCenter - center);
+                return centroids[i].mean + t * (centroids[i + 1].mean - centroids[i].mean);
+            }
+            cumulative += centroids[i].weight;
+        }
+
+        //above the center of the last centroid, interpolate to the maximum
+        const Centroid& last = centroids.back();
+        double center = totalWeight - last.weight / 2.0;
+        double t = (index - center) / (last.weight / 2.0);
+        return last.mean + std::min(1.0, t) * (maximum - last.mean);
+    }
+
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    std::size_t bufferLimit() const { return static_cast<std::size_t>(5.0 * compression); }
+
+    //merges the buffered values into the centroid list
+    void compress()
+    {
+        if (buffer.empty()) return;
+
+        buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+        std::sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+        totalWeight = 0.0;
+        for (const Centroid& c : buffer) totalWeight += c.weight;
+
+        centroids.clear();
+        Centroid current = buffer[0];
+        double weightSoFar = 0.0;
+        for (std::size_t i = 1; i < buffer.size(); ++i)
+        {
+            double proposed = current.weight + buffer[i].weight;
+            double q0 = weightSoFar / totalWeight;
+            double q2 = (weightSoFar + proposed) / totalWeight;
+            double limit = 4.0 * totalWeight * std::min(q0 * (1.0 - q0), q2 * (1.0 - q2)) / compression;
+
+            if (proposed <= limit)
+            {
+                current.mean += (buffer[i].mean - current.mean) * buffer[i].weight / proposed;
+                current.weight = proposed;
+            }
+            else
+            {
+                weightSoFar += current.weight;
+                centroids.push_back(current);
+                current = buffer[i];
+            }
+        }
+        centroids.push_back(current);
+        buffer.clear();
+    }
+
+    double compression;
+    double totalWeight = 0.0;
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+    std::vector<Centroid> centroids;
+    std::vector<Centroid> buffer;
+};
+
+/**
+ * @class FixedHistogram
+ * @brief Histogram with equal-width bins on [lower, upper), plus underflow and overflow counts.
+ */
+class FixedHistogram
+{
+public:
+    FixedHistogram() : lower(0.0), upper(0.0) {}
+
+    FixedHistogram(double lower, double upper, std::size_t bins)
+        : lower(lower), upper(upper), counts(bins, 0) {}
+
+    bool isEnabled() const { return !counts.empty(); }
+
+    void add(double value)
+    {
+        if (counts.empty()) return;
+        if (value < lower)
+        {
+            ++underflow;
+        }
+        else if (value >= upper)
+        {
+            ++overflow;
+        }
+        else
+        {
+            std::size_t bin = static_cast<std::size_t>((value - lower) / (upper - lower) * counts.size());
+            ++counts[std::min(bin, counts.size() - 1)];
+        }
+    }
+
+    void merge(const FixedHistogram& other)
+    {
+        if (counts.empty())
+        {
+            *this = other;
+            return;
+        }
+        for (std::size_t i = 0; i < counts.size() && i < other.counts.size(); ++i) counts[i] += other.counts[i];
+        underflow += other.underflow;
+        overflow += other.overflow;
+    }
+
+    std::size_t getBinCount() const { return counts.size(); }
+    double getBinLower(std::size_t bin) const { return lower + (upper - lower) * bin / counts.size(); }
+    double getBinUpper(std::size_t bin) const { return lower + (upper - lower) * (bin + 1) / counts.size(); }
+    std::size_t getCount(std::size_t bin) const { return counts[bin]; }
+    std::size_t getUnderflow() const { return underflow; }
+    std::size_t getOverflow() const { return overflow; }
+
+private:
+    double lower;
+    double upper;
+    std::vector<std::size_t> counts;
+    std::size_t underflow = 0;
+    std::size_t overflow = 0;
+};
+
+/**
+ * @class EnsembleStatistics
+ * @brief Per-year streaming statistics of several model outputs over an ensemble of replicates.
+ * Holds moments, a quantile sketch and optionally a histogram for every (output, year) pair.
+ */
+class EnsembleStatistics
+{
+public:
+    /**
+     * @param variableNames The names of the recorded outputs.
+     * @param years The number of recorded years after year 0 (years + 1 values per output and replicate).
+     * @param histograms One histogram template per output (a default-constructed histogram disables it).
+     */
+    EnsembleStatistics(const std::vector<std::string>& variableNames, int years, const std::vector<FixedHistogram>& histograms)
+        : variableNames(variableNames), years(years)
+    {
+        std::size_t cells = variableNames.size() * (years + 1);
+        moments.resize(cells);
+        digests.resize(cells);
+        this->histograms.resize(cells);
+        for (std::size_t v = 0; v < variableNames.size(); ++v)
+        {
+            for (int year = 0; year <= years; ++year)
+            {
+                if (v < histograms.size()) this->histograms[cell(v, year)] = histograms[v];
+            }
+        }
+    }
+
+    /**
+     * @brief Adds one replicate. values is laid out year-major: values[year * variables + variable].
+     */
+    void addReplicate(const std::vector<double>& values)
+    {
+        std::size_t variables = variableNames.size();
+        for (int year = 0; year <= years; ++year)
+        {
+            for (std::size_t v = 0; v < variables; ++v)
+            {
+                double value = values[year * variables + v];
+                std::size_t c = cell(v, year);
+                moments[c].add(value);
+                digests[c].add(value);
+                histograms[c].add(value);
+            }
+        }
+        ++replicates;
+    }
+
+    void merge(const EnsembleStatistics& other)
+    {
+        for (std::size_t c = 0; c < moments.size(); ++c)
+        {
+            moments[c].merge(other.moments[c]);
+            digests[c].merge(other.digests[c]);
+            histograms[c].merge(other.histograms[c]);
+        }
+        replicates += other.replicates;
+    }
+
+    const std::vector<std::string>& getVariableNames() const { return variableNames; }
+    int getYears() const { return years; }
+    std::size_t getReplicates() const { return replicates; }
+
+    const RunningMoments& getMoments(std::size_t variable, int year) const { return moments[cell(variable, year)]; }
+    double getQuantile(std::size_t variable, int year, double q) { return digests[cell(variable, year)].quantile(q); }
+    const FixedHistogram& getHistogram(std::size_t variable, int year) const { return histograms[cell(variable, year)]; }
+
+private:
+    std::size_t cell(std::size_t variable, int year) const { return variable * (years + 1) + year; }
+
+    std::vector<std::string> variableNames;
+    int years;
+    std::size_t replicates = 0;
+    std::vector<RunningMoments> moments;
+    std::vector<TDigest> digests;
+    std::vector<FixedHistogram> histograms;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "ThreadPool.h"
+
+/**
+ * @brief Settings of a particle filter.
+ */
+struct ParticleFilterSettings
+{
+    std::size_t particles = 10000;
+
+    //the particles are resampled when the effective sample size falls below this fraction of the particles
+    //(1 resamples after every observation, 0 never)
+    double resampleThreshold = 0.5;
+
+    //the particles propagated together on one noise stream; fixed so the results do not depend on the thread count
+    std::size_t chunkSize = 256;
+
+    //the seed of the noise streams and of the resampling
+    std::uint32_t seed = 0;
+};
+
+/**
+ * @brief The outcome of the assimilation of one observation.
+ */
+struct ParticleFilterUpdate
+{
+    //log p(observation | previous observations), the increment of the marginal log-likelihood
+    double logLikelihood = 0.0;
+
+    //the effective sample size 1 / sum(w^2) after weighting, before any resampling
+    double effectiveSampleSize = 0.0;
+
+    bool resampled = false;
+};
+
+/**
+ * @brief Draws the systematic resample of normalized weights: one uniform u in [0, 1/n) and the n points
+ * u + i/n are located in the cumulative weights, so particle p is copied floor(n w_p) or ceil(n w_p) times.
+ * @param offset A uniform draw in [0, 1).
+ * @param outIndices (Output) The ancestor of every resampled particle, in increasing order.
+ */
+inline void systematicResample(const std::vector<double>& weights, double offset, std::vector<std::size_t>& outIndices)
+{
+    std::size_t n = weights.size();
+    outIndices.resize(n);
+    double cumulative = weights.empty() ? 0.0 : weights[0];
+    std::size_t ancestor = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        double point = (i + offset) / n;
+        while (point > cumulative && ancestor + 1 < n) cumulative += weights[++ancestor];
+        outIndices[i] = ancestor;
+    }
+}
+
+/**
+ * @brief The weighted quantile of values, the smallest value whose cumulative weight reaches probability.
+ * @param weights Normalized weights.
+ */
+inline double getWeightedQuantile(const std::vector<double>& values, const std::vector<double>& weights, double probability)
+{
+    std::vector<std::size_t> order(values.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return values[a] < values[b]; });
+
+    double cumulative = 0.0;
+    for (std::size_t index : order)
+    {
+        cumulative += weights[index];
+        if (cumulative >= probability) return values[index];
+    }
+    return order.empty() ? 0.0 : values[order.back()];
+}
+
+/**
+ * @class ParticleFilter
+ * @brief A bootstrap particle filter (sequential Monte Carlo) of the hidden state of a stochastic model.
+ *
+ * The particles are stored as a structure of arrays: variable v of particle p is getVariable(v)[p], so a model
+ * step loops over contiguous particles, and resampling copies whole arrays. Each assimilation step propagates
+ * every particle with the model's own stochastic step (predict), weights it by the likelihood of the new
+ * observation (correct), and resamples systematically when the effective sample size has fallen too far.
+ *
+ * The particles are propagated in parallel, in chunks of chunkSize particles. Chunk c of step t draws its noise
+ * from stream t * chunks + c of the seed, and the resampling from its own generator, so the results do not
+ * depend on the thread count.
+ */
+class ParticleFilter
+{
+public:
+    /**
+     * @brief Advances the particles [begin, end) by one assimilation step, drawing their noise from the given stream.
+     * Called concurrently for disjoint ranges.
+     */
+    using Propagator = std::function<void(ParticleFilter& filter, std::size_t begin, std::size_t end, std::uint32_t stream)>;
+
+    /**
+     * @param initialState The starting value of every variable, shared by all the particles.
+     */
+    ParticleFilter(const ParticleFilterSettings& settings, const std::vector<double>& initialState)
+        : settings(settings), particles(std::max<std::size_t>(1, settings.particles)), variables(initialState.size()),
+        values(variables * particles), scratch(variables * particles), weights(particles, 1.0 / particles),
+        logWeights(particles, 0.0)
+    {
+        this->settings.chunkSize = std::max<std::size_t>(1, settings.chunkSize);
+        for (std::size_t v = 0; v < variables; ++v)
+        {
+            std::fill(getVariable(v), getVariable(v) + particles, initialState[v]);
+        }
+        std::seed_seq resamplerSeed{ settings.seed, 0x5F11u };
+        resampler.seed(resamplerSeed);
+    }
+
+    std::size_t getParticleCount() const { return particles; }
+    std::size_t getVariableCount() const { return variables; }
+    double* getVariable(std::size_t v) { return &values[v * particles]; }
+    const double* getVariable(std::size_t v) const { return &values[v * particles]; }
+
+    //the normalized weights of the particles
+    const std::vector<double>& getWeights() const { return weights; }
+
+    /**
+     * @brief Propagates every particle by one step.
+     */
+    void predict(const Propagator& propagate, ThreadPool& pool)
+    {
+        std::size_t chunks = (particles + settings.chunkSize - 1) / settings.chunkSize;
+        std::uint32_t firstStream = static_cast<std::uint32_t>(steps * chunks);
+        pool.parallelFor(chunks, [&](std::size_t chunk)
+        {
+            std::size_t begin = chunk * settings.chunkSize;
+            std::size_t end = std::min(particles, begin + settings.chunkSize);
+            propagate(*this, begin, end, firstStream + static_cast<std::uint32_t>(chunk));
+        });
+        ++steps;
+    }
+
+    /**
+     * @brief Weights the particles by the likelihood of an observation, then resamples them if needed.
+     * @param observationLogLikelihood log p(observation | particle) of every particle; -infinity for impossible particles.
+     */
+    ParticleFilterUpdate correct(const std::vector<double>& observationLogLikelihood)
+    {
+        ParticleFilterUpdate update;
+        double maxLog = -std::numeric_limits<double>::infinity();
+        for (std::size_t p = 0; p < particles; ++p)
+        {
+            logWeights[p] += observationLogLikelihood[p];
+            maxLog = std::max(maxLog, logWeights[p]);
+        }
+
+        //every particle is impossible: keep the prediction rather than lose the filter
+        if (!std::isfinite(maxLog))
+        {
+            std::fill(logWeights.begin(), logWeights.end(), 0.0);
+            std::fill(weights.begin(), weights.end(), 1.0 / particles);
+            update.logLikelihood = -std::numeric_limits<double>::infinity();
+            update.effectiveSampleSize = 0.0;
+            return update;
+        }
+
+        //log-sum-exp normalization; the previous weights were normalized, so their sum is the likelihood increment
+        double sum = 0.0;
+        for (std::size_t p = 0; p < particles; ++p)
+        {
+            weights[p] = std::exp(logWeights[p] - maxLog);
+            sum += weights[p];
+        }
+        double sumSquares = 0.0;
+        for (std::size_t p = 0; p < particles; ++p)
+        {
+            weights[p] /= sum;
+            logWeights[p] = std::log(weights[p]) + std::log(static_cast<double>(particles));
+            sumSquares += weights[p] * weights[p];
+        }
+        update.logLikelihood = maxLog + std::log(sum) - std::log(static_cast<double>(particles));
+        update.effectiveSampleSize = 1.0 / sumSquares;
+
+        if (update.effectiveSampleSize < settings.resampleThreshold * particles)
+        {
+            resample();
+            update.resampled = true;
+        }
+        return update;
+    }
+
+    /**
+     * @brief The weighted mean of a variable.
+     */
+    double getMean(std::size_t v) const
+    {
+        const double* x = getVariable(v);
+        double mean = 0.0;
+        for (std::size_t p = 0; p < particles; ++p) mean += weights[p] * x[p];
+        return mean;
+    }
+
+    /**
+     * @brief The weighted quantile of a variable.
+     */
+    double getQuantile(std::size_t v, double probability) const
+    {
+        const double* x = getVariable(v);
+        return getWeightedQuantile(std::vector<double>(x, x + particles), weights, probability);
+    }
+
+private:
+    void resample()
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        systematicResample(weights, uniform(resampler), ancestors);
+
+        for (std::size_t v = 0; v < variables; ++v)
+        {
+            const double* from = getVariable(v);
+            double* to = &scratch[v * particles];
+            for (std::size_t p = 0; p < particles; ++p) to[p] = from[ancestors[p]];
+        }
+        values.swap(scratch);
+        std::fill(weights.begin(), weights.end(), 1.0 / particles);
+        std::fill(logWeights.begin(), logWeights.end(), 0.0);
+    }
+
+    ParticleFilterSettings settings;
+    std::size_t particles;
+    std::size_t variables;
+
+    //variable-major: values[v * particles + p]
+    std::vector<double> values;
+    std::vector<double> scratch;
+
+    //the normalized weights, and their logarithms scaled so that equal weights are 0
+    std::vector<double> weights;
+    std::vector<double> logWeights;
+
+    std::vector<std::size_t> ancestors;
+    std::mt19937 resampler;
+    std::size_t steps = 0;
+};
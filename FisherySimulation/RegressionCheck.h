@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The reference outputs of one regression case: the trajectories of a model run with a fixed seed.
+ */
+struct GoldenCase
+{
+    //the case name, e.g. "ageStructuredModel/float32"
+    std::string name;
+
+    //the model section the outputs were recorded with, as compact JSON
+    std::string parameters;
+
+    std::size_t replicates = 0;
+
+    //the number of outputs per year
+    std::size_t variables = 0;
+
+    //replicate-major trajectories, values[(replicate * years + year) * variables + variable]
+    std::vector<double> values;
+};
+
+/**
+ * @brief The distance between two doubles in units in the last place (0 when bitwise equal, or for +0 and -0).
+ * The bit patterns are mapped to integers that are ordered like the values, so the distance counts the
+ * representable doubles between them. NaNs are infinitely far from everything.
+ */
+inline std::uint64_t getUlpDistance(double a, double b)
+{
+    if (a != a || b != b) return UINT64_MAX;
+    std::int64_t ia;
+    std::int64_t ib;
+    std::memcpy(&ia, &a, sizeof(a));
+    std::memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = INT64_MIN - ia;
+    if (ib < 0) ib = INT64_MIN - ib;
+    return (ia > ib) ? static_cast<std::uint64_t>(ia) - static_cast<std::uint64_t>(ib) : static_cast<std::uint64_t>(ib) - static_cast<std::uint64_t>(ia);
+}
+
+/**
+ * @brief The distance between two floats in units in the last place of float.
+ */
+inline std::uint64_t getUlpDistance(float a, float b)
+{
+    if (a != a || b != b) return UINT64_MAX;
+    std::int32_t ia;
+    std::int32_t ib;
+    std::memcpy(&ia, &a, sizeof(a));
+    std::memcpy(&ib, &b, sizeof(b));
+    std::int64_t orderedA = (ia < 0) ? std::int64_t(INT32_MIN) - ia : ia;
+    std::int64_t orderedB = (ib < 0) ? std::int64_t(INT32_MIN) - ib : ib;
+    return static_cast<std::uint64_t>(orderedA > orderedB ? orderedA - orderedB : orderedB - orderedA);
+}
+
+/**
+ * @brief Writes reference outputs. Values are printed with 17 significant digits, which round-trips
+ * every double (and so every float) exactly.
+ * The file has a "Seed,<seed>" line, then per case a "Case,<name>,<replicates>,<variables>,<parameters>"
+ * line followed by one "<replicate>,<year>,<values...>" row per simulated year.
+ * @return True if the file was written.
+ */
+inline bool saveGoldenOutputs(const std::string& filename, std::uint32_t seed, const std::vector<GoldenCase>& cases)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "Error: Could not open reference file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    file << "# Reference outputs of the regression check (regressionCheck in parameters.json)\n";
+    file << "# Record them again on purpose only, after checking that a change of the outputs is intended.\n";
+    file << "Seed," << seed << "\n";
+    file << std::setprecision(17);
+    for (const GoldenCase& golden : cases)
+    {
+        file << "Case," << golden.name << "," << golden.replicates << "," << golden.variables << "," << golden.parameters << "\n";
+        std::size_t years = golden.values.size() / (golden.replicates * golden.variables);
+        for (std::size_t replicate = 0; replicate < golden.replicates; ++replicate)
+        {
+            for (std::size_t year = 0; year < years; ++year)
+            {
+                file << replicate << "," << year;
+                for (std::size_t v = 0; v < golden.variables; ++v)
+                {
+                    file << "," << golden.values[(replicate * years + year) * golden.variables + v];
+                }
+                file << "\n";
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads reference outputs written by saveGoldenOutputs. Lines starting with '#' are comments.
+ * @return True if the file was read.
+ */
+inline bool loadGoldenOutputs(const std::string& filename, std::uint32_t& outSeed, std::vector<GoldenCase>& outCases)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cout << "Error: Could not open reference file: " << filename << std::endl;
+        return false;
+    }
+
+    outCases.clear();
+    outSeed = 0;
+    std::string line;
+    try
+    {
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+
+            if (line.compare(0, 5, "Seed,") == 0)
+            {
+                outSeed = static_cast<std::uint32_t>(std::stoul(line.substr(5)));
+            }
+            else if (line.compare(0, 5, "Case,") == 0)
+            {
+                //the parameters come last, since their JSON contains commas
+                std::stringstream ss(line.substr(5));
+                GoldenCase golden;
+                std::string cell;
+                std::getline(ss, golden.name, ',');
+                std::getline(ss, cell, ',');
+                golden.replicates = std::stoul(cell);
+                std::getline(ss, cell, ',');
+                golden.variables = std::stoul(cell);
+                std::getline(ss, golden.parameters);
+                outCases.push_back(golden);
+            }
+            else
+            {
+                if (outCases.empty()) throw std::invalid_argument("values before the first case");
+                std::stringstream ss(line);
+                std::string cell;
+                std::getline(ss, cell, ','); //replicate
+                std::getline(ss, cell, ','); //year
+                while (std::getline(ss, cell, ','))
+                {
+                    //strtod keeps subnormal values, where stod reports a range error
+                    outCases.back().values.push_back(std::strtod(cell.c_str(), nullptr));
+                }
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Error: Invalid reference file " << filename << " (" << e.what() << ")." << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "AgeStructuredModel.h"
+
+/**
+ * @class SeasonalAgeModel
+ * @brief Sub-annual version of the age-structured model with a configurable number of seasons per year.
+ * Natural and fishing mortality are applied once per season, with the fishing mortality of each season
+ * scaled by a seasonal pattern, and the weight used for the catch follows the von Bertalanffy curve
+ * through the year (fractional ages). Cohorts age and recruits enter at the end of the year, as in
+ * AgeStructuredModelStep, so one season with a flat pattern reproduces the annual model.
+ *
+ * All exp/pow work is done once in the constructor: per season and age the survival e^-Z and the catch
+ * factor (F / Z)(1 - e^-Z) W are tabulated in contiguous arrays, and the season step is a branch-free
+ * elementwise loop over ages that compilers can vectorize.
+ */
+class SeasonalAgeModel
+{
+public:
+    /**
+     * @param params The age-structured model parameters (annual rates).
+     * @param seasonsPerYear The number of time steps per year (e.g. 4 or 12).
+     * @param seasonalFishingPattern Relative fishing intensity of each season. It is normalized to a mean
+     *        of 1, so the annual fishing mortality is params.fishingMortality. Empty means a flat pattern.
+     */
+    SeasonalAgeModel(const AgeModelParameters<double>& params, int seasonsPerYear, std::vector<double> seasonalFishingPattern)
+        : maxAge(params.maxAge), ages(params.maxAge + 1), seasons(seasonsPerYear)
+    {
+        if (seasonsPerYear < 1)
+        {
+            throw std::invalid_argument("SeasonalAgeModel needs at least one season per year.");
+        }
+        if (seasonalFishingPattern.empty())
+        {
+            seasonalFishingPattern.assign(seasons, 1.0);
+        }
+        if (static_cast<int>(seasonalFishingPattern.size()) != seasons)
+        {
+            throw std::invalid_argument("SeasonalAgeModel: the seasonal fishing pattern needs one value per season.");
+        }
+
+        double patternSum = 0.0;
+        for (double weight : seasonalFishingPattern) patternSum += weight;
+        if (!(patternSum > 0.0))
+        {
+            throw std::invalid_argument("SeasonalAgeModel: the seasonal fishing pattern must have a positive sum.");
+        }
+
+        double dt = 1.0 / seasons;
+        survival.assign(seasons * ages, 1.0);
+        catchFactor.assign(seasons * ages, 0.0);
+        seasonWeight.assign(seasons * ages, 0.0);
+        seasonSsbWeight.assign(seasons * ages, 0.0);
+
+        for (int age = 0; age <= maxAge; ++age)
+        {
+            double selectivity = getSelectivityAtAge(age, params);
+            double maturity = getMaturityAtAge(age, params);
+
+            for (int season = 0; season < seasons; ++season)
+            {
+                double patternWeight = seasonalFishingPattern[season] * seasons / patternSum;
+                double F = params.fishingMortality * selectivity * patternWeight * dt;
+                double Z = params.naturalMortality * dt + F;
+
+                //weight at the start of the season, from the growth curve at the fractional age
+                std::size_t index = season * ages + age;
+                seasonWeight[index] = getWeightAtFractionalAge(age + season * dt, params);
+                seasonSsbWeight[index] = seasonWeight[index] * maturity;
+
+                survival[index] = std::exp(-Z);
+                catchFactor[index] = (Z > 0.0) ? (F / Z) * (1.0 - survival[index]) * seasonWeight[index] : 0.0;
+            }
+        }
+    }
+
+    int getSeasonsPerYear() const { return seasons; }
+
+    /**
+     * @brief Applies the mortality of one season to the numbers at age.
+     * @param numbersAtAge The numbers at age, updated in place.
+     * @param season The season index in [0, seasonsPerYear).
+     * @param catchAtAge (Output) Scratch array of size maxAge + 1 receiving the catch in biomass per age.
+     * @return The total catch in biomass of the season.
+     */
+    double stepSeason(std::vector<double>& numbersAtAge, int season, std::vector<double>& catchAtAge) const
+    {
+        const double* seasonSurvival = &survival[season * ages];
+        const double* seasonCatch = &catchFactor[season * ages];
+        double* N = numbersAtAge.data();
+        double* C = catchAtAge.data();
+
+        //elementwise over ages, no loop-carried dependencies
+        for (std::size_t age = 0; age < ages; ++age)
+        {
+            C[age] = seasonCatch[age] * N[age];
+            N[age] *= seasonSurvival[age];
+        }
+
+        double totalCatch = 0.0;
+        for (std::size_t age = 0; age < ages; ++age)
+        {
+            totalCatch += C[age];
+        }
+        return totalCatch;
+    }
+
+    /**
+     * @brief Ages every cohort by one year, merges the plus group and adds the recruits at age 0.
+     */
+    void advanceYear(std::vector<double>& numbersAtAge, double recruitment) const
+    {
+        double plusGroup = numbersAtAge[maxAge] + numbersAtAge[maxAge - 1];
+        for (int age = maxAge - 1; age > 0; --age)
+        {
+            numbersAtAge[age] = numbersAtAge[age - 1];
+        }
+        numbersAtAge[maxAge] = plusGroup;
+        numbersAtAge[0] = recruitment;
+    }
+
+    /**
+     * @brief Simulates one full year: every season in turn, then the ageing and recruitment.
+     * @param outSeasonCatch (Optional output) The catch in biomass of each season.
+     * @return The total catch in biomass for the year.
+     */
+    double stepYear(std::vector<double>& numbersAtAge, double recruitment, std::vector<double>* outSeasonCatch = nullptr) const
+    {
+        std::vector<double> catchAtAge(ages);
+        double totalCatch = 0.0;
+        for (int season = 0; season < seasons; ++season)
+        {
+            double seasonCatch = stepSeason(numbersAtAge, season, catchAtAge);
+            if (outSeasonCatch) (*outSeasonCatch)[season] = seasonCatch;
+            totalCatch += seasonCatch;
+        }
+        advanceYear(numbersAtAge, recruitment);
+        return totalCatch;
+    }
+
+    /**
+     * @brief Total biomass at the start of a season (season 0 is the start of the year).
+     */
+    double getTotalBiomass(const std::vector<double>& numbersAtAge, int season = 0) const
+    {
+        return dot(&seasonWeight[season * ages], numbersAtAge.data());
+    }
+
+    /**
+     * @brief Spawning stock biomass at the start of a season (season 0 is the start of the year).
+     */
+    double getSpawningStockBiomass(const std::vector<double>& numbersAtAge, int season = 0) const
+    {
+        return dot(&seasonSsbWeight[season * ages], numbersAtAge.data());
+    }
+
+private:
+    double dot(const double* weights, const double* numbers) const
+    {
+        double sum = 0.0;
+        for (std::size_t age = 0; age < ages; ++age) sum += weights[age] * numbers[age];
+        return sum;
+    }
+
+    static double getWeightAtFractionalAge(double age, const AgeModelParameters<double>& params)
+    {
+        double length = params.vb_Linf * (1.0 - std::exp(-params.vb_k * (age - params.vb_t0)));
+        return params.lw_a * std::pow(length, params.lw_b);
+    }
+
+    int maxAge;
+    std::size_t ages;
+    int seasons;
+
+    //season-major tables, index season * ages + age
+    std::vector<double> survival;
+    std::vector<double> catchFactor;
+    std::vector<double> seasonWeight;
+    std::vector<double> seasonSsbWeight;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "SobolSequence.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief A model input varied by the sensitivity analysis, sampled uniformly on [lower, upper].
+ */
+struct SensitivityParameter
+{
+    std::string name;
+    double lower;
+    double upper;
+};
+
+/**
+ * @brief First and total-order Sobol indices estimated from the samples processed so far.
+ */
+struct SensitivityIndices
+{
+    std::vector<double> firstOrder;
+    std::vector<double> totalOrder;
+    double outputMean = 0.0;
+    double outputVariance = 0.0;
+    std::size_t baseSamples = 0;
+    std::size_t modelRuns = 0;
+};
+
+/**
+ * @class SobolSensitivityAnalysis
+ * @brief Variance-based global sensitivity analysis using the Saltelli sampling scheme.
+ * Every base sample draws two independent parameter sets A and B and evaluates the model on A, B and
+ * the k hybrids AB_i (A with column i taken from B), so N base samples cost N * (k + 2) model runs.
+ * The Jansen estimators are accumulated incrementally, so the indices can be read after every batch.
+ */
+class SobolSensitivityAnalysis
+{
+public:
+    //maps a set of parameter values (in the order of the parameter list) to a scalar model output
+    using ModelFunction = std::function<double(const std::vector<double>&)>;
+
+    /**
+     * @brief Sets up the analysis.
+     * @param parameters The varied parameters and their ranges.
+     * @param model The model evaluation. Called concurrently from the pool threads, so it must be thread safe.
+     * @param seed Seed for the pseudo-random fallback used when 2k exceeds the Sobol sequence dimensions.
+     */
+    SobolSensitivityAnalysis(const std::vector<SensitivityParameter>& parameters, ModelFunction model, std::uint32_t seed = 0)
+        : parameters(parameters), model(model), fallbackRng(seed)
+    {
+        int k = static_cast<int>(parameters.size());
+        if (2 * k <= SobolSequence::maxDimensions())
+        {
+            sequence.reset(new SobolSequence(2 * k));
+        }
+
+        sumFirst.assign(k, 0.0);
+        sumTotal.assign(k, 0.0);
+    }
+
+    /**
+     * @brief Draws batchSize new base samples, evaluates them in parallel and updates the estimators.
+     */
+    void runBatch(std::size_t batchSize, ThreadPool& pool)
+    {
+        std::size_t k = parameters.size();
+        std::size_t runsPerSample = k + 2;
+
+        //build the A, B and AB_i parameter sets for every base sample in the batch
+        std::vector<std::vector<double>> inputs(batchSize * runsPerSample, std::vector<double>(k));
+        std::vector<double> point;
+        for (std::size_t s = 0; s < batchSize; ++s)
+        {
+            drawPoint(point);
+
+            std::vector<double>* runs = &inputs[s * runsPerSample];
+            for (std::size_t i = 0; i < k; ++i)
+            {
+                double a = scale(i, point[i]);
+                double b = scale(i, point[k + i]);
+                runs[0][i] = a;
+                runs[1][i] = b;
+                for (std::size_t j = 0; j < k; ++j)
+                {
+                    runs[2 + j][i] = (i == j) ? b : a;
+                }
+            }
+        }
+
+        std::vector<double> outputs(inputs.size());
+        pool.parallelFor(inputs.size(), [&](std::size_t run) { outputs[run] = model(inputs[run]); });
+
+        //accumulate in sample order so the estimates do not depend on thread scheduling
+        for (std::size_t s = 0; s < batchSize; ++s)
+        {
+            const double* y = &outputs[s * runsPerSample];
+            double fA = y[0];
+            double fB = y[1];
+            addToVariance(fA);
+            addToVariance(fB);
+
+            for (std::size_t i = 0; i < k; ++i)
+            {
+                double fABi = y[2 + i];
+                sumFirst[i] += (fB - fABi) * (fB - fABi);
+                sumTotal[i] += (fA - fABi) * (fA - fABi);
+            }
+            ++baseSamples;
+        }
+    }
+
+    /**
+     * @brief Returns the current estimates of the first and total-order indices.
+     */
+    SensitivityIndices getIndices() const
+    {
+        SensitivityIndices indices;
+        std::size_t k = parameters.size();
+        indices.baseSamples = baseSamples;
+        indices.modelRuns = baseSamples * (k + 2);
+        indices.outputMean = mean;
+        indices.outputVariance = (outputCount > 1) ? m2 / (outputCount - 1) : 0.0;
+        indices.firstOrder.assign(k, 0.0);
+        indices.totalOrder.assign(k, 0.0);
+
+        if (baseSamples == 0 || indices.outputVariance <= 0.0) return indices;
+
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            //Jansen (1999) estimators
+            indices.firstOrder[i] = 1.0 - 0.5 * (sumFirst[i] / baseSamples) / indices.outputVariance;
+            indices.totalOrder[i] = 0.5 * (sumTotal[i] / baseSamples) / indices.outputVariance;
+        }
+        return indices;
+    }
+
+    const std::vector<SensitivityParameter>& getParameters() const { return parameters; }
+
+private:
+    //next point in [0, 1)^(2k), from the Sobol sequence when it has enough dimensions
+    void drawPoint(std::vector<double>& point)
+    {
+        if (sequence)
+        {
+            sequence->next(point);
+            return;
+        }
+
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        point.resize(2 * parameters.size());
+        for (double& value : point)
+        {
+            value = dist(fallbackRng);
+        }
+    }
+
+    double scale(std::size_t i, double u) const
+    {
+        return parameters[i].lower + u * (parameters[i].upper - parameters[i].lower);
+    }
+
+    //welford update of the output mean and variance
+    void addToVariance(double y)
+    {
+        ++outputCount;
+        double delta = y - mean;
+        mean += delta / outputCount;
+        m2 += delta * (y - mean);
+    }
+
+    std::vector<SensitivityParameter> parameters;
+    ModelFunction model;
+
+    std::unique_ptr<SobolSequence> sequence;
+    std::mt19937 fallbackRng;
+
+    //running sums of the squared differences used by the estimators
+    std::vector<double> sumFirst;
+    std::vector<double> sumTotal;
+    std::size_t baseSamples = 0;
+
+    //output variance over both the A and B samples
+    std::size_t outputCount = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+};
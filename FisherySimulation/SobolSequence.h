@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @class SobolSequence
+ * @brief Generates points of the Sobol low-discrepancy sequence in the unit hypercube [0, 1)^d.
+ * Uses the Joe-Kuo direction numbers and the Antonov-Saleev gray code update, so each point costs
+ * one XOR per dimension. Supports up to maxDimensions() dimensions.
+ */
+class SobolSequence
+{
+public:
+    /**
+     * @brief Creates a generator for the given number of dimensions.
+     * @param dimensions The number of coordinates in each point.
+     * @param skip The number of leading points to discard (the first point is always the origin).
+     */
+    explicit SobolSequence(int dimensions, std::uint32_t skip = 1)
+        : dimensions(dimensions), index(0), state(dimensions, 0u), directions(dimensions, std::vector<std::uint32_t>(bits, 0u))
+    {
+        if (dimensions < 1 || dimensions > maxDimensions())
+        {
+            throw std::invalid_argument("SobolSequence supports between 1 and " + std::to_string(maxDimensions()) + " dimensions.");
+        }
+
+        //the first dimension is the van der Corput sequence in base 2
+        for (int k = 0; k < bits; ++k)
+        {
+            directions[0][k] = 1u << (bits - 1 - k);
+        }
+
+        for (int d = 1; d < dimensions; ++d)
+        {
+            const Polynomial& poly = polynomials()[d - 1];
+            int s = poly.degree;
+            std::vector<std::uint32_t>& v = directions[d];
+
+            for (int k = 0; k < s && k < bits; ++k)
+            {
+                v[k] = poly.m[k] << (bits - 1 - k);
+            }
+            //recurrence from the primitive polynomial coefficients
+            for (int k = s; k < bits; ++k)
+            {
+                v[k] = v[k - s] ^ (v[k - s] >> s);
+                for (int i = 1; i < s; ++i)
+                {
+                    if ((poly.a >> (s - 1 - i)) & 1u)
+                    {
+                        v[k] ^= v[k - i];
+                    }
+                }
+            }
+        }
+
+        for (std::uint32_t i = 0; i < skip; ++i)
+        {
+            advance();
+        }
+    }
+
+    static int maxDimensions() { return static_cast<int>(polynomials().size()) + 1; }
+
+    int getDimensions() const { return dimensions; }
+
+    /**
+     * @brief Writes the next point of the sequence into point (resized to the number of dimensions).
+     */
+    void next(std::vector<double>& point)
+    {
+        point.resize(dimensions);
+        for (int d = 0; d < dimensions; ++d)
+        {
+            point[d] = state[d] * normalization;
+        }
+        advance();
+    }
+
+    /**
+     * @brief Computes the point with the given index directly (index 0 is the origin).
+     * Independent of the generator state, so points can be produced out of order by several threads.
+     */
+    void getPoint(std::uint32_t pointIndex, std::vector<double>& point) const
+    {
+        //the gray code update accumulates the direction numbers of the set bits of the gray code of the index
+        std::uint32_t gray = pointIndex ^ (pointIndex >> 1);
+        point.resize(dimensions);
+        for (int d = 0; d < dimensions; ++d)
+        {
+            std::uint32_t value = 0u;
+            for (int k = 0; k < bits; ++k)
+            {
+                if ((gray >> k) & 1u) value ^= directions[d][k];
+            }
+            point[d] = value * normalization;
+        }
+    }
+
+private:
+    struct Polynomial
+    {
+        int degree;
+        std::uint32_t a;
+        std::uint32_t m[7];
+    };
+
+    //primitive polynomials and initial direction numbers for dimensions 2..21 (Joe & Kuo, 2008)
+    static const std::vector<Polynomial>& polynomials()
+    {
+        static const std::vector<Polynomial> table = {
+            { 1, 0,  { 1 } },
+            { 2, 1,  { 1, 3 } },
+            { 3, 1,  { 1, 3, 1 } },
+            { 3, 2,  { 1, 1, 1 } },
+            { 4, 1,  { 1, 1, 3, 3 } },
+            { 4, 4,  { 1, 3, 5, 13 } },
+            { 5, 2,  { 1, 1, 5, 5, 17 } },
+            { 5, 4,  { 1, 1, 5, 5, 5 } },
+            { 5, 7,  { 1, 1, 7, 11, 19 } },
+            { 5, 11, { 1, 1, 5, 1, 1 } },
+            { 5, 13, { 1, 1, 1, 3, 11 } },
+            { 5, 14, { 1, 3, 5, 5, 31 } },
+            { 6, 1,  { 1, 3, 3, 9, 7, 49 } },
+            { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+            { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+            { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+            { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+            { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+            { 7, 1,  { 1, 3, 7, 11, 23, 15, 103 } },
+            { 7, 4,  { 1, 3, 7, 13, 13, 15, 69 } }
+        };
+        return table;
+    }
+
+    //moves the state to the next point using the gray code ordering
+    void advance()
+    {
+        //position of the lowest zero bit of the current index
+        int c = 0;
+        std::uint32_t value = index;
+        while (value & 1u)
+        {
+            value >>= 1;
+            ++c;
+        }
+        if (c >= bits)
+        {
+            throw std::overflow_error("SobolSequence exhausted.");
+        }
+
+        for (int d = 0; d < dimensions; ++d)
+        {
+            state[d] ^= directions[d][c];
+        }
+        ++index;
+    }
+
+    static const int bits = 32;
+    static constexpr double normalization = 1.0 / 4294967296.0; //2^-32
+
+    int dimensions;
+    std::uint32_t index;
+    std::vector<std::uint32_t> state;
+    std::vector<std::vector<std::uint32_t>> directions;
+};
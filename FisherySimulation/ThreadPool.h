@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Tracing.h"
+
+/**
+ * @class ThreadPool
+ * @brief A small fixed-size pool of worker threads used to run independent model evaluations in parallel.
+ * Work is submitted as index ranges through parallelFor, which blocks until every index has been processed.
+ * The calling thread takes part in the work, so a pool of size 1 runs everything on the caller.
+ * With tracing enabled, every parallelFor call and every chunk of indices is recorded on its thread's track.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Creates the pool.
+     * @param threadCount The total number of threads to use, including the caller. 0 uses the hardware concurrency.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        //the calling thread is the last worker
+        for (unsigned int i = 1; i < threadCount; ++i)
+        {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the process-wide pool shared by all parallel analysis modes.
+     */
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /**
+     * @brief The number of threads that take part in a parallelFor call.
+     */
+    std::size_t size() const { return workers.size() + 1; }
+
+    /**
+     * @brief Runs body(index) for every index in [0, count) and waits for all of them to finish.
+     * Indices are handed out in chunks of chunkSize. The first exception thrown by body is rethrown here.
+     * Calls made from inside a running body (nested parallelism) run serially on the calling thread.
+     */
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body, std::size_t chunkSize = 1)
+    {
+        if (count == 0) return;
+
+        if (insideJob())
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                body(i);
+            }
+            return;
+        }
+
+        //only one batch may be in flight at a time
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+        TraceScope trace("ParallelFor", "pool", "count", static_cast<long long>(count));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobBody = &body;
+            jobCount = count;
+            jobChunk = std::max<std::size_t>(1, chunkSize);
+            nextIndex = 0;
+            activeWorkers = workers.size();
+            jobError = nullptr;
+            ++jobGeneration;
+        }
+        wakeWorkers.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        jobFinished.wait(lock, [this]() { return activeWorkers == 0; });
+        jobBody = nullptr;
+
+        if (jobError)
+        {
+            std::rethrow_exception(jobError);
+        }
+    }
+
+private:
+    void workerLoop(unsigned int index)
+    {
+        TraceRecorder::shared().setThreadName("Worker " + std::to_string(index));
+        std::size_t seenGeneration = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorkers.wait(lock, [&]() { return stopping || jobGeneration != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = jobGeneration;
+            }
+
+            runChunks();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activeWorkers == 0)
+            {
+                jobFinished.notify_all();
+            }
+        }
+    }
+
+    //true while the current thread is executing a parallelFor body
+    static bool& insideJob()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    //pulls chunks of indices until the current job is exhausted
+    void runChunks()
+    {
+        insideJob() = true;
+        runChunksUnmarked();
+        insideJob() = false;
+    }
+
+    void runChunksUnmarked()
+    {
+        while (true)
+        {
+            std::size_t begin = nextIndex.fetch_add(jobChunk);
+            if (begin >= jobCount) return;
+            std::size_t end = std::min(jobCount, begin + jobChunk);
+            TraceScope trace("Chunk", "pool", "begin", static_cast<long long>(begin));
+
+            try
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    (*jobBody)(i);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!jobError) jobError = std::current_exception();
+                //skip the remaining work
+                nextIndex = jobCount;
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::mutex submitMutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobFinished;
+    bool stopping = false;
+
+    //the job currently being processed
+    const std::function<void(std::size_t)>* jobBody = nullptr;
+    std::size_t jobCount = 0;
+    std::size_t jobChunk = 1;
+    std::size_t jobGeneration = 0;
+    std::size_t activeWorkers = 0;
+    std::atomic<std::size_t> nextIndex{ 0 };
+    std::exception_ptr jobError;
+};
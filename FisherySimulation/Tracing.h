@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One timed span of a trace: a phase of the simulation on one thread.
+ * The names are string literals, so recording an event copies no text.
+ */
+struct TraceEvent
+{
+    const char* name = "";
+    const char* category = "";
+
+    //microseconds since the recorder started
+    double start = 0.0;
+    double duration = 0.0;
+
+    //an optional integer argument (e.g. the replicate or year), shown when argumentName is not null
+    const char* argumentName = nullptr;
+    long long argument = 0;
+};
+
+/**
+ * @class TraceRecorder
+ * @brief Records timed spans of the simulation phases for a timeline view, written in the Chrome trace JSON
+ * format (opened by chrome://tracing and ui.perfetto.dev) with one track per thread.
+ *
+ * Every thread appends to its own buffer, found through a thread_local pointer, so recording takes no lock: the
+ * recorder's mutex is only taken once per thread, to register its buffer. A buffer holds at most
+ * maxEventsPerThread events, later ones are counted as dropped. When tracing is disabled, a span costs one
+ * relaxed atomic load. The trace must be written while no other thread is recording (e.g. at
+ * the end of the program, with the thread pool idle).
+ */
+class TraceRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Returns the process-wide recorder.
+     */
+    static TraceRecorder& shared()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Starts recording, to be written to filename.
+     */
+    void enable(const std::string& filename, std::size_t maxEventsPerThread)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        traceFile = filename;
+        eventLimit = std::max<std::size_t>(1, maxEventsPerThread);
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    const std::string& getTraceFile() const { return traceFile; }
+
+    /**
+     * @brief Names the track of the calling thread (e.g. "Main", "Worker 3").
+     */
+    void setThreadName(const std::string& name)
+    {
+        getThreadBuffer().name = name;
+    }
+
+    /**
+     * @brief Records a span of the calling thread that began at begin and ends now.
+     */
+    void record(const char* name, const char* category, Clock::time_point begin, const char* argumentName = nullptr, long long argument = 0)
+    {
+        if (!isEnabled()) return;
+        Clock::time_point end = Clock::now();
+
+        ThreadBuffer& buffer = getThreadBuffer();
+        if (buffer.events.size() >= eventLimit)
+        {
+            ++buffer.dropped;
+            return;
+        }
+        if (buffer.events.capacity() == 0) buffer.events.reserve(std::min<std::size_t>(eventLimit, 4096));
+
+        TraceEvent event;
+        event.name = name;
+        event.category = category;
+        event.start = std::chrono::duration<double, std::micro>(begin - epoch).count();
+        event.duration = std::chrono::duration<double, std::micro>(end - begin).count();
+        event.argumentName = argumentName;
+        event.argument = argument;
+        buffer.events.push_back(event);
+    }
+
+    /**
+     * @brief Writes the recorded spans of every thread as a Chrome trace.
+     * @param outEvents (Output) The number of events written.
+     * @param outDropped (Output) The number of events dropped by full buffers.
+     * @return True if the file was written, false if it could not be opened.
+     */
+    bool write(std::size_t& outEvents, std::size_t& outDropped)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        outEvents = 0;
+        outDropped = 0;
+        std::ofstream file(traceFile, std::ios::out | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (std::size_t thread = 0; thread < buffers.size(); ++thread)
+        {
+            const ThreadBuffer& buffer = *buffers[thread];
+            std::string name = buffer.name.empty() ? "Thread " + std::to_string(thread) : buffer.name;
+            file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+            first = false;
+
+            for (const TraceEvent& event : buffer.events)
+            {
+                file << ",\n{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"pid\":1,\"tid\":" << thread
+                    << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+                if (event.argumentName != nullptr) file << ",\"args\":{\"" << event.argumentName << "\":" << event.argument << "}";
+                file << "}";
+            }
+            outEvents += buffer.events.size();
+            outDropped += buffer.dropped;
+        }
+        file << "\n]}\n";
+        return true;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        std::string name;
+        std::vector<TraceEvent> events;
+        std::size_t dropped = 0;
+    };
+
+    TraceRecorder()
+        : epoch(Clock::now())
+    {
+    }
+
+    ThreadBuffer& getThreadBuffer()
+    {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            //the buffers are owned by the recorder, so they outlive their threads
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.emplace_back(new ThreadBuffer());
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    std::atomic<bool> enabled{ false };
+    Clock::time_point epoch;
+    std::string traceFile;
+    std::size_t eventLimit = 1000000;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+/**
+ * @class TraceScope
+ * @brief Records the span from its construction to the end of the enclosing scope.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, const char* category = "simulation", const char* argumentName = nullptr, long long argument = 0)
+        : name(name), category(category), argumentName(argumentName), argument(argument)
+    {
+        if (TraceRecorder::shared().isEnabled()) begin = TraceRecorder::Clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (begin != TraceRecorder::Clock::time_point()) TraceRecorder::shared().record(name, category, begin, argumentName, argument);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    const char* argumentName;
+    long long argument;
+    TraceRecorder::Clock::time_point begin;
+};
+
+/**
+ * @class TraceOutput
+ * @brief Writes the trace of the shared recorder, if tracing is enabled, once: when write is called, or at the
+ * latest when it goes out of scope, so a run that stops early on an error still leaves its trace.
+ */
+class TraceOutput
+{
+public:
+    TraceOutput() = default;
+    TraceOutput(const TraceOutput&) = delete;
+    TraceOutput& operator=(const TraceOutput&) = delete;
+
+    ~TraceOutput()
+    {
+        write();
+    }
+
+    void write()
+    {
+        TraceRecorder& recorder = TraceRecorder::shared();
+        if (written || !recorder.isEnabled()) return;
+        written = true;
+
+        std::size_t events = 0;
+        std::size_t dropped = 0;
+        if (!recorder.write(events, dropped))
+        {
+            std::cout << "Error: Could not open trace file for writing: " << recorder.getTraceFile() << std::endl;
+            return;
+        }
+        std::cout << "\nTrace of " << events << " events saved to: " << recorder.getTraceFile() << std::endl;
+        if (dropped > 0) std::cout << dropped << " events were dropped; raise maxEventsPerThread to keep them." << std::endl;
+    }
+
+private:
+    bool written = false;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "SobolSequence.h"
+
+/**
+ * @brief How the noise of the replicates of an ensemble is sampled.
+ * None: independent pseudo-random streams.
+ * Antithetic: replicates come in pairs sharing one stream, the second negating every standard normal draw.
+ * QuasiMonteCarlo: the leading standard normal draws of replicate i come from point i of a randomly
+ * shifted Sobol sequence, the later draws from the replicate's pseudo-random stream.
+ */
+enum class VarianceReduction
+{
+    None,
+    Antithetic,
+    QuasiMonteCarlo
+};
+
+/**
+ * @brief Maps a parameters.json name ("none", "antithetic", "quasiMonteCarlo") to a variance reduction.
+ * @return True if the name is known.
+ */
+inline bool parseVarianceReduction(const std::string& name, VarianceReduction& outMethod)
+{
+    if (name == "none") outMethod = VarianceReduction::None;
+    else if (name == "antithetic") outMethod = VarianceReduction::Antithetic;
+    else if (name == "quasiMonteCarlo") outMethod = VarianceReduction::QuasiMonteCarlo;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief The inverse of the standard normal cumulative distribution function.
+ * Rational approximation by P. J. Acklam (relative error below 1.2e-9), with the tails split off at 0.02425.
+ * @param p A probability in (0, 1), clamped to [1e-16, 1 - 1e-16] (about 8.2 standard deviations).
+ */
+inline double inverseNormalCdf(double p)
+{
+    static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+        1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+        6.680131188771972e+01, -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+        -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+    static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+        3.754408661907416e+00 };
+    const double lowTail = 0.02425;
+
+    p = std::min(std::max(p, 1e-16), 1.0 - 1e-16);
+    if (p < lowTail)
+    {
+        double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - lowTail)
+    {
+        double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+        (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+/**
+ * @class QuasiRandomNormals
+ * @brief Standard normal vectors from a randomly shifted Sobol sequence, one vector per replicate.
+ * The shift (a Cranley-Patterson rotation drawn from the seed) keeps the estimates unbiased and lets
+ * independent seeds be compared, while the points of the replicates stay evenly spread. Vectors are
+ * computed directly from the replicate index, so replicates can be generated in any order on any thread.
+ */
+class QuasiRandomNormals
+{
+public:
+    /**
+     * @param draws The number of standard normal draws made by one replicate. At most
+     *        SobolSequence::maxDimensions() of them (the earliest) are quasi-random.
+     * @param seed The seed of the random shift.
+     */
+    QuasiRandomNormals(std::size_t draws, std::uint32_t seed)
+        : sequence(static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(draws, SobolSequence::maxDimensions())))),
+        shift(sequence.getDimensions())
+    {
+        std::seed_seq sequenceSeed{ seed, 0x51u };
+        std::mt19937 rng(sequenceSeed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for (double& value : shift) value = uniform(rng);
+    }
+
+    //the number of leading draws of each replicate that are quasi-random
+    std::size_t getDimensions() const { return shift.size(); }
+
+    /**
+     * @brief Writes the standard normal draws of a replicate.
+     */
+    void getNormals(std::size_t replicate, std::vector<double>& outNormals) const
+    {
+        //point 0 is the origin, which the shift moves like any other point
+        sequence.getPoint(static_cast<std::uint32_t>(replicate), outNormals);
+        for (std::size_t d = 0; d < outNormals.size(); ++d)
+        {
+            double u = outNormals[d] + shift[d];
+            if (u >= 1.0) u -= 1.0;
+            outNormals[d] = inverseNormalCdf(u);
+        }
+    }
+
+private:
+    SobolSequence sequence;
+    std::vector<double> shift;
+};